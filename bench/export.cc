@@ -0,0 +1,80 @@
+#include <dballe/core/benchmark.h>
+#include <dballe/exporter.h>
+#include <dballe/msg/msg.h>
+#include <dballe/msg/wr_codec.h>
+#include <memory>
+#include <vector>
+
+struct BenchmarkExport : public dballe::benchmark::Task
+{
+    dballe::benchmark::Messages messages;
+    std::unique_ptr<dballe::Exporter> exporter;
+    const dballe::impl::msg::WRExporter* wrexporter = nullptr;
+    dballe::impl::msg::wr::ExportPlan plan;
+    const char* m_name;
+    const char* m_pathname;
+    dballe::Encoding encoding;
+    unsigned hours;
+
+    BenchmarkExport(const char* name, const char* pathname,
+                    dballe::Encoding encoding = dballe::Encoding::BUFR,
+                    unsigned hours = 24)
+        : m_name(name), m_pathname(pathname), encoding(encoding), hours(hours)
+    {
+    }
+
+    const char* name() const override { return m_name; }
+
+    void setup() override
+    {
+        exporter   = dballe::Exporter::create(encoding);
+        wrexporter = dynamic_cast<const dballe::impl::msg::WRExporter*>(
+            exporter.get());
+        messages.load(m_pathname);
+
+        // Multiply messages by changing their datetime
+        size_t size = messages.size();
+        for (unsigned year = 2016; year < 2018; ++year)
+            for (unsigned month = 1; month <= 12; ++month)
+                for (unsigned hour = 0; hour < hours; ++hour)
+                    messages.duplicate(size,
+                                       dballe::Datetime(year, month, 1, hour));
+    }
+
+    void run_once() override
+    {
+        for (const auto& msgs : messages)
+            wrexporter->to_bulletin(msgs, plan)->encode();
+    }
+
+    void teardown() override
+    {
+        messages.clear();
+        plan       = dballe::impl::msg::wr::ExportPlan();
+        wrexporter = nullptr;
+        exporter.reset();
+    }
+};
+
+int main(int argc, const char* argv[])
+{
+    using namespace dballe::benchmark;
+    dballe::benchmark::Task* tasks[] = {
+        new BenchmarkExport("synop", "extra/bufr/synop-rad1.bufr"),
+        new BenchmarkExport("synop_crex", "extra/bufr/synop-rad1.bufr",
+                            dballe::Encoding::CREX),
+        new BenchmarkExport("temp", "extra/bufr/temp-huge.bufr",
+                            dballe::Encoding::BUFR, 2),
+        new BenchmarkExport("acars", "extra/bufr/gts-acars2.bufr"),
+    };
+
+    Benchmark benchmark;
+    dballe::benchmark::Whitelist whitelist(argc, argv);
+
+    for (auto task : tasks)
+        if (whitelist.has(task->name()))
+            benchmark.timeit(*task);
+
+    benchmark.print_timings();
+    return 0;
+}
@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <cstdio>
 #include <dballe/core/benchmark.h>
 #include <dballe/db/db.h>
+#include <dballe/db/v7/batch.h>
+#include <dballe/db/v7/transaction.h>
 #include <dballe/file.h>
 #include <dballe/msg/msg.h>
+#include <random>
 #include <vector>
 
 struct BenchmarkImport : public dballe::benchmark::Task
@@ -50,6 +55,100 @@ struct BenchmarkImport : public dballe::benchmark::Task
     void teardown() override { db->remove_all(); }
 };
 
+/**
+ * Import data into a database that already contains a year of data for the
+ * same stations, in chronological or in shuffled order.
+ *
+ * In chronological order, all imported datetimes are newer than the stored
+ * ones, and the batch can skip looking up existing values for them.
+ */
+struct BenchmarkImportExisting : public dballe::benchmark::Task
+{
+    dballe::benchmark::Messages messages;
+    std::shared_ptr<dballe::db::DB> db;
+    std::string m_name;
+    const char* m_pathname;
+    bool shuffled;
+    unsigned hours;
+
+    BenchmarkImportExisting(const char* name, const char* pathname,
+                            bool shuffled, unsigned hours = 24)
+        : m_name(std::string(name) + (shuffled ? "_existing_shuffled"
+                                               : "_existing_sorted")),
+          m_pathname(pathname), shuffled(shuffled), hours(hours)
+    {
+        auto options = dballe::DBConnectOptions::test_create();
+        db           = dballe::db::DB::downcast(dballe::DB::connect(*options));
+    }
+
+    const char* name() const override { return m_name.c_str(); }
+
+    /// Append copies of the first size messages with the given datetime
+    void duplicate(dballe::benchmark::Messages& dest, size_t size,
+                   const dballe::Datetime& datetime)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            std::vector<std::shared_ptr<dballe::Message>> msgs;
+            for (const auto& msg : messages[i])
+            {
+                auto copy = msg->clone();
+                dballe::impl::Message::downcast(*copy).set_datetime(datetime);
+                msgs.emplace_back(copy);
+            }
+            dest.emplace_back(std::move(msgs));
+        }
+    }
+
+    void setup() override
+    {
+        db->reset();
+        messages.load(m_pathname);
+        size_t size = messages.size();
+
+        // Fill the database with 2016 data
+        dballe::benchmark::Messages existing;
+        for (unsigned month = 1; month <= 12; ++month)
+            for (unsigned day = 1; day <= 28; ++day)
+                for (unsigned hour = 0; hour < hours; ++hour)
+                    duplicate(existing, size,
+                              dballe::Datetime(2016, month, day, hour));
+        auto tr = db->transaction();
+        for (const auto& msgs : existing)
+            tr->import_messages(msgs);
+        tr->commit();
+
+        // Import the first month of 2017
+        dballe::benchmark::Messages added;
+        for (unsigned day = 1; day <= 28; ++day)
+            for (unsigned hour = 0; hour < hours; ++hour)
+                duplicate(added, size, dballe::Datetime(2017, 1, day, hour));
+        if (shuffled)
+            std::shuffle(added.begin(), added.end(), std::mt19937());
+        messages.swap(added);
+    }
+
+    void run_once() override
+    {
+        auto tr = db->transaction();
+        for (const auto& msgs : messages)
+            tr->import_messages(msgs);
+        const auto& batch =
+            dynamic_cast<dballe::db::v7::Transaction&>(*tr).batch;
+        fprintf(stderr,
+                "%s: %u lookups of existing values, %u of last datetimes\n",
+                name(), batch.count_select_data,
+                batch.count_select_last_datetime);
+        tr->commit();
+    }
+
+    void teardown() override
+    {
+        messages.clear();
+        db->remove_all();
+    }
+};
+
 int main(int argc, const char* argv[])
 {
     using namespace dballe::benchmark;
@@ -57,6 +156,10 @@ int main(int argc, const char* argv[])
         new BenchmarkImport("synop", "extra/bufr/synop-rad1.bufr"),
         new BenchmarkImport("temp", "extra/bufr/temp-huge.bufr", 2),
         new BenchmarkImport("acars", "extra/bufr/gts-acars2.bufr", 24, 15),
+        new BenchmarkImportExisting("synop", "extra/bufr/synop-rad1.bufr",
+                                    false),
+        new BenchmarkImportExisting("synop", "extra/bufr/synop-rad1.bufr",
+                                    true),
     };
 
     Benchmark benchmark;
@@ -10,14 +10,16 @@ struct BenchmarkQuery : public dballe::benchmark::Task
     std::shared_ptr<dballe::db::DB> db;
     const char* m_name;
     const char* m_pathname;
+    const char* m_query;
     unsigned months;
     unsigned hours;
     unsigned minutes;
 
-    BenchmarkQuery(const char* name, const char* pathname, unsigned months = 12,
-                   unsigned hours = 24, unsigned minutes = 1)
-        : m_name(name), m_pathname(pathname), months(months), hours(hours),
-          minutes(minutes)
+    BenchmarkQuery(const char* name, const char* pathname, const char* query,
+                   unsigned months = 12, unsigned hours = 24,
+                   unsigned minutes = 1)
+        : m_name(name), m_pathname(pathname), m_query(query), months(months),
+          hours(hours), minutes(minutes)
     {
         auto options = dballe::DBConnectOptions::test_create();
         db           = dballe::db::DB::downcast(dballe::DB::connect(*options));
@@ -52,6 +54,7 @@ struct BenchmarkQuery : public dballe::benchmark::Task
         auto tr = std::dynamic_pointer_cast<dballe::db::Transaction>(
             db->transaction());
         dballe::core::Query query;
+        query.query = m_query;
         auto cur = tr->query_data(query);
         while (cur->next())
             ;
@@ -65,9 +68,14 @@ int main(int argc, const char* argv[])
 {
     using namespace dballe::benchmark;
     dballe::benchmark::Task* tasks[] = {
-        new BenchmarkQuery("synop", "extra/bufr/synop-rad1.bufr", 1, 24),
-        new BenchmarkQuery("temp", "extra/bufr/temp-huge.bufr", 1, 1),
-        new BenchmarkQuery("acars", "extra/bufr/gts-acars2.bufr", 12, 24, 10),
+        new BenchmarkQuery("synop", "extra/bufr/synop-rad1.bufr", "", 1, 24),
+        new BenchmarkQuery("synop_best", "extra/bufr/synop-rad1.bufr", "best",
+                           1, 24),
+        new BenchmarkQuery("synop_last", "extra/bufr/synop-rad1.bufr", "last",
+                           1, 24),
+        new BenchmarkQuery("temp", "extra/bufr/temp-huge.bufr", "", 1, 1),
+        new BenchmarkQuery("acars", "extra/bufr/gts-acars2.bufr", "", 12, 24,
+                           10),
     };
 
     Benchmark benchmark;
@@ -5,6 +5,9 @@
 #include "dballe/db/v7/db.h"
 #include "dballe/db/v7/transaction.h"
 #include "dballe/msg/msg.h"
+#include <algorithm>
+#include <sstream>
+#include <wreport/utils/sys.h>
 
 using namespace dballe;
 using namespace dballe::cmdline;
@@ -14,6 +17,18 @@ using namespace std;
 
 namespace {
 
+/// Read the lines of a file, sorted
+std::vector<std::string> sorted_lines(const std::string& fname)
+{
+    std::vector<std::string> res;
+    std::stringstream in(sys::read_file(fname));
+    std::string line;
+    while (std::getline(in, line))
+        res.push_back(line);
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
 template <typename DB> class Tests : public FixtureTestCase<DBFixture<DB>>
 {
     typedef DBFixture<DB> Fixture;
@@ -91,6 +106,110 @@ template <typename DB> void Tests<DB>::register_tests()
 
         wassert(actual(msg->get_datetime()) == Datetime(2016, 3, 14, 23, 0, 4));
     });
+
+    this->add_method("import_batched", [](Fixture& f) {
+        Dbadb dbadb(*f.db);
+        auto opts       = DBImportOptions::create();
+        opts->overwrite = true;
+        string fname    = dballe::tests::datafile("bufr/issue62.bufr");
+
+        cmdline::ReaderOptions ropts;
+        cmdline::Reader reader(ropts);
+        wassert(actual(dbadb.do_import(fname, reader, *opts)) == 0);
+        auto count = f.db->query_data(core::Query())->remaining();
+        wassert(actual(count) > 0);
+
+        // Data repeated in the same batch is imported only once
+        wassert(f.db->remove_all());
+        ImportBatching batching;
+        batching.messages     = 100;
+        batching.commit_every = 1;
+        cmdline::Reader reader1(ropts);
+        wassert(actual(dbadb.do_import(list<string>{fname, fname}, reader1,
+                                       *opts, batching)) == 0);
+        wassert(actual(f.db->query_data(core::Query())->remaining()) == count);
+    });
+
+    this->add_method("import_resume", [](Fixture& f) {
+        Dbadb dbadb(*f.db);
+        auto opts    = DBImportOptions::create();
+        string fname = dballe::tests::datafile("bufr/issue62.bufr");
+
+        ImportBatching batching;
+        batching.commit_every = 1;
+        cmdline::ReaderOptions ropts;
+        cmdline::Reader reader(ropts);
+        wassert(actual(dbadb.do_import(fname, reader, *opts, batching)) == 0);
+        auto count = f.db->query_data(core::Query())->remaining();
+        wassert(actual(count) > 0);
+
+        // A completed import leaves nothing to resume
+        wassert(actual(f.db->conn->get_setting("import_checkpoint")) == "");
+
+        // Simulate an import interrupted after committing the first file, by
+        // failing to open the second one
+        string fname1 = "import_resume.bufr";
+        sys::unlink_ifexists(fname1);
+        wassert(f.db->remove_all());
+        cmdline::Reader reader1(ropts);
+        wassert_throws(error_system,
+                       dbadb.do_import(list<string>{fname, fname1}, reader1,
+                                       *opts, batching));
+        wassert(actual(f.db->query_data(core::Query())->remaining()) == count);
+        wassert(actual(f.db->conn->get_setting("import_checkpoint")) != "");
+
+        // Resuming needs the same list of files
+        batching.resume = true;
+        cmdline::Reader reader2(ropts);
+        wassert_throws(error_consistency,
+                       dbadb.do_import(list<string>{fname1, fname}, reader2,
+                                       *opts, batching));
+
+        // Resuming skips the first file
+        sys::write_file(fname1, sys::read_file(fname));
+        cmdline::Reader reader3(ropts);
+        opts->overwrite = true;
+        wassert(actual(dbadb.do_import(list<string>{fname, fname1}, reader3,
+                                       *opts, batching)) == 0);
+        wassert(actual(reader3.count_successes) == reader.count_successes);
+        wassert(actual(f.db->query_data(core::Query())->remaining()) == count);
+        wassert(actual(f.db->conn->get_setting("import_checkpoint")) == "");
+        sys::unlink_ifexists(fname1);
+    });
+
+    this->add_method("station_sync", [](Fixture& f) {
+        Dbadb dbadb(*f.db);
+        cmdline::ReaderOptions ropts;
+        cmdline::Reader reader(ropts);
+        wassert(actual(dbadb.do_import(
+                    dballe::tests::datafile("bufr/issue62.bufr"), reader,
+                    DBImportOptions::defaults)) == 0);
+        auto count = f.db->query_station_data(core::Query())->remaining();
+        wassert(actual(count) > 0);
+
+        // Dump the stations, wipe the database, and sync them back
+        FILE* out = fopen("test_stations.csv", "wt");
+        wassert(actual(dbadb.do_station_dump(core::Query(), out)) == 0);
+        fclose(out);
+        wassert(f.db->remove_all());
+
+        FILE* devnull = fopen("/dev/null", "wt");
+        wassert(actual(dbadb.do_station_sync("test_stations.csv", false,
+                                             devnull)) == 0);
+        wassert(actual(f.db->query_station_data(core::Query())->remaining()) ==
+                count);
+
+        // Syncing again does not change anything
+        wassert(actual(dbadb.do_station_sync("test_stations.csv", true,
+                                             devnull)) == 0);
+        fclose(devnull);
+        out = fopen("test_stations1.csv", "wt");
+        wassert(actual(dbadb.do_station_dump(core::Query(), out)) == 0);
+        fclose(out);
+        wassert(actual(sorted_lines("test_stations1.csv") ==
+                       sorted_lines("test_stations.csv"))
+                    .istrue());
+    });
 }
 
 } // namespace
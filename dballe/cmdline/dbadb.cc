@@ -1,10 +1,24 @@
 #include "dbadb.h"
+#include "dballe/core/csv.h"
+#include "dballe/core/var.h"
 #include "dballe/db/db.h"
+#include "dballe/db/summary_memory.h"
+#include "dballe/db/v7/db.h"
+#include "dballe/db/v7/transaction.h"
 #include "dballe/message.h"
 #include "dballe/msg/msg.h"
+#include "dballe/msg/wr_codec.h"
+#include "dballe/sql/sql.h"
 #include "dballe/values.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sys/stat.h>
+#include <tuple>
 
 using namespace wreport;
 using namespace std;
@@ -16,21 +30,242 @@ namespace cmdline {
 
 namespace {
 
+/// Write CSV output to the given output stream
+struct FileCSV : public CSVWriter
+{
+    FILE* out;
+    FileCSV(FILE* out) : out(out) {}
+
+    void flush_row() override
+    {
+        fputs(row.c_str(), out);
+        putc('\n', out);
+        row.clear();
+    }
+};
+
+/// Add station coordinates to a CSV row, as decimal degrees
+void add_coords(CSVWriter& out, const Coords& coords)
+{
+    char buf[16];
+    snprintf(buf, 16, "%.5f", coords.dlat());
+    out.add_value_raw(buf);
+    snprintf(buf, 16, "%.5f", coords.dlon());
+    out.add_value_raw(buf);
+}
+
+/// Name of the setting storing the position of a checkpointed import
+const char* checkpoint_setting = "import_checkpoint";
+
+/// Position of a message in the list of files being imported
+struct Checkpoint
+{
+    unsigned file = 0;
+    int index     = -1;
+    off_t offset  = -1;
+    /// Identifier of the list of files being imported (see files_id)
+    std::string files;
+
+    bool is_set() const { return index != -1; }
+
+    /// Encode the position, or return an empty string if it is not set
+    std::string encode() const
+    {
+        if (!is_set())
+            return std::string();
+        char buf[64];
+        snprintf(buf, 64, "%u %d %lld %s", file, index, (long long)offset,
+                 files.c_str());
+        return buf;
+    }
+
+    static Checkpoint decode(const std::string& val)
+    {
+        Checkpoint res;
+        if (val.empty())
+            return res;
+        long long offset;
+        char files[17];
+        if (sscanf(val.c_str(), "%u %d %lld %16s", &res.file, &res.index,
+                   &offset, files) != 4)
+            error_consistency::throwf("invalid import checkpoint: \"%s\"",
+                                      val.c_str());
+        res.offset = offset;
+        res.files  = files;
+        return res;
+    }
+
+    /**
+     * Identify a list of files with a hash of their names, so that an import
+     * is only resumed on the same files
+     */
+    static std::string files_id(const std::list<std::string>& fnames)
+    {
+        // 64 bit FNV-1a
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (const auto& fname : fnames)
+            for (size_t i = 0; i <= fname.size(); ++i)
+            {
+                hash ^= (unsigned char)fname.c_str()[i];
+                hash *= 0x100000001b3ULL;
+            }
+        char buf[17];
+        snprintf(buf, 17, "%016llx", (unsigned long long)hash);
+        return buf;
+    }
+};
+
+/// Throughput and completion estimate of an import
+struct ImportProgress
+{
+    typedef std::chrono::steady_clock clock;
+
+    /// Sizes of the files being imported
+    std::vector<off_t> sizes;
+    /// Total size of the files being imported
+    off_t total_size = 0;
+    /// Amount of data that had already been imported when starting
+    off_t start_pos  = -1;
+    clock::time_point start;
+    clock::time_point last_report;
+    unsigned messages = 0;
+    unsigned values   = 0;
+
+    ImportProgress(const std::list<std::string>& fnames)
+        : start(clock::now()), last_report(start)
+    {
+        for (const auto& fname : fnames)
+        {
+            struct stat st;
+            off_t size = ::stat(fname.c_str(), &st) == 0 ? st.st_size : 0;
+            sizes.push_back(size);
+            total_size += size;
+        }
+    }
+
+    /// Account for an imported message, reporting progress once per second
+    void add(const Checkpoint& pos, const Message& message);
+
+    /// Print the current progress
+    void report(const Checkpoint& pos, clock::time_point now);
+};
+
+void ImportProgress::add(const Checkpoint& pos, const Message& message)
+{
+    const impl::Message& msg = impl::Message::downcast(message);
+    ++messages;
+    values += msg.station_data.size();
+    for (const auto& ctx : msg.data)
+        values += ctx.values.size();
+
+    auto now = clock::now();
+    if (now - last_report < std::chrono::seconds(1))
+        return;
+    report(pos, now);
+    last_report = now;
+}
+
+void ImportProgress::report(const Checkpoint& pos, clock::time_point now)
+{
+    off_t cur_pos = pos.offset == -1 ? 0 : pos.offset;
+    for (unsigned i = 0; i < pos.file && i < sizes.size(); ++i)
+        cur_pos += sizes[i];
+    if (start_pos == -1)
+        start_pos = cur_pos;
+
+    double elapsed = std::chrono::duration<double>(now - start).count();
+    if (elapsed <= 0)
+        return;
+    fprintf(stderr, "%u messages, %u values, %.1f messages/s, %.1f values/s",
+            messages, values, messages / elapsed, values / elapsed);
+
+    double bytes_per_second = (cur_pos - start_pos) / elapsed;
+    if (bytes_per_second > 0 && total_size > cur_pos)
+    {
+        unsigned eta = (total_size - cur_pos) / bytes_per_second;
+        fprintf(stderr, ", ETA %u:%02u:%02u", eta / 3600, (eta / 60) % 60,
+                eta % 60);
+    }
+    fputc('\n', stderr);
+}
+
 struct Importer : public Action
 {
     dballe::DB& db;
     const DBImportOptions& opts;
+    const ImportBatching& batching;
+    Reader& reader;
     std::shared_ptr<dballe::Transaction> transaction;
+    /// Input item of a message waiting to be imported
+    struct Source
+    {
+        std::string pathname;
+        unsigned idx;
+        /// Sequence number of the item among those read
+        unsigned item;
+    };
+    /// Messages waiting to be imported
+    std::vector<std::shared_ptr<Message>> pending;
+    /// Input items of the pending messages
+    std::vector<Source> sources;
+    /// Number of items read
+    unsigned items_read     = 0;
+    /// Set when the item being read failed to import while flushing
+    bool current_failed     = false;
+    /// Number of values in the pending messages
+    unsigned pending_values = 0;
+    /// Number of messages imported since the last commit
+    unsigned uncommitted    = 0;
+    /// Store the import position at each commit
+    bool checkpoint         = false;
+    /// Position of the last message read
+    Checkpoint last;
+    /// Progress reporting, if requested
+    std::unique_ptr<ImportProgress> progress;
 
-    Importer(dballe::DB& db, const DBImportOptions& opts) : db(db), opts(opts)
+    Importer(dballe::DB& db, const DBImportOptions& opts,
+             const ImportBatching& batching, Reader& reader)
+        : db(db), opts(opts), batching(batching), reader(reader)
     {
     }
 
     bool operator()(const cmdline::Item& item) override;
+
+    /**
+     * Import the pending messages.
+     *
+     * reading is true when flushing while the reader is processing the
+     * last pending item, which it has not counted yet.
+     */
+    void flush(bool reading = false);
+
+    /**
+     * Import the pending messages one at a time after importing them
+     * together failed, reporting errors for each message like an unbatched
+     * import
+     */
+    void flush_one_by_one(bool reading);
+
+    /// Account for imported messages, committing if it is time to
+    void imported(unsigned count);
+
+    /// Store the import position in the current transaction
+    void save_checkpoint(const Checkpoint& pos);
+
     void commit()
     {
+        flush();
+        if (checkpoint && !transaction.get())
+            transaction = db.transaction();
         if (transaction.get())
+        {
+            // The import is complete: there is nothing left to resume
+            if (checkpoint)
+                save_checkpoint(Checkpoint());
             transaction->commit();
+        }
+        if (progress)
+            progress->report(last, ImportProgress::clock::now());
     }
 };
 
@@ -39,22 +274,185 @@ bool Importer::operator()(const Item& item)
     if (!transaction.get())
         transaction = db.transaction();
 
+    last.file   = reader.file_index;
+    last.index  = item.idx;
+    last.offset = item.rmsg ? item.rmsg->offset : -1;
+
     if (item.msgs == NULL)
     {
         fprintf(stderr, "Message #%d cannot be parsed: ignored\n", item.idx);
         return false;
     }
+
+    if (progress)
+        for (const auto& msg : *item.msgs)
+            progress->add(last, *msg);
+
+    if (batching.messages <= 1)
+    {
+        try
+        {
+            transaction->import_messages(*item.msgs, opts);
+        }
+        catch (std::exception& e)
+        {
+            item.processing_failed(e);
+        }
+        imported(item.msgs->size());
+        return true;
+    }
+
+    // Report problems that would make the import fail for the item that
+    // has them, before it is deferred
+    unsigned values = 0;
     try
     {
-        transaction->import_messages(*item.msgs, opts);
+        for (const auto& msg : *item.msgs)
+            values += db::v7::Transaction::check_importable(*msg, opts);
     }
     catch (std::exception& e)
     {
         item.processing_failed(e);
     }
+
+    // Keep a reference to the messages, since the database only stores
+    // pointers to their values until they are written
+    pending.insert(pending.end(), item.msgs->begin(), item.msgs->end());
+    sources.insert(sources.end(), item.msgs->size(),
+                   Source{item.rmsg ? item.rmsg->pathname : "(unknown)",
+                          item.idx, items_read++});
+    pending_values += values;
+    if (pending.size() >= batching.messages ||
+        (batching.values && pending_values >= batching.values))
+    {
+        current_failed = false;
+        flush(true);
+        // The reader counts and rejects the current item if it failed
+        if (current_failed)
+            return false;
+    }
     return true;
 }
 
+void Importer::flush(bool reading)
+{
+    if (pending.empty())
+        return;
+
+    // Sort by station, so that the values of each station are looked up and
+    // written together. Messages of the same station keep the input order,
+    // so that later messages still overwrite earlier ones, as in an
+    // unbatched import. The batch already groups the values of a station by
+    // datetime.
+    struct Key
+    {
+        std::string report;
+        Coords coords;
+        Ident ident;
+        unsigned pos;
+
+        bool operator<(const Key& o) const
+        {
+            return std::tie(report, coords, ident, pos) <
+                   std::tie(o.report, o.coords, o.ident, o.pos);
+        }
+    };
+    std::vector<Key> keys;
+    keys.reserve(pending.size());
+    for (unsigned i = 0; i < pending.size(); ++i)
+        keys.emplace_back(
+            Key{opts.report.empty() ? pending[i]->get_report() : opts.report,
+                pending[i]->get_coords(), pending[i]->get_ident(), i});
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<std::shared_ptr<Message>> sorted;
+    sorted.reserve(pending.size());
+    for (const auto& k : keys)
+        sorted.emplace_back(pending[k.pos]);
+
+    if (!transaction.get())
+        transaction = db.transaction();
+    try
+    {
+        transaction->import_messages(sorted, opts);
+    }
+    catch (std::exception&)
+    {
+        flush_one_by_one(reading);
+    }
+
+    imported(pending.size());
+    pending.clear();
+    sources.clear();
+    pending_values = 0;
+}
+
+void Importer::flush_one_by_one(bool reading)
+{
+    auto& tr = dynamic_cast<db::Transaction&>(*transaction);
+    // Drop what the failed import left queued
+    tr.clear_cached_state();
+
+    // Messages of the same item are next to each other: count each failed
+    // item only once
+    const Source* last_failed = nullptr;
+    std::vector<std::shared_ptr<Message>> msgs(1);
+    for (unsigned i = 0; i < pending.size(); ++i)
+    {
+        msgs[0] = pending[i];
+        try
+        {
+            transaction->import_messages(msgs, opts);
+        }
+        catch (std::exception& e)
+        {
+            tr.clear_cached_state();
+            if (reader.verbose)
+                fprintf(stderr, "%s\n",
+                        ProcessingException(sources[i].pathname,
+                                            sources[i].idx, e)
+                            .what());
+            if (last_failed && last_failed->item == sources[i].item)
+                continue;
+            last_failed = &sources[i];
+            if (reading && sources[i].item == sources.back().item)
+                current_failed = true;
+            else
+            {
+                // The reader has already counted the item as imported
+                --reader.count_successes;
+                ++reader.count_failures;
+            }
+        }
+    }
+}
+
+void Importer::imported(unsigned count)
+{
+    uncommitted += count;
+    if (!batching.commit_every || uncommitted < batching.commit_every)
+        return;
+    // All messages read so far have been imported: commit their position
+    // together with them
+    if (checkpoint)
+        save_checkpoint(last);
+    transaction->commit();
+    transaction.reset();
+    uncommitted = 0;
+}
+
+void Importer::save_checkpoint(const Checkpoint& pos)
+{
+    auto tr = std::dynamic_pointer_cast<db::v7::Transaction>(transaction);
+    if (!tr)
+        throw error_unimplemented(
+            "checkpointed import is only supported on V7 databases");
+    // Write everything imported so far before its position, and store the
+    // position in the same transaction, so that they are committed together
+    tr->write_deferred();
+    tr->conn->set_setting(checkpoint_setting, pos.encode());
+}
+
 } // namespace
 
 /// Query data in the database and output results as arbitrary human readable
@@ -105,6 +503,139 @@ int Dbadb::do_stations(const Query& query, FILE* out)
     return 0;
 }
 
+int Dbadb::do_summary(const Query& query, unsigned jobs, FILE* out)
+{
+    core::Query q(core::Query::downcast(query));
+    q.query = "details";
+
+    db::DBSummaryMemory summary;
+    dynamic_cast<db::DB&>(db).query_summary_sharded(
+        q, jobs, [&](dballe::CursorSummary& cur) {
+            while (cur.next())
+                summary.add_cursor(cur);
+        });
+
+    auto cursor = summary.query_summary(core::Query());
+    for (unsigned i = 0; cursor->next(); ++i)
+    {
+        fprintf(out, "#%u: -----------------------\n", i);
+        fprintf(out, "Station: ");
+        cursor->get_station().print(out);
+        fprintf(out, "Level: ");
+        cursor->get_level().print(out);
+        fprintf(out, "Trange: ");
+        cursor->get_trange().print(out);
+        fprintf(out, "Var: %01d%02d%03d\n", WR_VAR_FXY(cursor->get_varcode()));
+        fprintf(out, "Datetime: ");
+        cursor->get_datetimerange().print(out);
+        fprintf(out, "Count: %zu\n", cursor->get_count());
+    }
+    return 0;
+}
+
+int Dbadb::do_station_dump(const Query& query, FILE* out)
+{
+    auto tr       = dynamic_pointer_cast<db::Transaction>(db.transaction());
+    auto stations = tr->dump_stations(query);
+    tr->rollback();
+
+    FileCSV csv(out);
+    csv.add_value("report");
+    csv.add_value("latitude");
+    csv.add_value("longitude");
+    csv.add_value("ident");
+    csv.add_value("varcode");
+    csv.add_value("value");
+    csv.flush_row();
+    for (const auto& rec : stations)
+    {
+        auto add_station = [&]() {
+            csv.add_value(rec.station.report);
+            add_coords(csv, rec.station.coords);
+            if (rec.station.ident.is_missing())
+                csv.add_value_empty();
+            else
+                csv.add_value(rec.station.ident.get());
+        };
+
+        if (rec.values.empty())
+        {
+            add_station();
+            csv.add_value_empty();
+            csv.add_value_empty();
+            csv.flush_row();
+        }
+        for (const auto& val : rec.values)
+        {
+            add_station();
+            csv.add_value(val.code());
+            csv.add_var_value_formatted(*val);
+            csv.flush_row();
+        }
+    }
+    return 0;
+}
+
+int Dbadb::do_station_sync(const std::string& fname, bool remove_missing,
+                           FILE* out)
+{
+    std::unique_ptr<CSVReader> in;
+    if (fname == "-")
+        in.reset(new CSVReader(std::cin));
+    else
+        in.reset(new CSVReader(fname));
+
+    // Group the rows by station
+    typedef std::tuple<std::string, int, int, std::string> Key;
+    std::map<Key, size_t> by_key;
+    std::vector<db::StationRecord> stations;
+    if (in->move_to_data(1))
+    {
+        do
+        {
+            if (in->cols.empty())
+                continue;
+            if (in->cols.size() != 6)
+                error_consistency::throwf(
+                    "cannot parse CSV line has %zd fields instead of 6",
+                    in->cols.size());
+            DBStation station;
+            station.report = in->cols[0];
+            station.coords = Coords(strtod(in->cols[1].c_str(), nullptr),
+                                    strtod(in->cols[2].c_str(), nullptr));
+            if (!in->cols[3].empty())
+                station.ident = in->cols[3];
+
+            Key key(station.report, station.coords.lat, station.coords.lon,
+                    in->cols[3]);
+            auto i = by_key.find(key);
+            if (i == by_key.end())
+            {
+                i = by_key.emplace(key, stations.size()).first;
+                stations.emplace_back();
+                stations.back().station = station;
+            }
+
+            if (in->cols[4].empty() || in->cols[5].empty())
+                continue;
+            auto var = newvar(in->as_varcode(4));
+            var->setf(in->cols[5].c_str());
+            stations[i->second].values.set(std::move(var));
+        } while (in->next());
+    }
+
+    auto tr    = dynamic_pointer_cast<db::Transaction>(db.transaction());
+    auto stats = tr->sync_stations(stations, remove_missing);
+    tr->commit();
+
+    fprintf(out,
+            "%zu stations: %u added; values: %u added, %u updated, "
+            "%u unchanged, %u removed\n",
+            stations.size(), stats.stations_added, stats.values_added,
+            stats.values_updated, stats.values_unchanged, stats.values_removed);
+    return 0;
+}
+
 int Dbadb::do_export_dump(const Query& query, FILE* out)
 {
     auto cursor = db.query_messages(query);
@@ -114,9 +645,44 @@ int Dbadb::do_export_dump(const Query& query, FILE* out)
 }
 
 int Dbadb::do_import(const list<string>& fnames, Reader& reader,
-                     const DBImportOptions& opts)
+                     const DBImportOptions& opts,
+                     const ImportBatching& batching)
 {
-    Importer importer(db, opts);
+    Importer importer(db, opts, batching, reader);
+    importer.checkpoint =
+        (batching.commit_every || batching.resume) && !fnames.empty();
+    importer.last.files = Checkpoint::files_id(fnames);
+    if (batching.progress)
+        importer.progress.reset(new ImportProgress(fnames));
+
+    if (batching.resume)
+    {
+        if (fnames.empty())
+            throw error_consistency(
+                "cannot resume an import from standard input");
+        auto& v7db = dynamic_cast<db::v7::DB&>(db);
+        Checkpoint pos =
+            Checkpoint::decode(v7db.conn->get_setting(checkpoint_setting));
+        if (pos.is_set())
+        {
+            if (pos.files != importer.last.files)
+                throw error_consistency(
+                    "cannot resume import: it was started on a different list "
+                    "of files");
+            if (pos.file >= fnames.size())
+                error_consistency::throwf(
+                    "cannot resume import from file #%u: only %zu files given",
+                    pos.file + 1, fnames.size());
+            reader.resume_file   = pos.file;
+            reader.resume_index  = pos.index;
+            reader.resume_offset = pos.offset;
+            if (reader.verbose)
+                fprintf(stderr, "Resuming import after message #%d of %s\n",
+                        pos.index,
+                        std::next(fnames.begin(), pos.file)->c_str());
+        }
+    }
+
     reader.read(fnames, importer);
     importer.commit();
     if (reader.verbose)
@@ -137,11 +703,12 @@ int Dbadb::do_import(const list<string>& fnames, Reader& reader,
 }
 
 int Dbadb::do_import(const std::string& fname, Reader& reader,
-                     const DBImportOptions& opts)
+                     const DBImportOptions& opts,
+                     const ImportBatching& batching)
 {
     list<string> fnames;
     fnames.push_back(fname);
-    return do_import(fnames, reader, opts);
+    return do_import(fnames, reader, opts, batching);
 }
 
 int Dbadb::do_export(const Query& query, File& file,
@@ -154,6 +721,10 @@ int Dbadb::do_export(const Query& query, File& file,
     if (forced_repmemo)
         forced_repmemo = forced_repmemo;
     auto exporter = Exporter::create(file.encoding(), opts);
+    // BUFR and CREX exports reuse context positions across messages
+    auto wrexporter =
+        dynamic_cast<const impl::msg::WRExporter*>(exporter.get());
+    impl::msg::wr::ExportPlan plan;
 
     auto cursor = db.query_messages(query);
     while (cursor->next())
@@ -168,7 +739,10 @@ int Dbadb::do_export(const Query& query, File& file,
         }
         std::vector<std::shared_ptr<Message>> msgs;
         msgs.emplace_back(move(msg));
-        file.write(exporter->to_binary(msgs));
+        if (wrexporter)
+            file.write(wrexporter->to_bulletin(msgs, plan)->encode());
+        else
+            file.write(exporter->to_binary(msgs));
     }
     return 0;
 }
@@ -11,6 +11,49 @@
 namespace dballe {
 namespace cmdline {
 
+/// Options to group messages together and to commit them when importing
+struct ImportBatching
+{
+    /**
+     * Number of messages to accumulate before writing them to the database.
+     *
+     * Accumulated messages are grouped by station, keeping their reading
+     * order, so that values for the same station are written together. With
+     * 1 (the default), each message is written as soon as it is read.
+     */
+    unsigned messages = 1;
+
+    /**
+     * If not 0, also write accumulated messages as soon as they contain at
+     * least this number of values
+     */
+    unsigned values = 0;
+
+    /**
+     * If not 0, commit after importing this number of messages, instead of
+     * importing everything in a single transaction.
+     *
+     * When importing from files, each commit also stores in the database the
+     * position of the last message imported, so that an interrupted import
+     * can be resumed.
+     */
+    unsigned commit_every = 0;
+
+    /**
+     * Resume an interrupted import from the last position stored in the
+     * database.
+     *
+     * The import must be run again with the same list of files, or it fails.
+     */
+    bool resume = false;
+
+    /**
+     * Periodically print to stderr the import throughput and the estimated
+     * time to completion
+     */
+    bool progress = false;
+};
+
 class Dbadb
 {
 protected:
@@ -27,16 +70,49 @@ public:
     /// readable text
     int do_stations(const Query& query, FILE* out);
 
+    /**
+     * Summarise the data in the database and output results as arbitrary
+     * human readable text.
+     *
+     * With \a jobs more than 1, the summary is computed in that number of
+     * parts (see db::DB::query_summary_sharded)
+     */
+    int do_summary(const Query& query, unsigned jobs, FILE* out);
+
+    /**
+     * Write the stations in the database, with all their station values, as
+     * CSV with one row per value: report, latitude, longitude, ident,
+     * varcode, value.
+     *
+     * Stations without values are written as one row with empty varcode and
+     * value.
+     */
+    int do_station_dump(const Query& query, FILE* out);
+
+    /**
+     * Synchronise the station values in the database with a CSV file in the
+     * format written by do_station_dump, and print a summary of the changes
+     * to out.
+     *
+     * fname can be "-" to read from standard input.
+     *
+     * See db::Transaction::sync_stations for the meaning of remove_missing.
+     */
+    int do_station_sync(const std::string& fname, bool remove_missing,
+                        FILE* out);
+
     /// Export messages and dump their contents to the given file descriptor
     int do_export_dump(const Query& query, FILE* out);
 
     /// Import the given files
     int do_import(const std::list<std::string>& fnames, Reader& reader,
-                  const DBImportOptions& opts);
+                  const DBImportOptions& opts,
+                  const ImportBatching& batching = ImportBatching());
 
     /// Import one file
     int do_import(const std::string& fname, Reader& reader,
-                  const DBImportOptions& opts);
+                  const DBImportOptions& opts,
+                  const ImportBatching& batching = ImportBatching());
 
     /// Export messages writing them to the givne file
     int do_export(const Query& query, File& file,
@@ -1,6 +1,7 @@
 #include "processor.h"
 #include "dballe/cmdline/cmdline.h"
 #include "dballe/core/csv.h"
+#include "dballe/core/file.h"
 #include "dballe/core/match-wreport.h"
 #include "dballe/file.h"
 #include "dballe/message.h"
@@ -360,6 +361,9 @@ void Reader::read_csv(const std::list<std::string>& fnames, Action& action)
     // BinaryMessage strings, but that would mean parsing the CSV twice: once to
     // detect the message boundaries and once to parse the BinaryMessage
     // strings.
+    if (resume_index != -1)
+        throw error_unimplemented("resuming is not supported for CSV input");
+
     Item item;
     unique_ptr<CSVReader> csvin;
 
@@ -408,9 +412,11 @@ void Reader::read_file(const std::list<std::string>& fnames, Action& action)
     std::unique_ptr<File> fail_file;
 
     list<string>::const_iterator name = fnames.begin();
+    unsigned next_file_index          = 0;
     do
     {
         unique_ptr<File> file;
+        file_index = next_file_index++;
 
         if (input_type == "auto")
         {
@@ -438,10 +444,29 @@ void Reader::read_file(const std::list<std::string>& fnames, Action& action)
             }
         }
 
+        bool resuming = false;
+        if (resume_index != -1)
+        {
+            // Skip the files that have already been read
+            if (file_index < resume_file)
+                continue;
+            if (file_index == resume_file)
+            {
+                resuming = true;
+                if (resume_offset != -1)
+                    if (auto f = dynamic_cast<core::File*>(file.get()))
+                        f->seek(resume_offset, resume_index);
+            }
+        }
+
         std::unique_ptr<Importer> imp =
             Importer::create(file->encoding(), import_opts);
         while (BinaryMessage bm = file->read())
         {
+            // Skip the messages that have already been read
+            if (resuming && bm.index <= resume_index)
+                continue;
+
             Item item;
             item.rmsg      = new BinaryMessage(bm);
             item.idx       = bm.index;
@@ -193,6 +193,18 @@ public:
     unsigned count_successes = 0;
     unsigned count_failures  = 0;
 
+    /// Position in the input file list of the file currently being read
+    unsigned file_index = 0;
+
+    /**
+     * If resume_index is not -1, skip all input up to and including the
+     * message with index resume_index, found at resume_offset in the file at
+     * position resume_file in the input file list
+     */
+    unsigned resume_file = 0;
+    int resume_index     = -1;
+    off_t resume_offset  = -1;
+
     Reader(const ReaderOptions& opts);
 
     bool has_fail_file() const;
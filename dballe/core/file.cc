@@ -27,6 +27,16 @@ void File::close()
     }
 }
 
+void File::seek(off_t offset, int index)
+{
+    if (fd == nullptr)
+        throw error_consistency("cannot seek in a closed file");
+    if (fseeko(fd, offset, SEEK_SET) != 0)
+        error_system::throwf("cannot seek %s to offset %lld", m_name.c_str(),
+                             (long long)offset);
+    idx = index;
+}
+
 bool File::foreach (std::function<bool(const BinaryMessage&)> dest)
 {
     while (true)
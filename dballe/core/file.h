@@ -32,6 +32,12 @@ public:
     void close() override;
     bool foreach (std::function<bool(const BinaryMessage&)> dest) override;
 
+    /**
+     * Move the read position to the given offset, which must be the start of
+     * a message, and set the index of the next message read to index
+     */
+    void seek(off_t offset, int index);
+
     /**
      * Resolve the location of a test data file
      *
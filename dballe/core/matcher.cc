@@ -2,8 +2,8 @@
 #include "defs.h"
 #include "query.h"
 #include <cmath>
+#include <cstring>
 #include <iostream>
-#include <vector>
 
 using namespace std;
 using namespace wreport;
@@ -31,6 +31,11 @@ matcher::Result Matched::match_rep_memo(const char* memo) const
 {
     return matcher::MATCH_NA;
 }
+bool Matched::resolve(unsigned,
+                      std::function<void(const matcher::Resolved&)>) const
+{
+    return false;
+}
 
 matcher::Result Matched::int_in_range(int val, int min, int max)
 {
@@ -71,141 +76,191 @@ std::string result_format(Result res)
     return "unknown";
 }
 
-struct And : public Matcher
+static string tolower(const std::string& s)
 {
-    /**
-     * Matchers added to exprs are *owned* and will be deallocated in the
-     * destructor
-     */
-    std::vector<const Matcher*> exprs;
+    string res(s);
+    for (string::iterator i = res.begin(); i != res.end(); ++i)
+        *i = ::tolower(*i);
+    return res;
+}
 
-    virtual ~And()
-    {
-        for (std::vector<const Matcher*>::iterator i = exprs.begin();
-             i != exprs.end(); ++i)
-            delete *i;
-    }
+/**
+ * Matcher with all the constraints of a query resolved at creation time.
+ *
+ * All constraints must match for the item to match, and a constraint that is
+ * not applicable to the item counts as a mismatch. A matcher without
+ * constraints matches everything.
+ *
+ * Items that can be resolved (see Matched::resolve) are checked directly
+ * against the coordinate ranges and packed datetime bounds, without
+ * allocating memory.
+ */
+struct QueryMatcher : public Matcher
+{
+    bool has_ana_id  = false;
+    bool has_block   = false;
+    bool has_dtrange = false;
+    bool has_coords  = false;
+    bool has_rete    = false;
+
+    int ana_id  = MISSING_INT;
+    int block   = MISSING_INT;
+    int station = -1;
+    DatetimeRange dtrange;
+    LatRange latrange;
+    LonRange lonrange;
+    string rete;
 
-    Result match(const Matched& item) const override
-    {
-        if (exprs.empty())
-            return MATCH_YES;
+    /// Datetime bounds, packed with Datetime::to_packed()
+    uint64_t dt_min = 0;
+    uint64_t dt_max = 0;
+    /// Fields that need to be resolved to check the constraints
+    unsigned fields = 0;
 
-        Result res = MATCH_NA;
-        for (std::vector<const Matcher*>::const_iterator i = exprs.begin();
-             i != exprs.end() && res != MATCH_NO; ++i)
+    /// Constraints matched by at least one of the resolved items
+    struct Matches
+    {
+        bool ana_id;
+        bool block;
+        bool dtrange;
+        bool coords;
+        bool rete;
+    };
+
+    QueryMatcher(const core::Query& query)
+    {
+        if (query.ana_id != MISSING_INT)
         {
-            switch ((*i)->match(item))
-            {
-                case MATCH_YES: res = MATCH_YES; break;
-                case MATCH_NO:  res = MATCH_NO; break;
-                case MATCH_NA:  break;
-            }
+            has_ana_id = true;
+            ana_id     = query.ana_id;
         }
-        return res;
-    }
 
-    void to_query(core::Query& query) const override
-    {
-        for (std::vector<const Matcher*>::const_iterator i = exprs.begin();
-             i != exprs.end(); ++i)
-            (*i)->to_query(query);
-    }
-};
-
-struct AnaIDMatcher : public Matcher
-{
-    // Station ID to match
-    int ana_id;
+        if (query.block != MISSING_INT)
+        {
+            has_block = true;
+            block     = query.block;
+            if (query.station != MISSING_INT)
+                station = query.station;
+        }
 
-    AnaIDMatcher(int ana_id) : ana_id(ana_id) {}
+        if (!query.dtrange.is_missing())
+        {
+            has_dtrange = true;
+            dtrange     = query.dtrange;
 
-    Result match(const Matched& v) const override
-    {
-        return v.match_station_id(ana_id) == MATCH_YES ? MATCH_YES : MATCH_NO;
-    }
-    void to_query(core::Query& query) const override { query.ana_id = ana_id; }
-};
+            dt_min = dtrange.min.is_missing() ? 0 : dtrange.min.to_packed();
+            // A missing datetime packs to a value higher than all others
+            dt_max = dtrange.max.to_packed();
+        }
 
-struct WMOMatcher : public Matcher
-{
-    int block;
-    int station;
+        if (!query.latrange.is_missing() || !query.lonrange.is_missing())
+        {
+            has_coords = true;
+            latrange   = query.latrange;
+            lonrange   = query.lonrange;
+        }
 
-    WMOMatcher(int block, int station = -1) : block(block), station(station) {}
+        if (!query.report.empty())
+        {
+            has_rete = true;
+            rete     = tolower(query.report);
+        }
 
-    Result match(const Matched& v) const override
-    {
-        return v.match_station_wmo(block, station) == MATCH_YES ? MATCH_YES
-                                                                : MATCH_NO;
+        if (has_ana_id)
+            fields |= Resolved::STATION_ID;
+        if (has_block)
+            fields |= Resolved::WMO;
+        if (has_dtrange)
+            fields |= Resolved::DATETIME;
+        if (has_coords)
+            fields |= Resolved::COORDS;
+        if (has_rete)
+            fields |= Resolved::REPORT;
     }
-    void to_query(core::Query& query) const override
+
+    bool match_wmo(int item_block, int item_station) const
     {
-        query.block = block;
-        if (station != -1)
-            query.station = station;
-        else
-            query.station = MISSING_INT;
+        return item_block == block &&
+               (station == -1 || item_station == station);
     }
-};
 
-struct DateMatcher : public Matcher
-{
-    DatetimeRange range;
-
-    DateMatcher(const DatetimeRange& range) : range(range) {}
-
-    Result match(const Matched& v) const override
+    bool match_report(const char* report) const
     {
-        return v.match_datetime(range) == MATCH_YES ? MATCH_YES : MATCH_NO;
+        return report && strcmp(report, rete.c_str()) == 0;
     }
 
-    void to_query(core::Query& query) const override { query.dtrange = range; }
-};
-
-struct CoordMatcher : public Matcher
-{
-    LatRange latrange;
-    LonRange lonrange;
-
-    CoordMatcher(const LatRange& latrange, const LonRange& lonrange)
-        : latrange(latrange), lonrange(lonrange)
+    bool match_coords(const Coords& coords) const
     {
+        if (coords.is_missing())
+            return false;
+        return latrange.contains(coords.lat) && lonrange.contains(coords.lon);
     }
 
-    Result match(const Matched& v) const override
+    bool match_datetime(const Datetime& dt) const
     {
-        return v.match_coords(latrange, lonrange) == MATCH_YES ? MATCH_YES
-                                                               : MATCH_NO;
+        if (dt.is_missing())
+            return false;
+        uint64_t packed = dt.to_packed();
+        return dt_min <= packed && packed <= dt_max;
     }
 
-    void to_query(core::Query& query) const override
+    void match_resolved(const Resolved& r, Matches& m) const
     {
-        query.latrange = latrange;
-        query.lonrange = lonrange;
+        m.ana_id  = m.ana_id || r.station_id == ana_id;
+        m.block   = m.block || match_wmo(r.block, r.station);
+        m.dtrange = m.dtrange || match_datetime(r.datetime);
+        m.coords  = m.coords || match_coords(r.coords);
+        m.rete    = m.rete || match_report(r.report);
     }
-};
 
-static string tolower(const std::string& s)
-{
-    string res(s);
-    for (string::iterator i = res.begin(); i != res.end(); ++i)
-        *i = ::tolower(*i);
-    return res;
-}
+    Result match(const Matched& v) const override
+    {
+        if (!fields)
+            return MATCH_YES;
 
-struct ReteMatcher : public Matcher
-{
-    string rete;
+        // Each constraint needs to match at least one of the items
+        Matches m{!has_ana_id, !has_block, !has_dtrange, !has_coords,
+                  !has_rete};
+        if (v.resolve(fields,
+                      [this, &m](const Resolved& r) { match_resolved(r, m); }))
+        {
+            if (m.ana_id && m.block && m.dtrange && m.coords && m.rete)
+                return MATCH_YES;
+            return MATCH_NO;
+        }
 
-    ReteMatcher(const std::string& rete) : rete(tolower(rete)) {}
+        if (has_ana_id && v.match_station_id(ana_id) != MATCH_YES)
+            return MATCH_NO;
+        if (has_block && v.match_station_wmo(block, station) != MATCH_YES)
+            return MATCH_NO;
+        if (has_dtrange && v.match_datetime(dtrange) != MATCH_YES)
+            return MATCH_NO;
+        if (has_coords && v.match_coords(latrange, lonrange) != MATCH_YES)
+            return MATCH_NO;
+        if (has_rete && v.match_rep_memo(rete.c_str()) != MATCH_YES)
+            return MATCH_NO;
+        return MATCH_YES;
+    }
 
-    Result match(const Matched& v) const override
+    void to_query(core::Query& query) const override
     {
-        return v.match_rep_memo(rete.c_str()) == MATCH_YES ? MATCH_YES
-                                                           : MATCH_NO;
+        if (has_ana_id)
+            query.ana_id = ana_id;
+        if (has_block)
+        {
+            query.block   = block;
+            query.station = station != -1 ? station : MISSING_INT;
+        }
+        if (has_dtrange)
+            query.dtrange = dtrange;
+        if (has_coords)
+        {
+            query.latrange = latrange;
+            query.lonrange = lonrange;
+        }
+        if (has_rete)
+            query.report = rete;
     }
-    void to_query(core::Query& query) const override { query.report = rete; }
 };
 
 } // namespace matcher
@@ -215,29 +270,7 @@ std::unique_ptr<Matcher> Matcher::create(const dballe::Query& query_gen)
     using namespace matcher;
     const core::Query& query = core::Query::downcast(query_gen);
 
-    std::unique_ptr<And> res(new And);
-
-    if (query.ana_id != MISSING_INT)
-        res->exprs.push_back(new AnaIDMatcher(query.ana_id));
-
-    if (query.block != MISSING_INT)
-    {
-        if (query.station != MISSING_INT)
-            res->exprs.push_back(new WMOMatcher(query.block, query.station));
-        else
-            res->exprs.push_back(new WMOMatcher(query.block));
-    }
-
-    if (!query.dtrange.is_missing())
-        res->exprs.push_back(new DateMatcher(query.dtrange));
-
-    if (!query.latrange.is_missing() || !query.lonrange.is_missing())
-        res->exprs.push_back(new CoordMatcher(query.latrange, query.lonrange));
-
-    if (!query.report.empty())
-        res->exprs.push_back(new ReteMatcher(query.report));
-
-    return unique_ptr<Matcher>(res.release());
+    return std::unique_ptr<Matcher>(new QueryMatcher(query));
 }
 
 } // namespace dballe
@@ -3,6 +3,7 @@
 
 #include <dballe/core/fwd.h>
 #include <dballe/types.h>
+#include <functional>
 #include <memory>
 
 namespace dballe {
@@ -17,6 +18,31 @@ enum Result {
 /// Format a Result into a string
 std::string result_format(Result res);
 
+/**
+ * Station and datetime information of an item to match, read once so that
+ * all the constraints of a query can be checked on it without further lookups
+ */
+struct Resolved
+{
+    /// Flags selecting the fields to resolve
+    static constexpr unsigned STATION_ID = 1 << 0;
+    static constexpr unsigned WMO        = 1 << 1;
+    static constexpr unsigned COORDS     = 1 << 2;
+    static constexpr unsigned DATETIME   = 1 << 3;
+    static constexpr unsigned REPORT     = 1 << 4;
+
+    /// Station ID (B01192), or MISSING_INT
+    int station_id = MISSING_INT;
+    /// WMO block number (B01001), or MISSING_INT
+    int block      = MISSING_INT;
+    /// WMO station number (B01002), or MISSING_INT
+    int station    = MISSING_INT;
+    Coords coords;
+    Datetime datetime;
+    /// Report name, or nullptr
+    const char* report = nullptr;
+};
+
 } // namespace matcher
 
 /**
@@ -71,6 +97,21 @@ struct Matched
      */
     virtual matcher::Result match_rep_memo(const char* memo) const;
 
+    /**
+     * Call dest with the station and datetime information of the items to
+     * match, once for each item.
+     *
+     * fields is a bitmask of matcher::Resolved flags: only the fields it
+     * selects are read, and the others are left unset.
+     *
+     * A constraint matches if it matches at least one of the items. Returns
+     * false if the item cannot be resolved, and needs to be matched with the
+     * match_* methods.
+     */
+    virtual bool
+    resolve(unsigned fields,
+            std::function<void(const matcher::Resolved&)> dest) const;
+
     /**
      * Match if min <= val <= max
      *
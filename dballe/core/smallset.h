@@ -96,21 +96,7 @@ struct SmallSet
         }
 
         // Use binary search for larger vectors
-
-        if (dirty > 16)
-        {
-            std::sort(items.begin(), items.end(),
-                      [](const Item& a, const Item& b) {
-                          return get_value(a) < get_value(b);
-                      });
-            dirty = 0;
-        }
-        else if (dirty)
-        {
-            // Use insertion sort, if less than 16 new elements appeared since
-            // the last sort
-            rearrange_dirty();
-        }
+        sort();
 
         int pos = binary_search(value);
         if (pos == -1)
@@ -134,7 +120,18 @@ struct SmallSet
         }
 
         // Use binary search for larger vectors
+        sort();
 
+        int pos = binary_search(value);
+        if (pos == -1)
+            return items.end();
+        else
+            return items.begin() + pos;
+    }
+
+    /// Sort the items by value, so that iteration follows value order
+    void sort() const
+    {
         if (dirty > 16)
         {
             std::sort(items.begin(), items.end(),
@@ -149,12 +146,6 @@ struct SmallSet
             // the last sort
             rearrange_dirty();
         }
-
-        int pos = binary_search(value);
-        if (pos == -1)
-            return items.end();
-        else
-            return items.begin() + pos;
     }
 
     Item& add(const Item& item)
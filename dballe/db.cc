@@ -1,6 +1,7 @@
 #include "db.h"
 #include "core/string.h"
 #include "db/db.h"
+#include "db/v7/db.h"
 #include "sql/sql.h"
 #include "wreport/utils/string.h"
 #include <cstdlib>
@@ -32,6 +33,18 @@ static bool parse_wipe(const std::string& strval)
         strval.c_str());
 }
 
+static unsigned parse_readonly_pool(const std::string& strval)
+{
+    char* end;
+    unsigned long val = strtoul(strval.c_str(), &end, 10);
+    if (strval.empty() || *end || val > 1000)
+        wreport::error_consistency::throwf(
+            "unsupported value for readonly_pool: '%s' (supported: a number "
+            "of connections between 0 and 1000)",
+            strval.c_str());
+    return val;
+}
+
 void DBConnectOptions::reset_actions() { wipe = false; }
 
 std::unique_ptr<DBConnectOptions>
@@ -46,6 +59,10 @@ DBConnectOptions::create(const std::string& url)
     else
         res->wipe = false;
 
+    std::string readonly_pool;
+    if (url_pop_query_string(res->url, "readonly_pool", readonly_pool))
+        res->readonly_pool = parse_readonly_pool(readonly_pool);
+
     if (strncmp(url.c_str(), "test:", 5) == 0)
     {
         const char* envurl = getenv("DBA_DB");
@@ -124,6 +141,11 @@ std::shared_ptr<DB> DB::connect(const DBConnectOptions& opts)
         auto res = db::DB::create(conn);
         if (opts.wipe)
             res->reset();
+        if (opts.readonly_pool)
+        {
+            if (auto v7db = std::dynamic_pointer_cast<db::v7::DB>(res))
+                v7db->set_readonly_pool_size(opts.readonly_pool);
+        }
         return res;
     }
 }
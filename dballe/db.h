@@ -27,6 +27,12 @@ public:
     /// Wipe database on connection
     bool wipe = false;
 
+    /**
+     * Maximum number of extra connections used to run read-only transactions
+     * concurrently. 0 (default) runs them on the main connection.
+     */
+    unsigned readonly_pool = 0;
+
     /**
      * Disable all the one-off actions set to perform on connection.
      *
@@ -134,6 +140,19 @@ public:
      */
     bool can_add_stations = true;
 
+    /**
+     * If true, insert_data can queue the values and write them later, together
+     * with the values of following insert_data calls, to speed up inserting
+     * one record at a time.
+     *
+     * Queued values are written when enough of them accumulate, before any
+     * other operation of the transaction, and on commit. Database IDs of
+     * queued values are not known at the end of insert_data: the station ID
+     * and value IDs in the inserted data are left unset, and can be looked up
+     * later with db::Transaction::resolve_data_ids().
+     */
+    bool defer = false;
+
     static std::unique_ptr<DBInsertOptions> create();
 
     static const DBInsertOptions defaults;
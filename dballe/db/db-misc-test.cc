@@ -1,8 +1,13 @@
 #include "config.h"
+#include "dballe/db/summary_memory.h"
 #include "dballe/db/tests.h"
+#include "dballe/sql/sql.h"
 #include "v7/db.h"
+#include "v7/levtr.h"
+#include "v7/pool.h"
 #include "v7/transaction.h"
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
 
 using namespace dballe;
@@ -364,6 +369,112 @@ template <typename DB> void Tests<DB>::register_tests()
         wassert(actual(cur->next()).isfalse());
     });
 
+    this->add_method("query_last_multiple_vars", [](Fixture& f) {
+        // query=last picks the most recent value independently for each
+        // variable
+        if (f.db->conn->server_type == sql::ServerType::MYSQL)
+            throw TestSkipped();
+
+        core::Data vals;
+        vals.station.coords = Coords(12.077, 44.600);
+        vals.station.report = "synop";
+        vals.level          = Level(103, 2000);
+        vals.trange         = Trange::instant();
+        vals.datetime       = Datetime(2014, 1, 1, 0, 0, 0);
+        vals.values.set("B12101", 273.15);
+        vals.values.set("B12103", 253.15);
+        f.tr->insert_data(vals);
+
+        vals.clear_ids();
+        vals.values.clear();
+        vals.datetime = Datetime(2014, 1, 2, 0, 0, 0);
+        vals.values.set("B12101", 274.15);
+        f.tr->insert_data(vals);
+
+        core::Query query;
+        query.query = "last";
+        auto cur    = f.tr->query_data(query);
+        wassert(actual(cur->remaining()) == 2);
+
+        wassert(actual(cur->next()).istrue());
+        wassert(actual(cur->get_varcode()) == WR_VAR(0, 12, 103));
+        wassert(actual(cur->get_datetime()) == Datetime(2014, 1, 1, 0, 0, 0));
+        wassert(actual(cur->get_var()) == 253.15);
+
+        wassert(actual(cur->next()).istrue());
+        wassert(actual(cur->get_varcode()) == WR_VAR(0, 12, 101));
+        wassert(actual(cur->get_datetime()) == Datetime(2014, 1, 2, 0, 0, 0));
+        wassert(actual(cur->get_var()) == 274.15);
+
+        wassert(actual(cur->next()).isfalse());
+    });
+
+    this->add_method("query_best_multiple_vars", [](Fixture& f) {
+        // query=best picks the value with the highest priority independently
+        // for each variable
+        if (f.db->conn->server_type == sql::ServerType::MYSQL)
+            throw TestSkipped();
+
+        core::Data vals;
+        vals.station.coords = Coords(12.077, 44.600);
+        vals.station.report = "synop";
+        vals.level          = Level(103, 2000);
+        vals.trange         = Trange::instant();
+        vals.datetime       = Datetime(2014, 1, 1, 0, 0, 0);
+        vals.values.set("B12101", 273.15);
+        vals.values.set("B12103", 253.15);
+        f.tr->insert_data(vals);
+
+        // generic has a higher priority than synop
+        vals.clear_ids();
+        vals.values.clear();
+        vals.station.report = "generic";
+        vals.values.set("B12101", 274.15);
+        f.tr->insert_data(vals);
+
+        core::Query query;
+        query.query = "best";
+        auto cur    = f.tr->query_data(query);
+        wassert(actual(cur->remaining()) == 2);
+        std::map<wreport::Varcode, std::string> found;
+        while (cur->next())
+            found[cur->get_varcode()] = cur->get_station().report;
+        wassert(actual(found[WR_VAR(0, 12, 101)]) == "generic");
+        wassert(actual(found[WR_VAR(0, 12, 103)]) == "synop");
+    });
+
+    this->add_method("query_best_same_priority", [](Fixture& f) {
+        // With the same priority, query=best picks the value of the report
+        // with the lowest ID
+        if (f.db->conn->server_type == sql::ServerType::MYSQL)
+            throw TestSkipped();
+
+        core::Data vals;
+        vals.station.coords = Coords(12.077, 44.600);
+        vals.station.report = "generic";
+        vals.level          = Level(103, 2000);
+        vals.trange         = Trange::instant();
+        vals.datetime       = Datetime(2014, 1, 1, 0, 0, 0);
+        vals.values.set("B12101", 274.15);
+        f.tr->insert_data(vals);
+
+        vals.clear_ids();
+        vals.station.report = "synop";
+        vals.values.set("B12101", 273.15);
+        f.tr->insert_data(vals);
+
+        f.tr->conn->execute("UPDATE repinfo SET prio=101 WHERE memo='generic'");
+        f.tr->repinfo().read_cache();
+
+        core::Query query;
+        query.query = "best";
+        auto cur    = f.tr->query_data(query);
+        wassert(actual(cur->remaining()) == 1);
+        wassert_true(cur->next());
+        wassert(actual(cur->get_station().report) == "synop");
+        wassert(actual(cur->get_var()) == 273.15);
+    });
+
     this->add_method("delete", [](Fixture& f) {
         // Test deletion
         OldDballeTestDataSet oldf;
@@ -445,6 +556,174 @@ template <typename DB> void Tests<DB>::register_tests()
         wassert(actual(cur->remaining()) == 4);
         cur->discard();
     });
+    this->add_method("delete_attr_filter", [](Fixture& f) {
+        // Delete only the values whose attributes match attr_filter
+        core::Data vals;
+        vals.station.coords = Coords(12.077, 44.600);
+        vals.station.report = "synop";
+        vals.level          = Level(103, 2000);
+        vals.trange         = Trange::instant();
+        vals.datetime       = Datetime(2014, 1, 1, 0, 0, 0);
+        vals.values.set("B12101", 273.15);
+        vals.values.set("B12103", 253.15);
+        f.tr->insert_data(vals);
+
+        Values attrs;
+        attrs.set("B33007", 30);
+        f.tr->attr_insert_data(vals.values.value("B12101").data_id, attrs);
+        attrs.set("B33007", 80);
+        f.tr->attr_insert_data(vals.values.value("B12103").data_id, attrs);
+
+        core::Query query;
+        query.attr_filter = "B33007>50";
+        f.tr->remove_data(query);
+
+        auto cur = f.tr->query_data(core::Query());
+        wassert(actual(cur->remaining()) == 1);
+        wassert(actual(cur->next()).istrue());
+        wassert(actual(cur->get_varcode()) == WR_VAR(0, 12, 101));
+    });
+    this->add_method("query_attrs_prefetch", [](Fixture& f) {
+        // Attributes not loaded by the query are read a window at a time
+        core::Data vals;
+        vals.station.coords = Coords(12.077, 44.600);
+        vals.station.report = "synop";
+        vals.level          = Level(103, 2000);
+        vals.trange         = Trange::instant();
+        vals.datetime       = Datetime(2014, 1, 1, 0, 0, 0);
+        vals.values.set("B12101", 273.15);
+        vals.values.set("B12103", 253.15);
+        vals.values.set("B13003", 80);
+        f.tr->insert_data(vals);
+
+        Values attrs;
+        attrs.set("B33007", 30);
+        f.tr->attr_insert_data(vals.values.value("B12101").data_id, attrs);
+        attrs.set("B33007", 40);
+        int id_b12103 = vals.values.value("B12103").data_id;
+        f.tr->attr_insert_data(id_b12103, attrs);
+
+        auto read_attrs = [](dballe::CursorData& c) {
+            Values res;
+            dynamic_cast<db::CursorData&>(c).query_attrs(
+                [&](std::unique_ptr<wreport::Var> var) {
+                    res.set(std::move(var));
+                },
+                false);
+            return res;
+        };
+
+        core::Query query;
+        query.varcodes.insert(WR_VAR(0, 12, 101));
+        query.varcodes.insert(WR_VAR(0, 12, 103));
+        query.varcodes.insert(WR_VAR(0, 13, 3));
+        auto cur = f.tr->query_data(query);
+        wassert(actual(cur->remaining()) == 3);
+
+        wassert(actual(cur->next()).istrue());
+        wassert(actual(cur->get_varcode()) == WR_VAR(0, 12, 101));
+        wassert(actual(read_attrs(*cur).enq("B33007", 0)) == 30);
+
+        // Changes made while iterating are seen by the cursor
+        attrs.set("B33007", 50);
+        f.tr->attr_insert_data(id_b12103, attrs);
+
+        wassert(actual(cur->next()).istrue());
+        wassert(actual(cur->get_varcode()) == WR_VAR(0, 12, 103));
+        wassert(actual(read_attrs(*cur).enq("B33007", 0)) == 50);
+
+        wassert(actual(cur->next()).istrue());
+        wassert(actual(cur->get_varcode()) == WR_VAR(0, 13, 3));
+        wassert(actual(read_attrs(*cur).size()) == 0u);
+    });
+    this->add_method("query_attrs_lazy", [](Fixture& f) {
+        // Attributes loaded by the query are decoded when they are accessed
+        core::Data vals;
+        vals.station.coords = Coords(12.077, 44.600);
+        vals.station.report = "synop";
+        vals.level          = Level(103, 2000);
+        vals.trange         = Trange::instant();
+        vals.datetime       = Datetime(2014, 1, 1, 0, 0, 0);
+        vals.values.set("B12101", 273.15);
+        vals.values.set("B12103", 253.15);
+        f.tr->insert_data(vals);
+
+        Values attrs;
+        attrs.set("B33007", 30);
+        f.tr->attr_insert_data(vals.values.value("B12101").data_id, attrs);
+        attrs.set("B33007", 40);
+        f.tr->attr_insert_data(vals.values.value("B12103").data_id, attrs);
+
+        core::Query query;
+        query.query = "attrs";
+        auto cur    = f.tr->query_data(query);
+        wassert(actual(cur->remaining()) == 2);
+
+        wassert(actual(cur->next()).istrue());
+        Values res;
+        dynamic_cast<db::CursorData&>(*cur).query_attrs(
+            [&](std::unique_ptr<wreport::Var> var) {
+                res.set(std::move(var));
+            },
+            false);
+        wassert(actual(res.enq("B33007", 0)) == 30);
+        wassert(actual(cur->get_var().enqa(WR_VAR(0, 33, 7))->enqi()) == 30);
+
+        wassert(actual(cur->next()).istrue());
+        wassert(actual(cur->get_var().enqa(WR_VAR(0, 33, 7))->enqi()) == 40);
+
+        // attr_filter matches the encoded attributes
+        query.attr_filter = "B33007>35";
+        cur               = f.tr->query_data(query);
+        wassert(actual(cur->remaining()) == 1);
+        wassert(actual(cur->next()).istrue());
+        wassert(actual(cur->get_varcode()) == WR_VAR(0, 12, 103));
+    });
+    this->add_method("delete_partitions", [](Fixture& f) {
+        // Removing a datetime range drops the partitions it covers
+        if (f.db->conn->server_type != sql::ServerType::POSTGRES)
+            throw TestSkipped();
+
+        f.tr->rollback();
+        f.tr.reset();
+        setenv("DBA_DB_PARTITION", "monthly", 1);
+        wassert(f.db->reset());
+        unsetenv("DBA_DB_PARTITION");
+        wassert(actual(f.db->conn->get_setting("partitioning")) == "monthly");
+
+        auto tr = dynamic_pointer_cast<db::Transaction>(f.db->transaction());
+        core::Data vals;
+        vals.station.coords = Coords(12.077, 44.600);
+        vals.station.report = "synop";
+        vals.level          = Level(103, 2000);
+        vals.trange         = Trange::instant();
+        vals.values.set("B12101", 273.15);
+        vals.datetime = Datetime(2014, 1, 15, 12, 0, 0);
+        tr->insert_data(vals);
+        vals.clear_ids();
+        vals.datetime = Datetime(2014, 2, 15, 12, 0, 0);
+        tr->insert_data(vals);
+        wassert(actual(f.db->conn->has_table("data_p2014_01")).istrue());
+        wassert(actual(f.db->conn->has_table("data_p2014_02")).istrue());
+
+        core::Query query;
+        query.dtrange = DatetimeRange(Datetime(2014, 1, 1),
+                                      Datetime(2014, 1, 31, 23, 59, 59));
+        tr->remove_data(query);
+        wassert(actual(f.db->conn->has_table("data_p2014_01")).isfalse());
+        wassert(actual(f.db->conn->has_table("data_p2014_02")).istrue());
+
+        // Ranges that do not cover a whole partition delete single values
+        query.dtrange =
+            DatetimeRange(Datetime(2014, 2, 1), Datetime(2014, 2, 20));
+        tr->remove_data(query);
+        wassert(actual(f.db->conn->has_table("data_p2014_02")).istrue());
+        wassert(actual(tr->query_data(core::Query())->remaining()) == 0);
+        tr->rollback();
+
+        wassert(f.db->reset());
+        f.tr = dynamic_pointer_cast<typename DB::TR>(f.db->test_transaction());
+    });
     this->add_method("query_datetime", [](Fixture& f) {
         // Test datetime queries
         /* Prepare test data */
@@ -962,6 +1241,71 @@ template <typename DB> void Tests<DB>::register_tests()
         wassert(actual(reports[0]) == "metar");
         wassert(actual(reports[1]) == "synop");
     });
+    this->add_method("sync_stations", [](Fixture& f) {
+        std::vector<db::StationRecord> stations(2);
+        stations[0].station.report = "synop";
+        stations[0].station.coords = Coords(44.5008, 11.3288);
+        stations[0].values.set("B07030", 78);
+        stations[0].values.set("B01019", "Navile");
+        stations[1].station.report = "metar";
+        stations[1].station.coords = Coords(45.0, 12.0);
+        stations[1].values.set("B07030", 10);
+
+        auto stats = f.tr->sync_stations(stations);
+        wassert(actual(stats.stations_added) == 2u);
+        wassert(actual(stats.values_added) == 3u);
+        wassert(actual(stations[0].station.id) != MISSING_INT);
+        wassert(actual(stations[0].values.value("B07030").data_id) !=
+                MISSING_INT);
+
+        // Change a value, leave out another, and sync again
+        stations[0].values.set("B07030", 80);
+        stations[0].values.unset(WR_VAR(0, 1, 19));
+        stats = f.tr->sync_stations(stations, true);
+        wassert(actual(stats.stations_added) == 0u);
+        wassert(actual(stats.values_added) == 0u);
+        wassert(actual(stats.values_updated) == 1u);
+        wassert(actual(stats.values_unchanged) == 1u);
+        wassert(actual(stats.values_removed) == 1u);
+
+        // Listing a station twice is an error
+        std::vector<db::StationRecord> twice(2, stations[1]);
+        wassert_throws(wreport::error_consistency,
+                       f.tr->sync_stations(twice));
+
+        auto dumped = f.tr->dump_stations(core::Query());
+        wassert(actual(dumped.size()) == 2u);
+        for (const auto& rec : dumped)
+        {
+            wassert(actual(rec.values.size()) == 1u);
+            if (rec.station.report == "synop")
+                wassert(actual(rec.values.var("B07030").enqi()) == 80);
+            else
+                wassert(actual(rec.values.var("B07030").enqi()) == 10);
+        }
+
+        // Update a value in a station and add one to another: the updated
+        // value keeps its ID, and the new value gets one
+        int updated_id = stations[0].values.value("B07030").data_id;
+        stations[0].values.set("B07030", 82);
+        stations[1].values.set("B01019", "Mare");
+        stats = f.tr->sync_stations(stations);
+        wassert(actual(stats.values_added) == 1u);
+        wassert(actual(stats.values_updated) == 1u);
+        wassert(actual(stats.values_unchanged) == 1u);
+        wassert(actual(stations[0].values.value("B07030").data_id) ==
+                updated_id);
+        wassert(actual(stations[1].values.value("B01019").data_id) !=
+                MISSING_INT);
+        dumped = f.tr->dump_stations(core::Query());
+        for (const auto& rec : dumped)
+        {
+            if (rec.station.report == "synop")
+                wassert(actual(rec.values.var("B07030").enqi()) == 82);
+            else
+                wassert(actual(rec.values.var("B01019").enqs()) == "Mare");
+        }
+    });
     this->add_method("insert_undefined_level2", [](Fixture& f) {
         // Test handling of values with undefined leveltype2 and l2
         OldDballeTestDataSet oldf;
@@ -1127,6 +1471,124 @@ template <typename DB> void CommitTests<DB>::register_tests()
             wassert(db->insert_station_data(vals, opts));
         }
     });
+    this->add_method("readonly_pool", [](Fixture& f) {
+        // Read-only transactions use separate connections from the pool
+        core::Data vals;
+        vals.station.coords = Coords(12.077, 44.600);
+        vals.station.report = "synop";
+        vals.level          = Level(103, 2000);
+        vals.trange         = Trange::instant();
+        vals.datetime       = Datetime(2014, 1, 1, 0, 0, 0);
+        vals.values.set("B12101", 273.15);
+        wassert(f.db->insert_data(vals));
+
+        f.db->set_readonly_pool_size(2);
+        {
+            auto tr1 = dynamic_pointer_cast<typename DB::TR>(
+                f.db->transaction(true));
+            auto tr2 = dynamic_pointer_cast<typename DB::TR>(
+                f.db->transaction(true));
+            wassert(actual(tr1->conn != f.db->conn).istrue());
+            wassert(actual(tr2->conn != f.db->conn).istrue());
+            wassert(actual(tr1->conn != tr2->conn).istrue());
+            wassert(actual(tr1->query_data(core::Query())->remaining()) == 1);
+            wassert(actual(tr2->query_data(core::Query())->remaining()) == 1);
+            tr1->rollback();
+            tr2->rollback();
+        }
+
+        // Released connections are reused
+        {
+            auto tr = dynamic_pointer_cast<typename DB::TR>(
+                f.db->transaction(true));
+            wassert(actual((bool)tr->pooled).istrue());
+            wassert(actual(tr->query_data(core::Query())->remaining()) == 1);
+        }
+
+        // Read-write transactions keep using the main connection
+        {
+            auto tr =
+                dynamic_pointer_cast<typename DB::TR>(f.db->transaction());
+            wassert(actual(tr->conn == f.db->conn).istrue());
+        }
+        f.db->set_readonly_pool_size(0);
+    });
+    this->add_method("levtr_shared_cache", [](Fixture& f) {
+        // Committed levtr entries are shared with later transactions
+        db::v7::Tracer<> trc;
+        db::v7::LevTrEntry committed(Level(103, 2000), Trange::instant());
+        db::v7::LevTrEntry discarded(Level(103, 2500), Trange::instant());
+        int id;
+        {
+            auto tr =
+                dynamic_pointer_cast<typename DB::TR>(f.db->transaction());
+            id = tr->levtr().obtain_id(trc, committed);
+            tr->commit();
+        }
+        wassert(actual(f.db->levtr_cache.is_loaded()).istrue());
+        wassert(actual(f.db->levtr_cache.find_id(committed)) == id);
+
+        // Entries created by a rolled back transaction are not shared
+        {
+            auto tr =
+                dynamic_pointer_cast<typename DB::TR>(f.db->transaction());
+            wassert(actual(tr->levtr().obtain_id(trc, committed)) == id);
+            tr->levtr().obtain_id(trc, discarded);
+            tr->rollback();
+        }
+        wassert(actual(f.db->levtr_cache.find_id(discarded)) == MISSING_INT);
+
+        // Removing all data invalidates the cache
+        {
+            auto tr =
+                dynamic_pointer_cast<typename DB::TR>(f.db->transaction());
+            tr->remove_all();
+            tr->commit();
+        }
+        wassert(actual(f.db->levtr_cache.is_loaded()).isfalse());
+        wassert(f.db->vacuum());
+        wassert(actual(f.db->levtr_cache.is_loaded()).isfalse());
+    });
+    this->add_method("summary_sharded", [](Fixture& f) {
+        // Summary queries split by station give the same results
+        core::Data vals;
+        vals.station.report = "synop";
+        vals.level          = Level(103, 2000);
+        vals.trange         = Trange::instant();
+        for (int i = 0; i < 5; ++i)
+        {
+            vals.clear_ids();
+            vals.station.coords = Coords(44.0 + i, 11.0);
+            vals.datetime       = Datetime(2014, 1, 1 + i, 0, 0, 0);
+            vals.values.set("B12101", 273.15 + i);
+            wassert(f.db->insert_data(vals));
+        }
+
+        auto summarise = [&](unsigned shards) {
+            db::DBSummaryMemory summary;
+            core::Query query;
+            query.query = "details";
+            unsigned calls = 0;
+            f.db->query_summary_sharded(query, shards,
+                                        [&](dballe::CursorSummary& cur) {
+                                            ++calls;
+                                            while (cur.next())
+                                                summary.add_cursor(cur);
+                                        });
+            wassert(actual(summary.data_count()) == 5u);
+            wassert(actual(summary.datetime_min()) == Datetime(2014, 1, 1));
+            wassert(actual(summary.datetime_max()) == Datetime(2014, 1, 5));
+            return calls;
+        };
+
+        // Without a pool, the query runs in one go
+        wassert(actual(summarise(3)) == 1u);
+
+        f.db->set_readonly_pool_size(2);
+        wassert(actual(summarise(3)) == 3u);
+        wassert(actual(summarise(1)) == 1u);
+        f.db->set_readonly_pool_size(0);
+    });
 }
 
 } // namespace
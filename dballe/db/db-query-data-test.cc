@@ -1,5 +1,6 @@
 #include "config.h"
 #include "dballe/db/tests.h"
+#include "dballe/db/v7/cursor.h"
 #include "dballe/db/v7/db.h"
 #include "dballe/db/v7/transaction.h"
 
@@ -639,6 +640,46 @@ template <typename DB> void EmptyFixtureTests<DB>::register_tests()
                     Result{5, "conflict", "Conflict"}
         });
     });
+
+    this->add_method("station_table", [](Fixture& f) {
+        // Rows of the same station share one entry of the station table
+        for (int hour = 0; hour < 4; ++hour)
+        {
+            for (const char* station :
+                 {"lat=10, lon=20, rep_memo=synop",
+                  "lat=11, lon=21, ident=ship, rep_memo=ship"})
+            {
+                core::Data data;
+                data.set_from_test_string(
+                    std::string(station) + ", year=2000, hour=" +
+                    std::to_string(hour) +
+                    ", leveltype1=1, pindicator=1, B12101=280.15");
+                wassert(f.tr->insert_data(data));
+            }
+        }
+
+        auto cur = v7::cursor::Data::downcast(f.tr->query_data(core::Query()));
+        wassert(actual(cur->remaining()) == 8);
+        wassert(actual(cur->stations.stations.size()) == 2u);
+        unsigned count = 0;
+        while (cur->next())
+        {
+            DBStation station = cur->get_station();
+            if (station.ident.is_missing())
+            {
+                wassert(actual((std::string)station.report) == "synop");
+                wassert(actual(station.coords.dlat()) == 10.0);
+            }
+            else
+            {
+                wassert(actual((std::string)station.report) == "ship");
+                wassert(actual(station.ident.get()) == "ship");
+                wassert(actual(station.coords.dlat()) == 11.0);
+            }
+            ++count;
+        }
+        wassert(actual(count) == 8u);
+    });
 }
 
 } // namespace
@@ -8,6 +8,8 @@
 #include <dballe/fwd.h>
 #include <dballe/msg/fwd.h>
 #include <dballe/sql/fwd.h>
+#include <dballe/types.h>
+#include <dballe/values.h>
 #include <functional>
 #include <memory>
 #include <string>
@@ -152,6 +154,23 @@ struct CursorSummary : public impl::CursorSummary
     virtual unsigned test_iterate(FILE* dump = 0) = 0;
 };
 
+/// A station with its station values, used by bulk station operations
+struct StationRecord
+{
+    DBStation station;
+    DBValues values;
+};
+
+/// Counts of the changes made by Transaction::sync_stations
+struct StationSyncStats
+{
+    unsigned stations_added   = 0;
+    unsigned values_added     = 0;
+    unsigned values_updated   = 0;
+    unsigned values_unchanged = 0;
+    unsigned values_removed   = 0;
+};
+
 class Transaction : public dballe::Transaction
 {
 public:
@@ -166,6 +185,51 @@ public:
      */
     virtual void clear_cached_state() = 0;
 
+    /**
+     * Fill the station ID and the value IDs of data previously inserted with
+     * insert_data, looking them up if they are not known yet.
+     *
+     * This is used to find out the IDs of values inserted with
+     * DBInsertOptions::defer, and writes out all queued values.
+     */
+    virtual void resolve_data_ids(dballe::Data& vals) = 0;
+
+    /**
+     * Read the stations matching query, each with all its station values.
+     *
+     * All the station values are read with a single query. Attributes are
+     * not read.
+     */
+    virtual std::vector<StationRecord> dump_stations(const Query& query) = 0;
+
+    /**
+     * Bring the station values in the database in line with the given list
+     * of stations.
+     *
+     * The list is compared with the contents of the database in a single
+     * pass. Values that are different in the database are updated together
+     * for all stations. Stations that do not exist and values that are
+     * missing in the database are still written one station at a time, since
+     * they need the ID of their station. Values that are already the same in
+     * the database are not touched.
+     *
+     * Stations are identified by report, coordinates and identifier, and
+     * each station can appear only once in the list. Attributes are not
+     * compared, and are written only with values that are added or changed.
+     *
+     * The station IDs and value IDs are filled in stations.
+     *
+     * @param stations
+     *   The stations to synchronise, with their station values
+     * @param remove_missing
+     *   If true, also remove the station values of the given stations that
+     *   are not in their list. Stations not in the list are never touched.
+     * @return
+     *   Counts of the changes made to the database
+     */
+    virtual StationSyncStats sync_stations(std::vector<StationRecord>& stations,
+                                           bool remove_missing = false) = 0;
+
     /**
      * Query attributes on a station value
      *
@@ -342,6 +406,17 @@ public:
      */
     virtual void vacuum() = 0;
 
+    /**
+     * Run a summary query split by station into \a shards parts, which run
+     * concurrently when read-only transactions use a pool of connections.
+     *
+     * dest is called once for each part, with a cursor on its results. Calls
+     * do not overlap, but they can come from different threads.
+     */
+    virtual void
+    query_summary_sharded(const Query& query, unsigned shards,
+                          std::function<void(dballe::CursorSummary&)> dest) = 0;
+
     /**
      * Query attributes on a station value
      *
@@ -181,6 +181,17 @@ void BaseExplorer<Station>::Update::add_db(dballe::db::Transaction& tr)
     add_cursor(*cur);
 }
 
+template <typename Station>
+void BaseExplorer<Station>::Update::add_db(dballe::db::DB& db, unsigned shards)
+{
+    core::Query query;
+    query.query = "details";
+
+    db.query_summary_sharded(query, shards, [&](dballe::CursorSummary& cur) {
+        add_cursor(cur);
+    });
+}
+
 template <typename Station>
 void BaseExplorer<Station>::Update::add_cursor(dballe::CursorSummary& cur)
 {
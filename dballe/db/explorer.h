@@ -49,6 +49,12 @@ public:
         /// Merge summary data from a database
         void add_db(dballe::db::Transaction& tr);
 
+        /**
+         * Merge summary data from a database, querying it in \a shards parts
+         * that can run concurrently (see DB::query_summary_sharded)
+         */
+        void add_db(dballe::db::DB& db, unsigned shards);
+
         /// Merge summary data from a database
         void add_cursor(dballe::CursorSummary& cur);
 
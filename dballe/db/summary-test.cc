@@ -434,6 +434,72 @@ void Tests<DB, BACKEND>::register_tests()
         }
     });
 
+    this->add_method("area_datetime_filter", [](Fixture& f) {
+        BACKEND summary;
+
+        typename BACKEND::station_type station;
+        station.report = "test";
+        summary::VarDesc vd(Level(1), Trange::instant(), WR_VAR(0, 1, 112));
+        DatetimeRange dt2018(Datetime(2018, 1, 1), Datetime(2018, 7, 1));
+        DatetimeRange dt2019(Datetime(2019, 1, 1), Datetime(2019, 7, 1));
+
+        station.coords = Coords(44.5, 11.5);
+        summary.add(station, vd, dt2018, 1);
+        station.coords = Coords(45.5, 175.0);
+        summary.add(station, vd, dt2018, 2);
+        summary.add(station, vd, dt2019, 4);
+        station.coords = Coords(46.5, -175.0);
+        summary.add(station, vd, dt2019, 8);
+
+        auto count_filtered = [&](const core::Query& query) {
+            BACKEND s1;
+            s1.add_filtered(summary, query);
+            return s1.data_count();
+        };
+
+        {
+            core::Query query;
+            query.latrange = LatRange(45.0, 47.0);
+            wassert(actual(count_filtered(query)) == 14u);
+        }
+
+        {
+            // Longitude range crossing the antimeridian
+            core::Query query;
+            query.lonrange = LonRange(170.0, -170.0);
+            wassert(actual(count_filtered(query)) == 14u);
+        }
+
+        {
+            core::Query query;
+            query.lonrange = LonRange(-170.0, 170.0);
+            wassert(actual(count_filtered(query)) == 1u);
+        }
+
+        {
+            core::Query query;
+            query.dtrange = DatetimeRange(Datetime(2019, 2, 1), Datetime());
+            wassert(actual(count_filtered(query)) == 12u);
+        }
+
+        {
+            core::Query query;
+            query.lonrange = LonRange(170.0, 180.0);
+            query.dtrange  = DatetimeRange(Datetime(), Datetime(2018, 12, 1));
+            wassert(actual(count_filtered(query)) == 2u);
+        }
+
+        {
+            // The results stay correct after adding new entries
+            station.coords = Coords(45.0, 179.0);
+            summary.add(station, vd, dt2018, 16);
+            core::Query query;
+            query.lonrange = LonRange(170.0, 180.0);
+            query.dtrange  = DatetimeRange(Datetime(), Datetime(2018, 12, 1));
+            wassert(actual(count_filtered(query)) == 18u);
+        }
+    });
+
     this->add_method("issue218", [](Fixture& f) {
         BACKEND summary;
 
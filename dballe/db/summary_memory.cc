@@ -98,7 +98,9 @@ template <typename Station>
 std::shared_ptr<dballe::CursorSummary>
 BaseSummaryMemory<Station>::query_summary(const Query& query) const
 {
-    return std::make_shared<summary::Cursor<Station>>(entries, query);
+    if (dirty)
+        recompute_summaries();
+    return std::make_shared<summary::Cursor<Station>>(entries, index, query);
 }
 
 template <typename Station>
@@ -121,7 +123,9 @@ bool BaseSummaryMemory<Station>::iter_filtered(
                        const DatetimeRange& dtrange, size_t count)>
         dest) const
 {
-    return entries.iter_filtered(query, dest);
+    if (dirty)
+        recompute_summaries();
+    return entries.iter_filtered(query, index, dest);
 }
 
 template <typename Station>
@@ -154,6 +158,7 @@ void BaseSummaryMemory<Station>::recompute_summaries() const
         dtrange = DatetimeRange();
         count   = 0;
     }
+    index.build(entries);
     dirty = false;
 }
 
@@ -166,7 +171,8 @@ template <typename Station> void BaseSummaryMemory<Station>::clear()
     m_varcodes.clear();
     dtrange = dballe::DatetimeRange();
     count   = 0;
-    dirty   = false;
+    index.clear();
+    dirty = false;
 }
 
 template <typename Station>
@@ -186,7 +192,9 @@ void BaseSummaryMemory<Station>::add_filtered(
     if (const BaseSummaryMemory<Station>* s =
             dynamic_cast<const BaseSummaryMemory<Station>*>(&summary))
     {
-        entries.add_filtered(s->entries, query);
+        if (s->dirty)
+            s->recompute_summaries();
+        entries.add_filtered(s->entries, s->index, query);
         dirty = true;
     }
     else
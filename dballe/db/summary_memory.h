@@ -27,6 +27,8 @@ protected:
     mutable core::SortedSmallUniqueValueSet<wreport::Varcode> m_varcodes;
     mutable dballe::DatetimeRange dtrange;
     mutable size_t count = 0;
+    /// Index used to filter entries, rebuilt with the other summaries
+    mutable summary::StationIndex index;
 
     mutable bool dirty = false;
 
@@ -1,6 +1,7 @@
 #define _DBALLE_LIBRARY_CODE
 #include "summary_utils.h"
 #include "dballe/core/json.h"
+#include <limits>
 
 namespace dballe {
 namespace db {
@@ -53,6 +54,72 @@ void VarEntry::dump(FILE* out) const
     fprintf(out, "      Count: %zd\n", count);
 }
 
+namespace {
+
+/**
+ * Call dest for all the variables in entries that match query, using index
+ * to filter on coordinates and datetimes.
+ *
+ * Stop and return false as soon as dest returns false.
+ */
+template <typename Station, typename Dest>
+bool select_indexed(const StationEntries<Station>& entries,
+                    const StationIndex& index, const dballe::Query& query,
+                    Dest dest)
+{
+    const core::Query& q = core::Query::downcast(query);
+    StationFilter<Station> filter(query);
+
+    std::vector<uint8_t> station_sel;
+    if (filter.has_flt_area)
+    {
+        index.select_area(q.latrange, q.lonrange, station_sel);
+        // Coordinates have already been checked using the index
+        filter.has_flt_area = false;
+    }
+
+    std::vector<uint8_t> var_sel;
+    DatetimeRange wanted_dtrange = q.get_datetimerange();
+    if (!wanted_dtrange.is_missing())
+        index.select_datetime(wanted_dtrange, var_sel);
+
+    size_t station_idx = 0;
+    for (const auto& station_entry : entries)
+    {
+        const size_t cur_station = station_idx++;
+        if (!station_sel.empty() && !station_sel[cur_station])
+            continue;
+
+        if (filter.has_flt_station &&
+            !filter.matches_station(station_entry.station))
+            continue;
+
+        size_t var_idx = index.var_offsets[cur_station];
+        for (const auto& entry : station_entry)
+        {
+            const size_t cur_var = var_idx++;
+            if (!var_sel.empty() && !var_sel[cur_var])
+                continue;
+
+            if (!q.level.is_missing() && q.level != entry.var.level)
+                continue;
+
+            if (!q.trange.is_missing() && q.trange != entry.var.trange)
+                continue;
+
+            if (!q.varcodes.empty() &&
+                q.varcodes.find(entry.var.varcode) == q.varcodes.end())
+                continue;
+
+            if (!dest(station_entry, entry))
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
 template <typename Station>
 void StationEntry<Station>::add(const VarDesc& vd,
                                 const dballe::DatetimeRange& dtrange,
@@ -222,7 +289,7 @@ void StationEntries<Station>::add_filtered(const StationEntries& entries,
 {
     StationFilter<Station> filter(query);
 
-    for (auto entry : entries)
+    for (const auto& entry : entries)
     {
         if (!filter.matches_station(entry.station))
             continue;
@@ -250,7 +317,7 @@ bool StationEntries<Station>::iter_filtered(
 
     if (filter.has_flt_station)
     {
-        for (auto entry : *this)
+        for (const auto& entry : *this)
         {
             if (!filter.matches_station(entry.station))
                 continue;
@@ -261,13 +328,157 @@ bool StationEntries<Station>::iter_filtered(
     }
     else
     {
-        for (auto entry : *this)
+        for (const auto& entry : *this)
             if (!entry.iter_filtered(query, dest))
                 return false;
     }
     return true;
 }
 
+template <typename Station>
+void StationEntries<Station>::add_filtered(const StationEntries& entries,
+                                           const StationIndex& index,
+                                           const dballe::Query& query)
+{
+    const Station* cur_station = nullptr;
+    iterator cur;
+    select_indexed(entries, index, query,
+                   [&](const StationEntry<Station>& station_entry,
+                       const VarEntry& var_entry) {
+                       // Look up the destination station only once for all its
+                       // variables
+                       if (cur_station != &station_entry.station)
+                       {
+                           cur_station = &station_entry.station;
+                           cur         = this->find(station_entry.station);
+                           if (cur == end())
+                           {
+                               StationEntry<Station> se;
+                               se.station = station_entry.station;
+                               Parent::add(se);
+                               cur = end() - 1;
+                           }
+                       }
+                       cur->add(var_entry.var, var_entry.dtrange,
+                                var_entry.count);
+                       return true;
+                   });
+}
+
+template <typename Station>
+bool StationEntries<Station>::iter_filtered(
+    const dballe::Query& query, const StationIndex& index,
+    std::function<bool(const Station&, const summary::VarDesc&,
+                       const DatetimeRange& dtrange, size_t count)>
+        dest) const
+{
+    return select_indexed(*this, index, query,
+                          [&](const StationEntry<Station>& station_entry,
+                              const VarEntry& var_entry) {
+                              return dest(station_entry.station, var_entry.var,
+                                          var_entry.dtrange, var_entry.count);
+                          });
+}
+
+void StationIndex::clear()
+{
+    lat.clear();
+    lon.clear();
+    var_offsets.clear();
+    dt_min.clear();
+    dt_max.clear();
+}
+
+template <typename Station>
+void StationIndex::build(const StationEntries<Station>& entries)
+{
+    clear();
+    lat.reserve(entries.size());
+    lon.reserve(entries.size());
+    var_offsets.reserve(entries.size() + 1);
+    var_offsets.push_back(0);
+    for (const auto& station_entry : entries.sorted())
+    {
+        lat.push_back(station_entry.station.coords.lat);
+        lon.push_back(station_entry.station.coords.lon);
+        for (const auto& var_entry : station_entry.sorted())
+        {
+            dt_min.push_back(encode_min(var_entry.dtrange.min));
+            dt_max.push_back(encode_max(var_entry.dtrange.max));
+        }
+        var_offsets.push_back(dt_min.size());
+    }
+}
+
+void StationIndex::select_area(const LatRange& latrange,
+                               const LonRange& lonrange,
+                               std::vector<uint8_t>& sel) const
+{
+    const int lat_min = latrange.imin;
+    const int lat_max = latrange.imax;
+
+    // Represent the longitude range as the union of two intervals, to handle
+    // ranges that wrap around the antimeridian. The second one can be empty.
+    int lon1_min = lonrange.imin, lon1_max = lonrange.imax;
+    int lon2_min = 1, lon2_max = 0;
+    if (lonrange.imin == lonrange.imax)
+    {
+        if (lonrange.imin == MISSING_INT)
+        {
+            lon1_min = std::numeric_limits<int>::min();
+            lon1_max = std::numeric_limits<int>::max();
+        }
+    }
+    else if (lonrange.imin > lonrange.imax)
+    {
+        lon1_max = 18000000;
+        lon2_min = -18000000;
+        lon2_max = lonrange.imax;
+    }
+
+    const size_t size = lat.size();
+    const int* plat   = lat.data();
+    const int* plon   = lon.data();
+    sel.resize(size);
+    uint8_t* psel = sel.data();
+    // Use non short-circuiting operators, so that the loop has no branches
+    // and the compiler can vectorize it
+    for (size_t i = 0; i < size; ++i)
+        psel[i] = (plat[i] >= lat_min) & (plat[i] <= lat_max) &
+                  (((plon[i] >= lon1_min) & (plon[i] <= lon1_max)) |
+                   ((plon[i] >= lon2_min) & (plon[i] <= lon2_max)));
+}
+
+void StationIndex::select_datetime(const DatetimeRange& dtrange,
+                                   std::vector<uint8_t>& sel) const
+{
+    const int64_t min = encode_min(dtrange.min);
+    const int64_t max = encode_max(dtrange.max);
+
+    const size_t size   = dt_min.size();
+    const int64_t* pmin = dt_min.data();
+    const int64_t* pmax = dt_max.data();
+    sel.resize(size);
+    uint8_t* psel = sel.data();
+    // Same as !DatetimeRange::is_disjoint, written to be vectorized
+    for (size_t i = 0; i < size; ++i)
+        psel[i] = (pmax[i] >= min) & (pmin[i] <= max);
+}
+
+int64_t StationIndex::encode_min(const Datetime& dt)
+{
+    if (dt.is_missing())
+        return std::numeric_limits<int64_t>::min();
+    return (int64_t)dt.to_packed();
+}
+
+int64_t StationIndex::encode_max(const Datetime& dt)
+{
+    if (dt.is_missing())
+        return std::numeric_limits<int64_t>::max();
+    return (int64_t)dt.to_packed();
+}
+
 template class StationEntry<dballe::Station>;
 template class StationEntry<dballe::DBStation>;
 template class StationEntries<dballe::Station>;
@@ -276,6 +487,10 @@ StationEntries<dballe::Station>::add(const StationEntries<dballe::DBStation>&);
 template class StationEntries<dballe::DBStation>;
 template void
 StationEntries<dballe::DBStation>::add(const StationEntries<dballe::Station>&);
+template void
+StationIndex::build(const StationEntries<dballe::Station>& entries);
+template void
+StationIndex::build(const StationEntries<dballe::DBStation>& entries);
 
 template <typename Station>
 Cursor<Station>::Cursor(const BaseSummary<Station>& summary, const Query& query)
@@ -298,6 +513,15 @@ Cursor<Station>::Cursor(const summary::StationEntries<Station>& entries,
         _remaining += s.size();
 }
 
+template <typename Station>
+Cursor<Station>::Cursor(const summary::StationEntries<Station>& entries,
+                        const summary::StationIndex& index, const Query& query)
+{
+    results.add_filtered(entries, index, query);
+    for (const auto& s : results)
+        _remaining += s.size();
+}
+
 template class Cursor<dballe::Station>;
 template class Cursor<dballe::DBStation>;
 
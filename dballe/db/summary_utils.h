@@ -5,7 +5,9 @@
 #include <dballe/core/query.h>
 #include <dballe/core/smallset.h>
 #include <dballe/db/summary.h>
+#include <cstdint>
 #include <dballe/types.h>
+#include <vector>
 #include <wreport/error.h>
 
 namespace dballe {
@@ -121,6 +123,14 @@ struct StationEntry
     template <typename OStation>
     void add(const StationEntry<OStation>& entries);
     void add_filtered(const StationEntry& entries, const dballe::Query& query);
+
+    const StationEntry& sorted() const
+    {
+        if (this->dirty)
+            this->rearrange_dirty();
+        return *this;
+    }
+
     bool iter_filtered(
         const dballe::Query& query,
         std::function<bool(const Station&, const summary::VarDesc&,
@@ -133,6 +143,68 @@ struct StationEntry
     DBALLE_TEST_ONLY void dump(FILE* out) const;
 };
 
+template <typename Station> struct StationEntries;
+
+/**
+ * Station coordinates and variable datetime ranges of a StationEntries,
+ * stored in contiguous arrays that can be scanned quickly when filtering.
+ *
+ * The i-th station has its coordinates in lat[i] and lon[i], and the datetime
+ * ranges of its variables, in iteration order, go from var_offsets[i] to
+ * var_offsets[i + 1] in dt_min and dt_max.
+ *
+ * The index is only valid until the entries it was built from are modified.
+ */
+struct StationIndex
+{
+    std::vector<int> lat;
+    std::vector<int> lon;
+    std::vector<size_t> var_offsets;
+    /// Encoded datetime range minimums, see encode_min()
+    std::vector<int64_t> dt_min;
+    /// Encoded datetime range maximums, see encode_max()
+    std::vector<int64_t> dt_max;
+
+    void clear();
+
+    /**
+     * Rebuild the index from the given entries.
+     *
+     * This also sorts the entries, so that their order does not change until
+     * they are modified again.
+     */
+    template <typename Station>
+    void build(const StationEntries<Station>& entries);
+
+    /**
+     * Set sel[i] to 1 if the coordinates of the i-th station are contained in
+     * the given ranges, or to 0 if they are not
+     */
+    void select_area(const LatRange& latrange, const LonRange& lonrange,
+                     std::vector<uint8_t>& sel) const;
+
+    /**
+     * Set sel[i] to 1 if the datetime range of the i-th variable intersects
+     * dtrange, or to 0 if it does not
+     */
+    void select_datetime(const DatetimeRange& dtrange,
+                         std::vector<uint8_t>& sel) const;
+
+    /**
+     * Encode a datetime as an integer with the same ordering.
+     *
+     * A missing datetime is encoded as the lowest possible value.
+     */
+    static int64_t encode_min(const Datetime& dt);
+
+    /**
+     * Encode a datetime as an integer with the same ordering.
+     *
+     * A missing datetime is encoded as the highest possible value.
+     */
+    static int64_t encode_max(const Datetime& dt);
+};
+
 template <typename Station>
 inline const Station&
 station_entries_get_value(const StationEntry<Station>& item)
@@ -188,6 +260,13 @@ struct StationEntries
 
     void add_filtered(const StationEntries& entry, const dballe::Query& query);
 
+    /**
+     * Merge the entries matching query, using index (built from entries) to
+     * filter on coordinates and datetimes
+     */
+    void add_filtered(const StationEntries& entries, const StationIndex& index,
+                      const dballe::Query& query);
+
     bool has(const Station& station) const
     {
         return this->find(station) != this->end();
@@ -205,6 +284,16 @@ struct StationEntries
         std::function<bool(const Station&, const summary::VarDesc&,
                            const DatetimeRange& dtrange, size_t count)>
             dest) const;
+
+    /**
+     * Iterate the entries matching query, using index (built from these
+     * entries) to filter on coordinates and datetimes
+     */
+    bool iter_filtered(
+        const dballe::Query& query, const StationIndex& index,
+        std::function<bool(const Station&, const summary::VarDesc&,
+                           const DatetimeRange& dtrange, size_t count)>
+            dest) const;
 };
 
 extern template class StationEntry<dballe::Station>;
@@ -218,6 +307,11 @@ extern template class StationEntries<dballe::DBStation>;
 extern template void
 StationEntries<dballe::DBStation>::add(const StationEntries<dballe::Station>&);
 
+extern template void
+StationIndex::build(const StationEntries<dballe::Station>& entries);
+extern template void
+StationIndex::build(const StationEntries<dballe::DBStation>& entries);
+
 template <typename S1, typename S2> inline S1 convert_station(const S2& s)
 {
     throw wreport::error_unimplemented("unsupported station conversion");
@@ -326,6 +420,8 @@ template <typename Station> struct Cursor : public impl::CursorSummary
 
     Cursor(const BaseSummary<Station>& summary, const Query& query);
     Cursor(const summary::StationEntries<Station>& entries, const Query& query);
+    Cursor(const summary::StationEntries<Station>& entries,
+           const summary::StationIndex& index, const Query& query);
 
     bool has_value() const override
     {
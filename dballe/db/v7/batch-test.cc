@@ -1,5 +1,6 @@
 #include "batch.h"
 #include "config.h"
+#include "dballe/core/data.h"
 #include "dballe/db/tests.h"
 #include "dballe/db/v7/db.h"
 #include "dballe/db/v7/levtr.h"
@@ -159,6 +160,191 @@ void Tests::register_tests()
         }
     });
 
+    add_method("upsert", [](Fixture& f) {
+        using namespace dballe::db::v7;
+        db::v7::Tracer<> trc;
+
+        Coords coords(44.5008, 11.3288);
+        Datetime dt(2013, 10, 16, 10);
+
+        TestDataSet ds;
+        ds.stations["synop"].station.coords = coords;
+        ds.stations["synop"].station.report = "synop";
+        ds.stations["synop"].values.set("B07030", 78); // Height
+        ds.data["synop"].station  = ds.stations["synop"].station;
+        ds.data["synop"].datetime = dt;
+        ds.data["synop"].level    = Level(1, 0, 0);
+        ds.data["synop"].trange   = Trange::instant();
+        ds.data["synop"].values.set(WR_VAR(0, 12, 101), 16.5);
+        wassert(f.populate(ds));
+
+        Batch& batch = f.tr->batch;
+        batch.clear();
+        unsigned count_select_station_data = batch.count_select_station_data;
+        unsigned count_select_data         = batch.count_select_data;
+        bool has_upsert                    = f.tr->data().has_upsert();
+
+        int id_levtr = f.tr->levtr().obtain_id(
+            trc, LevTrEntry(Level(1, 0, 0), Trange::instant()));
+        batch::Station* station =
+            wcallchecked(batch.get_station(trc, "synop", coords, Ident()));
+        wassert_false(station->is_new);
+
+        // Replace an existing value and add a new one
+        auto& st_data = station->get_station_data(trc, batch::UPDATE);
+        auto& data    = station->get_measured_data(trc, dt, batch::UPDATE);
+        Var sv(var(WR_VAR(0, 7, 30), 80.0));
+        Var dv1(var(WR_VAR(0, 12, 101), 17.0));
+        Var dv2(var(WR_VAR(0, 12, 103), 10.0));
+        st_data.add(&sv, batch::UPDATE);
+        data.add(id_levtr, &dv1, batch::UPDATE);
+        data.add(id_levtr, &dv2, batch::UPDATE);
+        batch.write_pending(trc);
+
+        // Existing values are not looked up if the database can do without
+        unsigned expected_selects = has_upsert ? 0 : 1;
+        wassert(actual(batch.count_select_station_data) ==
+                count_select_station_data + expected_selects);
+        wassert(actual(batch.count_select_data) ==
+                count_select_data + expected_selects);
+        wassert(actual(data.ids_on_db.size()) == 2u);
+        for (const auto& id : data.ids_on_db)
+            wassert(actual(id.id) != MISSING_INT);
+
+        // Existing values are kept with IGNORE
+        Var dv3(var(WR_VAR(0, 12, 101), 18.0));
+        auto& data1 = station->get_measured_data(trc, dt, batch::IGNORE);
+        data1.add(id_levtr, &dv3, batch::IGNORE);
+        batch.write_pending(trc);
+
+        auto st_cur = f.tr->query_station_data(core::Query());
+        wassert(actual(st_cur->remaining()) == 1);
+        wassert(st_cur->next());
+        wassert(actual(st_cur->get_var()) == sv);
+
+        auto cur = f.tr->query_data(core::Query());
+        wassert(actual(cur->remaining()) == 2);
+        wassert(cur->next());
+        wassert(actual(cur->get_var()) == dv1);
+        wassert(cur->next());
+        wassert(actual(cur->get_var()) == dv2);
+    });
+
+    add_method("upsert_then_load", [](Fixture& f) {
+        using namespace dballe::db::v7;
+        db::v7::Tracer<> trc;
+
+        Coords coords(44.5008, 11.3288);
+        Datetime dt(2013, 10, 16, 10);
+
+        TestDataSet ds;
+        ds.stations["synop"].station.coords = coords;
+        ds.stations["synop"].station.report = "synop";
+        ds.stations["synop"].values.set("B07030", 78); // Height
+        ds.data["synop"].station  = ds.stations["synop"].station;
+        ds.data["synop"].datetime = dt;
+        ds.data["synop"].level    = Level(1, 0, 0);
+        ds.data["synop"].trange   = Trange::instant();
+        ds.data["synop"].values.set(WR_VAR(0, 12, 101), 16.5);
+        wassert(f.populate(ds));
+
+        Batch& batch = f.tr->batch;
+        batch.clear();
+
+        int id_levtr = f.tr->levtr().obtain_id(
+            trc, LevTrEntry(Level(1, 0, 0), Trange::instant()));
+        batch::Station* station =
+            wcallchecked(batch.get_station(trc, "synop", coords, Ident()));
+
+        // Queue replacements of existing values in upsert mode
+        Var sv(var(WR_VAR(0, 7, 30), 80.0));
+        Var dv1(var(WR_VAR(0, 12, 101), 17.0));
+        station->get_station_data(trc, batch::UPDATE).add(&sv, batch::UPDATE);
+        station->get_measured_data(trc, dt, batch::UPDATE)
+            .add(id_levtr, &dv1, batch::UPDATE);
+
+        // Accessing them to add values without conflicts writes what was
+        // queued, and loads what is in the database
+        auto& st_data = station->get_station_data(trc);
+        auto& data    = station->get_measured_data(trc, dt);
+        wassert_true(st_data.to_insert.empty());
+        wassert_true(data.to_insert.empty());
+        wassert(actual(st_data.ids_by_code.size()) == 1u);
+        wassert(actual(data.ids_on_db.size()) == 1u);
+
+        Var sv1(var(WR_VAR(0, 7, 30), 81.0));
+        Var dv2(var(WR_VAR(0, 12, 101), 18.0));
+        wassert_throws(wreport::error_consistency,
+                       st_data.add(&sv1, batch::ERROR));
+        wassert_throws(wreport::error_consistency,
+                       data.add(id_levtr, &dv2, batch::ERROR));
+        Var dv3(var(WR_VAR(0, 12, 103), 10.0));
+        data.add(id_levtr, &dv3, batch::ERROR);
+        batch.write_pending(trc);
+
+        auto st_cur = f.tr->query_station_data(core::Query());
+        wassert(actual(st_cur->remaining()) == 1);
+        wassert(st_cur->next());
+        wassert(actual(st_cur->get_var()) == sv);
+
+        auto cur = f.tr->query_data(core::Query());
+        wassert(actual(cur->remaining()) == 2);
+        wassert(cur->next());
+        wassert(actual(cur->get_var()) == dv1);
+        wassert(cur->next());
+        wassert(actual(cur->get_var()) == dv3);
+    });
+
+    add_method("append", [](Fixture& f) {
+        using namespace dballe::db::v7;
+        db::v7::Tracer<> trc;
+
+        Coords coords(44.5008, 11.3288);
+        Datetime dt(2013, 10, 16, 10);
+
+        TestDataSet ds;
+        ds.data["synop"].station.coords = coords;
+        ds.data["synop"].station.report = "synop";
+        ds.data["synop"].datetime       = dt;
+        ds.data["synop"].level          = Level(1, 0, 0);
+        ds.data["synop"].trange         = Trange::instant();
+        ds.data["synop"].values.set(WR_VAR(0, 12, 101), 16.5);
+        wassert(f.populate(ds));
+
+        Batch& batch = f.tr->batch;
+        batch.clear();
+        unsigned count_select_data = batch.count_select_data;
+        unsigned count_select_last = batch.count_select_last_datetime;
+
+        int id_levtr = f.tr->levtr().obtain_id(
+            trc, LevTrEntry(Level(1, 0, 0), Trange::instant()));
+        batch::Station* station =
+            wcallchecked(batch.get_station(trc, "synop", coords, Ident()));
+        wassert_false(station->is_new);
+        wassert(actual(f.tr->data().last_datetime(trc, station->id)) == dt);
+
+        // Datetimes after the last one in the database are not looked up
+        Datetime dt1(2013, 10, 16, 12);
+        Datetime dt2(2013, 10, 16, 11);
+        Var dv1(var(WR_VAR(0, 12, 101), 17.0));
+        Var dv2(var(WR_VAR(0, 12, 101), 18.0));
+        station->get_measured_data(trc, dt1).add(id_levtr, &dv1, batch::ERROR);
+        station->get_measured_data(trc, dt2).add(id_levtr, &dv2, batch::ERROR);
+        wassert(actual(batch.count_select_data) == count_select_data);
+        wassert(actual(batch.count_select_last_datetime) ==
+                count_select_last + 1);
+
+        // Datetimes that may be in the database are still looked up
+        auto& data = station->get_measured_data(trc, dt);
+        wassert(actual(batch.count_select_data) == count_select_data + 1);
+        wassert(actual(data.ids_on_db.size()) == 1u);
+        batch.write_pending(trc);
+
+        wassert(actual(f.tr->data().last_datetime(trc, station->id)) == dt1);
+        auto cur = f.tr->query_data(core::Query());
+        wassert(actual(cur->remaining()) == 3);
+    });
+
     add_method("import", [](Fixture& f) {
         db::v7::Tracer<> trc;
         impl::Messages msgs1 =
@@ -246,6 +432,57 @@ void Tests::register_tests()
         wassert(cur->next());
         wassert(actual(cur->get_var()) == dv2);
     });
+
+    add_method("insert_deferred", [](Fixture& f) {
+        db::v7::Batch& batch   = f.tr->batch;
+        auto opts              = DBInsertOptions::create();
+        opts->can_add_stations = true;
+        opts->defer            = true;
+
+        core::Data data;
+        data.station.report = "synop";
+        data.station.coords = Coords(45.0, 11.0);
+        data.level          = Level(1);
+        data.trange         = Trange(254);
+        for (int hour = 0; hour < 3; ++hour)
+        {
+            data.datetime = Datetime(2018, 6, 1, hour);
+            data.values.set("B12101", 25.0 + hour);
+            wassert(f.tr->insert_data(data, *opts));
+            wassert(actual(data.values.begin()->data_id) == MISSING_INT);
+        }
+
+        // Values are queued, with copies independent from the input data
+        wassert(actual(batch.count_deferred()) == 3u);
+        data.values.set("B12101", 0.0);
+
+        // IDs are looked up on request
+        data.datetime = Datetime(2018, 6, 1, 1);
+        wassert(f.tr->resolve_data_ids(data));
+        wassert(actual(batch.count_deferred()) == 0u);
+        wassert(actual(data.station.id) != MISSING_INT);
+        int data_id = data.values.begin()->data_id;
+        wassert(actual(data_id) != MISSING_INT);
+
+        // Queued values are written before running queries
+        data.datetime = Datetime(2018, 6, 1, 3);
+        data.values.set("B12101", 28.0);
+        wassert(f.tr->insert_data(data, *opts));
+        wassert(actual(batch.count_deferred()) == 1u);
+
+        auto cur = f.tr->query_data(core::Query());
+        wassert(actual(cur->remaining()) == 4);
+
+        core::Query query;
+        query.dtrange = DatetimeRange(Datetime(2018, 6, 1, 1),
+                                      Datetime(2018, 6, 1, 1));
+        cur = f.tr->query_data(query);
+        wassert(actual(cur->remaining()) == 1);
+        wassert(cur->next());
+        wassert(actual(cur->get_var()) == var(WR_VAR(0, 12, 101), 26.0));
+        wassert(actual(dynamic_cast<db::CursorData*>(cur.get())
+                           ->attr_reference_id()) == data_id);
+    });
 }
 
 } // namespace
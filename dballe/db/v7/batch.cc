@@ -41,6 +41,8 @@ void Batch::new_station(Tracer<>& trc, const std::string& report,
         last_station->write_pending(trc, write_attrs);
         delete last_station;
         last_station = nullptr;
+        // Deferred values only ever belong to the last station
+        deferred.clear();
     }
     last_station         = new batch::Station(*this);
     last_station->report = report;
@@ -115,24 +117,44 @@ batch::Station* Batch::get_station(Tracer<>& trc, const std::string& report,
     return last_station;
 }
 
+batch::Station* Batch::get_known_station(Tracer<>& trc,
+                                         const dballe::DBStation& station)
+{
+    new_station(trc, station.report, station.coords, station.ident);
+    last_station->id                  = station.id;
+    last_station->is_new              = station.id == MISSING_INT;
+    last_station->station_data.loaded = true;
+    return last_station;
+}
+
+const wreport::Var* Batch::defer(const wreport::Var& var)
+{
+    deferred.emplace_back(var);
+    return &deferred.back();
+}
+
 void Batch::write_pending(Tracer<>& trc)
 {
+    ++transaction.data_changes;
     if (!last_station)
         return;
     last_station->write_pending(trc, write_attrs);
+    deferred.clear();
 }
 
 void Batch::clear()
 {
     delete last_station;
     last_station = nullptr;
+    deferred.clear();
 }
 
 void Batch::dump(FILE* out) const
 {
-    fprintf(out, " * Batch wa:%d csst:%u cssd: %u, csd: %u\n", (int)write_attrs,
-            count_select_stations, count_select_station_data,
-            count_select_data);
+    fprintf(out,
+            " * Batch wa:%d csst:%u cssd: %u, csd: %u, csld: %u, def: %zu\n",
+            (int)write_attrs, count_select_stations, count_select_station_data,
+            count_select_data, count_select_last_datetime, deferred.size());
     if (last_station)
     {
         fprintf(out, "Cached station:\n");
@@ -146,6 +168,44 @@ void Batch::dump(FILE* out) const
 
 namespace batch {
 
+namespace {
+
+/**
+ * Remove duplicate updates of the same id, keeping the last one queued, since
+ * a multi-row update would apply them in no defined order
+ */
+template <typename Datum> void keep_last_update(std::vector<Datum>& to_update)
+{
+    if (to_update.size() < 2)
+        return;
+    std::stable_sort(
+        to_update.begin(), to_update.end(),
+        [](const Datum& a, const Datum& b) { return a.id < b.id; });
+    auto out = to_update.begin();
+    for (auto i = to_update.begin(); i != to_update.end(); ++i)
+    {
+        auto next = i + 1;
+        if (next != to_update.end() && next->id == i->id)
+            continue;
+        *out++ = *i;
+    }
+    to_update.erase(out, to_update.end());
+}
+
+/**
+ * Check if upsert left the ID of some values unknown, because they were
+ * already in the database and were kept
+ */
+template <typename Datum> bool has_unknown_ids(const std::vector<Datum>& vars)
+{
+    for (const auto& v : vars)
+        if (v.id == MISSING_INT)
+            return true;
+    return false;
+}
+
+} // namespace
+
 void StationDatum::dump(FILE* out) const
 {
     fprintf(out, "%01d%02d%03d(%d): %s\n", WR_VAR_FXY(var->code()),
@@ -162,10 +222,33 @@ void MeasuredDatum::dump(FILE* out) const
 void StationData::add(const wreport::Var* var, UpdateMode on_conflict)
 {
     if (!loaded)
-        throw std::runtime_error(
-            "StationData::add called without loading status from DB first");
+    {
+        if (on_conflict == ERROR)
+            throw std::runtime_error("StationData::add called without "
+                                     "loading status from DB first");
+        overwrite = on_conflict == UPDATE;
+    }
     auto in_db = ids_by_code.find(var->code());
-    if (in_db != ids_by_code.end())
+    if (in_db != ids_by_code.end() && in_db->id == MISSING_INT)
+    {
+        // Already queued for insert by a previous add
+        switch (on_conflict)
+        {
+            case UPDATE:
+                for (auto i = to_insert.rbegin(); i != to_insert.rend(); ++i)
+                    if (i->var->code() == var->code())
+                    {
+                        i->var = var;
+                        break;
+                    }
+                break;
+            case IGNORE: break;
+            case ERROR:
+                throw wreport::error_consistency(
+                    "refusing to overwrite existing data");
+        }
+    }
+    else if (in_db != ids_by_code.end())
     {
         // Exists in the database
         switch (on_conflict)
@@ -179,8 +262,10 @@ void StationData::add(const wreport::Var* var, UpdateMode on_conflict)
     }
     else
     {
-        // Does not exist in the database
+        // Does not exist in the database: track it with a missing id until
+        // it is written
         to_insert.emplace_back(var);
+        ids_by_code.add(IdVarcode(MISSING_INT, var->code()));
     }
 }
 
@@ -190,9 +275,20 @@ void StationData::write_pending(Tracer<>& trc, Transaction& tr, int station_id,
     if (!to_insert.empty())
     {
         auto& st = tr.station_data();
-        st.insert(trc, station_id, to_insert, with_attrs);
+        if (loaded)
+            st.insert(trc, station_id, to_insert, with_attrs);
+        else
+        {
+            st.upsert(trc, station_id, to_insert, with_attrs, overwrite);
+            // Forget all IDs if some are unknown, so that values added again
+            // go through upsert instead of looking still queued for insert
+            if (has_unknown_ids(to_insert))
+                ids_by_code.clear();
+        }
         for (const auto& v : to_insert)
         {
+            if (v.id == MISSING_INT)
+                continue;
             auto cur = ids_by_code.find(v.var->code());
             if (cur == ids_by_code.end())
                 ids_by_code.add(IdVarcode(v.id, v.var->code()));
@@ -202,6 +298,7 @@ void StationData::write_pending(Tracer<>& trc, Transaction& tr, int station_id,
     }
     if (!to_update.empty())
     {
+        keep_last_update(to_update);
         auto& st = tr.station_data();
         st.update(trc, to_update, with_attrs);
     }
@@ -212,8 +309,35 @@ void StationData::write_pending(Tracer<>& trc, Transaction& tr, int station_id,
 void MeasuredData::add(int id_levtr, const wreport::Var* var,
                        UpdateMode on_conflict)
 {
+    if (!loaded)
+    {
+        if (on_conflict == ERROR)
+            throw std::runtime_error("MeasuredData::add called without "
+                                     "loading status from DB first");
+        overwrite = on_conflict == UPDATE;
+    }
     auto in_db = ids_on_db.find(IdVarcode(id_levtr, var->code()));
-    if (in_db != ids_on_db.end())
+    if (in_db != ids_on_db.end() && in_db->id == MISSING_INT)
+    {
+        // Already queued for insert by a previous add
+        switch (on_conflict)
+        {
+            case UPDATE:
+                for (auto i = to_insert.rbegin(); i != to_insert.rend(); ++i)
+                    if (i->id_levtr == id_levtr &&
+                        i->var->code() == var->code())
+                    {
+                        i->var = var;
+                        break;
+                    }
+                break;
+            case IGNORE: break;
+            case ERROR:
+                throw wreport::error_consistency(
+                    "refusing to overwrite existing data");
+        }
+    }
+    else if (in_db != ids_on_db.end())
     {
         // Exists in the database
         switch (on_conflict)
@@ -229,8 +353,11 @@ void MeasuredData::add(int id_levtr, const wreport::Var* var,
     }
     else
     {
-        // Does not exist in the database
+        // Does not exist in the database: track it with a missing id until
+        // it is written
         to_insert.emplace_back(id_levtr, var);
+        ids_on_db.add(
+            MeasuredDataID(IdVarcode(id_levtr, var->code()), MISSING_INT));
     }
 }
 
@@ -240,9 +367,21 @@ void MeasuredData::write_pending(Tracer<>& trc, Transaction& tr, int station_id,
     if (!to_insert.empty())
     {
         auto& st = tr.data();
-        st.insert(trc, station_id, datetime, to_insert, with_attrs);
+        if (loaded)
+            st.insert(trc, station_id, datetime, to_insert, with_attrs);
+        else
+        {
+            st.upsert(trc, station_id, datetime, to_insert, with_attrs,
+                      overwrite);
+            // Forget all IDs if some are unknown, so that values added again
+            // go through upsert instead of looking still queued for insert
+            if (has_unknown_ids(to_insert))
+                ids_on_db.clear();
+        }
         for (const auto& v : to_insert)
         {
+            if (v.id == MISSING_INT)
+                continue;
             auto cur = ids_on_db.find(IdVarcode(v.id_levtr, v.var->code()));
             if (cur == ids_on_db.end())
                 ids_on_db.add(
@@ -253,6 +392,7 @@ void MeasuredData::write_pending(Tracer<>& trc, Transaction& tr, int station_id,
     }
     if (!to_update.empty())
     {
+        keep_last_update(to_update);
         auto& st = tr.data();
         st.update(trc, to_update, with_attrs);
     }
@@ -270,6 +410,12 @@ StationData& Station::get_station_data(Tracer<>& trc)
 {
     if (!station_data.loaded)
     {
+        // Write the values queued for upsert, since after loading they would
+        // be inserted without resolving conflicts
+        station_data.write_pending(trc, batch.transaction, id,
+                                   batch.get_write_attrs());
+        // Drop what was known from previous upserts, and load everything
+        station_data.ids_by_code.clear();
         v7::StationData& sd = batch.transaction.station_data();
         sd.query(trc, id, [&](int data_id, wreport::Varcode code) {
             station_data.ids_by_code.add(IdVarcode(data_id, code));
@@ -280,17 +426,45 @@ StationData& Station::get_station_data(Tracer<>& trc)
     return station_data;
 }
 
+StationData& Station::get_station_data(Tracer<>& trc, UpdateMode on_conflict)
+{
+    if (on_conflict == ERROR ||
+        !batch.transaction.station_data().has_upsert())
+        return get_station_data(trc);
+    return station_data;
+}
+
 MeasuredData& Station::get_measured_data(Tracer<>& trc,
                                          const Datetime& datetime)
 {
     if (datetime.is_missing())
         throw std::runtime_error(
             "cannot access measured data with undefined datetime");
+    MeasuredData* md;
     auto mdi = measured_data.find(datetime);
-    if (mdi != measured_data.end())
+    if (mdi == measured_data.end())
+    {
+        md = measured_data.add(new MeasuredData(datetime));
+        // Values appended after the most recent datetime of the station
+        // cannot be on the database, and need no lookup
+        if (!is_new && !may_have_data_on_db(trc, datetime))
+        {
+            md->loaded = true;
+            return *md;
+        }
+    }
+    else if ((*mdi)->loaded)
         return **mdi;
-
-    MeasuredData* md = measured_data.add(new MeasuredData(datetime));
+    else
+    {
+        // Write the values queued for upsert, since after loading they would
+        // be inserted without resolving conflicts
+        md = *mdi;
+        md->write_pending(trc, batch.transaction, id, batch.get_write_attrs());
+        // Drop what was known from previous upserts, and load everything
+        md->ids_on_db.clear();
+    }
+    md->loaded = true;
 
     if (!is_new)
     {
@@ -306,12 +480,45 @@ MeasuredData& Station::get_measured_data(Tracer<>& trc,
     return *md;
 }
 
+MeasuredData& Station::get_measured_data(Tracer<>& trc,
+                                         const Datetime& datetime,
+                                         UpdateMode on_conflict)
+{
+    // Values of new stations are all inserted without looking up anything
+    if (on_conflict == ERROR || is_new ||
+        !batch.transaction.data().has_upsert())
+        return get_measured_data(trc, datetime);
+
+    if (datetime.is_missing())
+        throw std::runtime_error(
+            "cannot access measured data with undefined datetime");
+    auto mdi = measured_data.find(datetime);
+    if (mdi != measured_data.end())
+        return **mdi;
+    return *measured_data.add(new MeasuredData(datetime));
+}
+
+bool Station::may_have_data_on_db(Tracer<>& trc, const Datetime& datetime)
+{
+    if (!last_datetime_loaded)
+    {
+        last_datetime_on_db  = batch.transaction.data().last_datetime(trc, id);
+        last_datetime_loaded = true;
+        ++batch.count_select_last_datetime;
+    }
+    return !last_datetime_on_db.is_missing() && datetime <= last_datetime_on_db;
+}
+
 void Station::write_pending(Tracer<>& trc, bool with_attrs)
 {
     if (id == MISSING_INT)
         id = batch.transaction.station().insert_new(trc, *this);
 
     station_data.write_pending(trc, batch.transaction, id, with_attrs);
+    // Write datetimes in ascending order, following the data_uniq index
+    // (id_station, datetime, id_levtr, code): the values of each datetime are
+    // already sorted by the backends before writing them
+    measured_data.sort();
     for (auto md : measured_data)
         md->write_pending(trc, batch.transaction, id, with_attrs);
 }
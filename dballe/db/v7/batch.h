@@ -5,6 +5,7 @@
 #include <dballe/db/v7/fwd.h>
 #include <dballe/db/v7/utils.h>
 #include <dballe/types.h>
+#include <deque>
 #include <memory>
 #include <tuple>
 #include <vector>
@@ -20,6 +21,8 @@ class Batch
 protected:
     bool write_attrs             = true;
     batch::Station* last_station = nullptr;
+    /// Copies of the values queued by deferred inserts, until they are written
+    std::deque<wreport::Var> deferred;
 
     bool have_station(const std::string& report, const Coords& coords,
                       const Ident& ident);
@@ -28,20 +31,44 @@ protected:
 
 public:
     Transaction& transaction;
-    unsigned count_select_stations     = 0;
-    unsigned count_select_station_data = 0;
-    unsigned count_select_data         = 0;
+    unsigned count_select_stations      = 0;
+    unsigned count_select_station_data  = 0;
+    unsigned count_select_data          = 0;
+    unsigned count_select_last_datetime = 0;
+    /// Number of values queued by deferred inserts that triggers writing them
+    unsigned max_deferred               = 1000;
 
     Batch(Transaction& transaction) : transaction(transaction) {}
     ~Batch();
 
     void set_write_attrs(bool write_attrs);
+    bool get_write_attrs() const { return write_attrs; }
 
     batch::Station* get_station(Tracer<>& trc, const dballe::DBStation& station,
                                 bool station_can_add);
     batch::Station* get_station(Tracer<>& trc, const std::string& report,
                                 const Coords& coords, const Ident& ident);
 
+    /**
+     * Start writing values for a station that the caller has already looked
+     * up, without querying the database.
+     *
+     * If station.id is MISSING_INT, the station is created when writing.
+     * Otherwise, the caller needs to add the IDs of all the station values of
+     * the station to station_data.ids_by_code.
+     */
+    batch::Station* get_known_station(Tracer<>& trc,
+                                      const dballe::DBStation& station);
+
+    /**
+     * Copy var in storage owned by the batch, so that it can be queued until
+     * the next write_pending
+     */
+    const wreport::Var* defer(const wreport::Var& var);
+
+    /// Number of values queued by deferred inserts and not written yet
+    size_t count_deferred() const { return deferred.size(); }
+
     void write_pending(Tracer<>& trc);
     void clear();
     void dump(FILE* out) const;
@@ -89,7 +116,13 @@ struct StationData
     StationDataIDs ids_by_code;
     std::vector<StationDatum> to_insert;
     std::vector<StationDatum> to_update;
-    bool loaded = false;
+    /// True if ids_by_code lists all the values in the database
+    bool loaded    = false;
+    /**
+     * If not loaded, values in to_insert may already exist in the database,
+     * and this tells whether to replace them
+     */
+    bool overwrite = false;
 
     void add(const wreport::Var* var, UpdateMode on_conflict);
     void write_pending(Tracer<>& trc, Transaction& tr, int station_id,
@@ -150,6 +183,13 @@ struct MeasuredData
     MeasuredDataIDs ids_on_db;
     std::vector<MeasuredDatum> to_insert;
     std::vector<MeasuredDatum> to_update;
+    /// True if ids_on_db lists all the values in the database
+    bool loaded    = false;
+    /**
+     * If not loaded, values in to_insert may already exist in the database,
+     * and this tells whether to replace them
+     */
+    bool overwrite = false;
 
     MeasuredData(Datetime datetime) : datetime(datetime) {}
 
@@ -181,12 +221,46 @@ struct Station : public dballe::DBStation
     bool is_new = true;
     StationData station_data;
     MeasuredDataVector measured_data;
+    /// Most recent datetime of the data of the station in the database
+    Datetime last_datetime_on_db;
+    /// True if last_datetime_on_db has been queried
+    bool last_datetime_loaded = false;
 
     Station(Batch& batch) : batch(batch) {}
 
+    /// Get the station data, loading the IDs of all its values
     StationData& get_station_data(Tracer<>& trc);
+
+    /**
+     * Get the station data to add values with the given conflict resolution.
+     *
+     * Unless on_conflict is ERROR, the IDs of existing values are not loaded
+     * if the database can resolve conflicts while inserting.
+     */
+    StationData& get_station_data(Tracer<>& trc, UpdateMode on_conflict);
+
+    /// Get the measured data for a datetime, loading the IDs of all its values
     MeasuredData& get_measured_data(Tracer<>& trc, const Datetime& datetime);
 
+    /**
+     * Get the measured data for a datetime to add values with the given
+     * conflict resolution.
+     *
+     * Unless on_conflict is ERROR, the IDs of existing values are not loaded
+     * if the database can resolve conflicts while inserting.
+     */
+    MeasuredData& get_measured_data(Tracer<>& trc, const Datetime& datetime,
+                                    UpdateMode on_conflict);
+
+    /**
+     * Return true if the database may contain data of this station for
+     * datetime.
+     *
+     * This is false for datetimes after the most recent one in the database,
+     * which is what happens when importing data in chronological order.
+     */
+    bool may_have_data_on_db(Tracer<>& trc, const Datetime& datetime);
+
     void write_pending(Tracer<>& trc, bool with_attrs);
     void dump(FILE* out) const;
 };
@@ -119,6 +119,64 @@ int LevTrCache::find_id(const LevTrEntry& e) const
     return reverse.find_id(e);
 }
 
+bool SharedLevTrCache::find_entry(int id, LevTrEntry& dest) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    const LevTrEntry* res = cache.find_entry(id);
+    if (!res)
+        return false;
+    dest = *res;
+    return true;
+}
+
+int SharedLevTrCache::find_id(const LevTrEntry& e) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return cache.find_id(e);
+}
+
+bool SharedLevTrCache::is_loaded() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return loaded;
+}
+
+void SharedLevTrCache::load(const std::vector<LevTrEntry>& entries)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    cache.clear();
+    for (const auto& e : entries)
+        cache.insert(e);
+    loaded = true;
+}
+
+void SharedLevTrCache::publish(const std::vector<LevTrEntry>& entries)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    // An unloaded cache is going to be replaced by the next load
+    if (!loaded)
+        return;
+    for (const auto& e : entries)
+    {
+        const LevTrEntry* old = cache.find_entry(e.id);
+        if (old && *old != e)
+        {
+            // The table was changed behind our back: start again from scratch
+            cache.clear();
+            loaded = false;
+            return;
+        }
+        cache.insert(e);
+    }
+}
+
+void SharedLevTrCache::clear()
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    cache.clear();
+    loaded = false;
+}
+
 } // namespace v7
 } // namespace db
 } // namespace dballe
@@ -4,6 +4,7 @@
 #include <dballe/types.h>
 #include <iosfwd>
 #include <memory>
+#include <shared_mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -72,6 +73,46 @@ struct LevTrCache
     void clear();
 };
 
+/**
+ * LevTr cache shared by all the transactions of a DB connection.
+ *
+ * It only contains entries that have been committed, and it is loaded on
+ * first use with the whole contents of the levtr table.
+ *
+ * All methods are thread-safe.
+ */
+class SharedLevTrCache
+{
+protected:
+    LevTrCache cache;
+    /// True if the cache has been loaded with the whole levtr table
+    bool loaded = false;
+    mutable std::shared_mutex mutex;
+
+public:
+    /// Copy the entry with the given id to \a dest, if found
+    bool find_entry(int id, LevTrEntry& dest) const;
+
+    /// Look up the id of an entry, returning MISSING_INT if not found
+    int find_id(const LevTrEntry& e) const;
+
+    /// Check if the cache has been loaded
+    bool is_loaded() const;
+
+    /// Replace the cache contents with the whole levtr table
+    void load(const std::vector<LevTrEntry>& entries);
+
+    /// Add newly committed entries to a loaded cache
+    void publish(const std::vector<LevTrEntry>& entries);
+
+    /**
+     * Empty the cache, to be reloaded on next use.
+     *
+     * This needs to be called when rows are removed from the levtr table.
+     */
+    void clear();
+};
+
 } // namespace v7
 } // namespace db
 } // namespace dballe
@@ -53,18 +53,18 @@ void StationData::enq(impl::Enq& enq) const
     switch (key) // mklookup
     {
         case "priority":   enq.set_int(get_priority());
-        case "rep_memo":   enq.set_string(row().station.report);
-        case "report":     enq.set_string(row().station.report);
-        case "ana_id":     enq.set_dballe_int(row().station.id);
-        case "mobile":     enq.set_bool(!row().station.ident.is_missing());
-        case "ident":      enq.set_ident(row().station.ident);
-        case "lat":        enq.set_lat(row().station.coords.lat);
-        case "lon":        enq.set_lon(row().station.coords.lon);
-        case "coords":     enq.set_coords(row().station.coords);
-        case "station":    enq.set_station(row().station);
+        case "rep_memo":   enq.set_string(row().station->report);
+        case "report":     enq.set_string(row().station->report);
+        case "ana_id":     enq.set_dballe_int(row().station->id);
+        case "mobile":     enq.set_bool(!row().station->ident.is_missing());
+        case "ident":      enq.set_ident(row().station->ident);
+        case "lat":        enq.set_lat(row().station->coords.lat);
+        case "lon":        enq.set_lon(row().station->coords.lon);
+        case "coords":     enq.set_coords(row().station->coords);
+        case "station":    enq.set_station(*row().station);
         case "var":        enq.set_varcode(row().value.code());
-        case "variable":   enq.set_var(row().value.get());
-        case "attrs":      enq.set_attrs(row().value.get());
+        case "variable":   enq.set_var(row().decoded_value().get());
+        case "attrs":      enq.set_attrs(row().decoded_value().get());
         case "context_id": enq.set_dballe_int(row().value.data_id);
         default:           enq.search_alias_value(row().value);
     }
@@ -85,15 +85,15 @@ void Data::enq(impl::Enq& enq) const
     switch (key) // mklookup
     {
         case "priority":   enq.set_int(get_priority());
-        case "rep_memo":   enq.set_string(row().station.report);
-        case "report":     enq.set_string(row().station.report);
-        case "ana_id":     enq.set_dballe_int(row().station.id);
-        case "mobile":     enq.set_bool(!row().station.ident.is_missing());
-        case "ident":      enq.set_ident(row().station.ident);
-        case "lat":        enq.set_lat(row().station.coords.lat);
-        case "lon":        enq.set_lon(row().station.coords.lon);
-        case "coords":     enq.set_coords(row().station.coords);
-        case "station":    enq.set_station(row().station);
+        case "rep_memo":   enq.set_string(row().station->report);
+        case "report":     enq.set_string(row().station->report);
+        case "ana_id":     enq.set_dballe_int(row().station->id);
+        case "mobile":     enq.set_bool(!row().station->ident.is_missing());
+        case "ident":      enq.set_ident(row().station->ident);
+        case "lat":        enq.set_lat(row().station->coords.lat);
+        case "lon":        enq.set_lon(row().station->coords.lon);
+        case "coords":     enq.set_coords(row().station->coords);
+        case "station":    enq.set_station(*row().station);
         case "datetime":   enq.set_datetime(row().datetime);
         case "year":       enq.set_int(row().datetime.year);
         case "month":      enq.set_int(row().datetime.month);
@@ -111,8 +111,8 @@ void Data::enq(impl::Enq& enq) const
         case "p1":         enq.set_dballe_int(get_levtr().trange.p1);
         case "p2":         enq.set_dballe_int(get_levtr().trange.p2);
         case "var":        enq.set_varcode(row().value.code());
-        case "variable":   enq.set_var(row().value.get());
-        case "attrs":      enq.set_attrs(row().value.get());
+        case "variable":   enq.set_var(row().decoded_value().get());
+        case "attrs":      enq.set_attrs(row().decoded_value().get());
         case "context_id": enq.set_dballe_int(row().value.data_id);
         default:           enq.search_alias_value(row().value);
     }
@@ -130,15 +130,15 @@ void Summary::enq(impl::Enq& enq) const
     switch (key) // mklookup
     {
         case "priority": enq.set_int(get_priority());
-        case "rep_memo": enq.set_string(row().station.report);
-        case "report":   enq.set_string(row().station.report);
-        case "ana_id":   enq.set_dballe_int(row().station.id);
-        case "mobile":   enq.set_bool(!row().station.ident.is_missing());
-        case "ident":    enq.set_ident(row().station.ident);
-        case "lat":      enq.set_lat(row().station.coords.lat);
-        case "lon":      enq.set_lon(row().station.coords.lon);
-        case "coords":   enq.set_coords(row().station.coords);
-        case "station":  enq.set_station(row().station);
+        case "rep_memo": enq.set_string(row().station->report);
+        case "report":   enq.set_string(row().station->report);
+        case "ana_id":   enq.set_dballe_int(row().station->id);
+        case "mobile":   enq.set_bool(!row().station->ident.is_missing());
+        case "ident":    enq.set_ident(row().station->ident);
+        case "lat":      enq.set_lat(row().station->coords.lat);
+        case "lon":      enq.set_lon(row().station->coords.lon);
+        case "coords":   enq.set_coords(row().station->coords);
+        case "station":  enq.set_station(*row().station);
         case "datetimemax":
             if (row().dtrange.is_missing())
                 return;
@@ -2,6 +2,7 @@
 #include "db.h"
 #include "dballe/core/data.h"
 #include "dballe/core/query.h"
+#include "dballe/core/values.h"
 #include "dballe/core/var.h"
 #include "dballe/db/v7/data.h"
 #include "dballe/db/v7/levtr.h"
@@ -13,6 +14,7 @@
 #include "qbuilder.h"
 #include "transaction.h"
 #include "wreport/var.h"
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <dballe/db/v7/driver.h>
@@ -26,6 +28,9 @@ const unsigned int TOREC_BASECONTEXT = 1 << 1;
 const unsigned int TOREC_DATACONTEXT = 1 << 2;
 const unsigned int TOREC_DATA        = 1 << 3;
 
+/// Number of upcoming rows whose attributes are read with a single query
+const unsigned attrs_prefetch_size = 1000;
+
 } // namespace
 
 using namespace std;
@@ -58,6 +63,61 @@ template class Base<StationData>;
 template class Base<Data>;
 template class Base<Summary>;
 
+template <typename Table, typename Row>
+void AttrPrefetch::query(
+    v7::Transaction& tr, Table& table, const std::deque<Row>& results,
+    std::function<void(std::unique_ptr<wreport::Var>)> dest)
+{
+    // Attributes read before a change in the database may be outdated
+    if (data_changes != tr.data_changes)
+    {
+        attrs.clear();
+        data_changes = tr.data_changes;
+    }
+
+    int id_data = results.front().value.data_id;
+    auto i      = attrs.find(id_data);
+    if (i == attrs.end())
+    {
+        Tracer<> trc(tr.trc ? tr.trc->trace_func("prefetch_attrs") : nullptr);
+        std::vector<int> ids;
+        size_t count = std::min<size_t>(results.size(), attrs_prefetch_size);
+        ids.reserve(count);
+        for (size_t pos = 0; pos < count; ++pos)
+            ids.push_back(results[pos].value.data_id);
+        attrs.clear();
+        table.read_attrs_blobs(trc, ids,
+                               [&](int id, std::vector<uint8_t> encoded) {
+                                   attrs[id] = std::move(encoded);
+                               });
+        i = attrs.find(id_data);
+        if (i == attrs.end())
+        {
+            // Let the database report what happened to the missing row
+            table.read_attrs(trc, id_data, dest);
+            return;
+        }
+    }
+    Values::decode(i->second, dest);
+}
+
+const dballe::DBStation* StationTable::intern(const dballe::DBStation& station)
+{
+    auto i = by_id.find(station.id);
+    if (i != by_id.end())
+        return i->second;
+    stations.push_back(station);
+    const dballe::DBStation* res = &stations.back();
+    by_id.emplace(station.id, res);
+    return res;
+}
+
+void StationTable::clear()
+{
+    by_id.clear();
+    stations.clear();
+}
+
 void StationRow::dump(FILE* out) const
 {
     fprintf(out, "%02d %8.8s %02.4f %02.4f %-10s\n", station.id,
@@ -65,19 +125,29 @@ void StationRow::dump(FILE* out) const
             station.coords.dlon(), station.ident.get());
 }
 
+const DBValue& StationDataRow::decoded_value() const
+{
+    if (!attrs.empty())
+    {
+        core::value::Decoder::decode_attrs(attrs, *value);
+        attrs.clear();
+    }
+    return value;
+}
+
 void StationDataRow::dump(FILE* out) const
 {
-    fprintf(out, "%02d %8.8s %02.4f %02.4f %-10s ", station.id,
-            station.report.c_str(), station.coords.dlat(),
-            station.coords.dlon(), station.ident.get());
+    fprintf(out, "%02d %8.8s %02.4f %02.4f %-10s ", station->id,
+            station->report.c_str(), station->coords.dlat(),
+            station->coords.dlon(), station->ident.get());
     value.print(out);
 }
 
 void DataRow::dump(FILE* out) const
 {
-    fprintf(out, "%02d %8.8s %02.4f %02.4f %-10s %4d ", station.id,
-            station.report.c_str(), station.coords.dlat(),
-            station.coords.dlon(), station.ident.get(), id_levtr);
+    fprintf(out, "%02d %8.8s %02.4f %02.4f %-10s %4d ", station->id,
+            station->report.c_str(), station->coords.dlat(),
+            station->coords.dlon(), station->ident.get(), id_levtr);
     datetime.print_iso8601(out, ' ');
     fprintf(out, " ");
     value.print(out);
@@ -85,9 +155,9 @@ void DataRow::dump(FILE* out) const
 
 void SummaryRow::dump(FILE* out) const
 {
-    fprintf(out, "%02d %8.8s %02.4f %02.4f %-10s %4d %d%02d%03d\n", station.id,
-            station.report.c_str(), station.coords.dlat(),
-            station.coords.dlon(), station.ident.get(), id_levtr,
+    fprintf(out, "%02d %8.8s %02.4f %02.4f %-10s %4d %d%02d%03d\n",
+            station->id, station->report.c_str(), station->coords.dlat(),
+            station->coords.dlon(), station->ident.get(), id_levtr,
             WR_VAR_FXY(code));
 }
 
@@ -133,11 +203,13 @@ StationData::StationData(DataQueryBuilder& qb, bool with_attributes)
 void StationData::load(Tracer<>& trc, const DataQueryBuilder& qb)
 {
     results.clear();
+    stations.clear();
     tr->station_data().run_station_data_query(
         trc, qb,
-        [&](const dballe::DBStation& station, int id_data,
-            std::unique_ptr<wreport::Var> var) {
-            results.emplace_back(station, id_data, std::move(var));
+        [&](const dballe::DBStation& station, int id_data, wreport::Var&& var,
+            std::vector<uint8_t>&& attrs) {
+            results.emplace_back(stations.intern(station), id_data,
+                                 std::move(var), std::move(attrs));
         });
     at_start = true;
 }
@@ -147,13 +219,16 @@ void StationData::query_attrs(
 {
     if (!force_read && with_attributes)
     {
-        for (const wreport::Var* a = row().value->next_attr(); a != NULL;
-             a                     = a->next_attr())
-            dest(std::unique_ptr<wreport::Var>(new Var(*a)));
+        if (!row().attrs.empty())
+            Values::decode(row().attrs, dest);
+        else
+            for (const wreport::Var* a = row().value->next_attr(); a != NULL;
+                 a                     = a->next_attr())
+                dest(std::unique_ptr<wreport::Var>(new Var(*a)));
     }
     else
     {
-        tr->attr_query_station(attr_reference_id(), dest);
+        prefetch.query(*tr, tr->station_data(), results, dest);
     }
 }
 
@@ -170,14 +245,15 @@ Data::Data(DataQueryBuilder& qb, bool with_attributes)
 void Data::load(Tracer<>& trc, const DataQueryBuilder& qb)
 {
     results.clear();
+    stations.clear();
     std::set<int> ids;
     tr->data().run_data_query(
         trc, qb,
         [&](const dballe::DBStation& station, int id_levtr,
-            const Datetime& datetime, int id_data,
-            std::unique_ptr<wreport::Var> var) {
-            results.emplace_back(station, id_levtr, datetime, id_data,
-                                 std::move(var));
+            const Datetime& datetime, int id_data, wreport::Var&& var,
+            std::vector<uint8_t>&& attrs) {
+            results.emplace_back(stations.intern(station), id_levtr, datetime,
+                                 id_data, std::move(var), std::move(attrs));
             ids.insert(id_levtr);
         });
     at_start = true;
@@ -187,34 +263,37 @@ void Data::load(Tracer<>& trc, const DataQueryBuilder& qb)
 
 bool Data::add_to_best_results(const dballe::DBStation& station, int id_levtr,
                                const Datetime& datetime, int id_data,
-                               std::unique_ptr<wreport::Var> var)
+                               wreport::Var&& var,
+                               std::vector<uint8_t>&& attrs)
 {
     int prio = tr->repinfo().get_priority(station.report);
 
     if (results.empty())
         goto append;
-    if (station.coords != results.back().station.coords)
+    if (station.coords != results.back().station->coords)
         goto append;
-    if (station.ident != results.back().station.ident)
+    if (station.ident != results.back().station->ident)
         goto append;
     if (id_levtr != results.back().id_levtr)
         goto append;
     if (datetime != results.back().datetime)
         goto append;
-    if (var->code() != results.back().value.code())
+    if (var.code() != results.back().value.code())
         goto append;
 
     if (prio <= insert_cur_prio)
         return false;
 
     // Replace
-    results.back().station = station;
+    results.back().station = stations.intern(station);
     results.back().value   = DBValue(id_data, std::move(var));
+    results.back().attrs   = std::move(attrs);
     insert_cur_prio        = prio;
     return true;
 
 append:
-    results.emplace_back(station, id_levtr, datetime, id_data, std::move(var));
+    results.emplace_back(stations.intern(station), id_levtr, datetime, id_data,
+                         std::move(var), std::move(attrs));
     insert_cur_prio = prio;
     return true;
 }
@@ -222,14 +301,15 @@ append:
 void Data::load_best(Tracer<>& trc, const DataQueryBuilder& qb)
 {
     results.clear();
+    stations.clear();
     set<int> ids;
     tr->data().run_data_query(
         trc, qb,
         [&](const dballe::DBStation& station, int id_levtr,
-            const Datetime& datetime, int id_data,
-            std::unique_ptr<wreport::Var> var) {
+            const Datetime& datetime, int id_data, wreport::Var&& var,
+            std::vector<uint8_t>&& attrs) {
             if (add_to_best_results(station, id_levtr, datetime, id_data,
-                                    move(var)))
+                                    move(var), move(attrs)))
                 ids.insert(id_levtr);
         });
     at_start = true;
@@ -239,15 +319,16 @@ void Data::load_best(Tracer<>& trc, const DataQueryBuilder& qb)
 
 bool Data::add_to_last_results(const dballe::DBStation& station, int id_levtr,
                                const Datetime& datetime, int id_data,
-                               std::unique_ptr<wreport::Var> var)
+                               wreport::Var&& var,
+                               std::vector<uint8_t>&& attrs)
 {
     if (results.empty())
         goto append;
-    if (station.id != results.back().station.id)
+    if (station.id != results.back().station->id)
         goto append;
     if (id_levtr != results.back().id_levtr)
         goto append;
-    if (var->code() != results.back().value.code())
+    if (var.code() != results.back().value.code())
         goto append;
 
     if (datetime <= results.back().datetime)
@@ -255,28 +336,30 @@ bool Data::add_to_last_results(const dballe::DBStation& station, int id_levtr,
         return false;
 
     // Replace
-    results.back().station  = station;
     results.back().id_levtr = id_levtr;
     results.back().datetime = datetime;
     results.back().value    = DBValue(id_data, std::move(var));
+    results.back().attrs    = std::move(attrs);
     return true;
 
 append:
-    results.emplace_back(station, id_levtr, datetime, id_data, std::move(var));
+    results.emplace_back(stations.intern(station), id_levtr, datetime, id_data,
+                         std::move(var), std::move(attrs));
     return true;
 }
 
 void Data::load_last(Tracer<>& trc, const DataQueryBuilder& qb)
 {
     results.clear();
+    stations.clear();
     set<int> ids;
     tr->data().run_data_query(
         trc, qb,
         [&](const dballe::DBStation& station, int id_levtr,
-            const Datetime& datetime, int id_data,
-            std::unique_ptr<wreport::Var> var) {
+            const Datetime& datetime, int id_data, wreport::Var&& var,
+            std::vector<uint8_t>&& attrs) {
             if (add_to_last_results(station, id_levtr, datetime, id_data,
-                                    move(var)))
+                                    move(var), move(attrs)))
                 ids.insert(id_levtr);
         });
     at_start = true;
@@ -289,13 +372,16 @@ void Data::query_attrs(std::function<void(std::unique_ptr<wreport::Var>)> dest,
 {
     if (!force_read && with_attributes)
     {
-        for (const Var* a = row().value->next_attr(); a != NULL;
-             a            = a->next_attr())
-            dest(std::unique_ptr<wreport::Var>(new Var(*a)));
+        if (!row().attrs.empty())
+            Values::decode(row().attrs, dest);
+        else
+            for (const Var* a = row().value->next_attr(); a != NULL;
+                 a            = a->next_attr())
+                dest(std::unique_ptr<wreport::Var>(new Var(*a)));
     }
     else
     {
-        tr->attr_query_data(attr_reference_id(), dest);
+        prefetch.query(*tr, tr->data(), results, dest);
     }
 }
 
@@ -304,13 +390,15 @@ void Data::remove() { tr->remove_data_by_id(row().value.data_id); }
 void Summary::load(Tracer<>& trc, const SummaryQueryBuilder& qb)
 {
     results.clear();
+    stations.clear();
     set<int> ids;
     tr->data().run_summary_query(
         trc, qb,
         [&](const dballe::DBStation& station, int id_levtr,
             wreport::Varcode code, const DatetimeRange& datetime,
             size_t count) {
-            results.emplace_back(station, id_levtr, code, datetime, count);
+            results.emplace_back(stations.intern(station), id_levtr, code,
+                                 datetime, count);
             ids.insert(id_levtr);
         });
     at_start = true;
@@ -321,7 +409,7 @@ void Summary::load(Tracer<>& trc, const SummaryQueryBuilder& qb)
 void Summary::remove()
 {
     core::Query query;
-    query.ana_id      = row().station.id;
+    query.ana_id      = row().station->id;
     const auto& levtr = get_levtr();
     query.level       = levtr.level;
     query.trange      = levtr.trange;
@@ -341,7 +429,7 @@ run_station_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr,
     {
         fprintf(stderr, "EXPLAIN ");
         q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->conn->explain(qb.sql_query, stderr);
     }
 
     auto res = std::make_shared<Stations>(tr);
@@ -361,7 +449,7 @@ run_station_data_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr,
     {
         fprintf(stderr, "EXPLAIN ");
         q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->conn->explain(qb.sql_query, stderr);
     }
 
     if (modifiers & (DBA_DB_MODIFIER_BEST | DBA_DB_MODIFIER_LAST))
@@ -393,12 +481,15 @@ run_data_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr,
     {
         fprintf(stderr, "EXPLAIN ");
         q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->conn->explain(qb.sql_query, stderr);
     }
 
     auto res =
         std::make_shared<Data>(qb, modifiers & DBA_DB_MODIFIER_WITH_ATTRIBUTES);
-    if (modifiers & DBA_DB_MODIFIER_BEST)
+    if (qb.best_last_in_sql)
+        // query=best and query=last have already been applied by the database
+        res->load(trc, qb);
+    else if (modifiers & DBA_DB_MODIFIER_BEST)
         res->load_best(trc, qb);
     else if (modifiers & DBA_DB_MODIFIER_LAST)
         res->load_last(trc, qb);
@@ -409,7 +500,8 @@ run_data_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr,
 
 std::shared_ptr<dballe::CursorSummary>
 run_summary_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr,
-                  const core::Query& q, bool explain)
+                  const core::Query& q, bool explain, unsigned shards,
+                  unsigned shard)
 {
     unsigned int modifiers = q.get_modifiers();
     if (modifiers & (DBA_DB_MODIFIER_BEST | DBA_DB_MODIFIER_LAST))
@@ -417,13 +509,15 @@ run_summary_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr,
             "cannot use query=best or query=last on summary queries");
 
     SummaryQueryBuilder qb(tr, q, modifiers, false);
+    qb.shards = shards;
+    qb.shard  = shard;
     qb.build();
 
     if (explain)
     {
         fprintf(stderr, "EXPLAIN ");
         q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->conn->explain(qb.sql_query, stderr);
     }
 
     auto res = std::make_shared<Summary>(tr);
@@ -446,7 +540,7 @@ void run_delete_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr,
     {
         fprintf(stderr, "EXPLAIN ");
         q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->conn->explain(qb.sql_query, stderr);
     }
 
     if (station_vars)
@@ -9,6 +9,8 @@
 #include <dballe/values.h>
 #include <deque>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 namespace dballe {
 namespace db {
@@ -20,6 +22,25 @@ struct StationData;
 struct Data;
 struct Summary;
 
+/**
+ * Stations referenced by the rows of a cursor.
+ *
+ * Query results usually have many rows for few stations: rows point to an
+ * entry in this table instead of carrying a copy of their station.
+ */
+struct StationTable
+{
+    /// Station entries; a deque keeps them in place as the table grows
+    std::deque<dballe::DBStation> stations;
+    /// Index of the entries by station ID
+    std::unordered_map<int, const dballe::DBStation*> by_id;
+
+    /// Return the entry for station, adding it if it is not in the table yet
+    const dballe::DBStation* intern(const dballe::DBStation& station);
+
+    void clear();
+};
+
 /**
  * Row resulting from a station query
  */
@@ -30,17 +51,28 @@ struct StationRow
 
     StationRow(const dballe::DBStation& station) : station(station) {}
 
+    const dballe::DBStation& get_station() const { return station; }
+
     void dump(FILE* out) const;
 };
 
 struct StationDataRow
 {
-    dballe::DBStation station;
-    DBValue value;
-
-    StationDataRow(const dballe::DBStation& station, int id_data,
-                   std::unique_ptr<wreport::Var> var)
-        : station(station), value(id_data, std::move(var))
+    /// Entry in the StationTable of the cursor
+    const dballe::DBStation* station;
+    /**
+     * Value, without attributes until they are decoded from attrs.
+     *
+     * It is mutable to decode attributes on access.
+     */
+    mutable DBValue value;
+    /// Attributes of value as read from the database, not decoded yet
+    mutable std::vector<uint8_t> attrs;
+
+    StationDataRow(const dballe::DBStation* station, int id_data,
+                   wreport::Var&& var, std::vector<uint8_t>&& attrs)
+        : station(station), value(id_data, std::move(var)),
+          attrs(std::move(attrs))
     {
     }
     StationDataRow(const StationDataRow&)            = delete;
@@ -49,6 +81,11 @@ struct StationDataRow
     StationDataRow& operator=(StationDataRow&& o)    = default;
     ~StationDataRow() {}
 
+    const dballe::DBStation& get_station() const { return *station; }
+
+    /// Return value, decoding its attributes if they are still encoded
+    const DBValue& decoded_value() const;
+
     void dump(FILE* out) const;
 };
 
@@ -59,11 +96,11 @@ struct DataRow : public StationDataRow
 
     using StationDataRow::StationDataRow;
 
-    DataRow(const dballe::DBStation& station, int id_levtr,
-            const Datetime& datetime, int id_data,
-            std::unique_ptr<wreport::Var> var)
-        : StationDataRow(station, id_data, std::move(var)), id_levtr(id_levtr),
-          datetime(datetime)
+    DataRow(const dballe::DBStation* station, int id_levtr,
+            const Datetime& datetime, int id_data, wreport::Var&& var,
+            std::vector<uint8_t>&& attrs)
+        : StationDataRow(station, id_data, std::move(var), std::move(attrs)),
+          id_levtr(id_levtr), datetime(datetime)
     {
     }
 
@@ -72,13 +109,14 @@ struct DataRow : public StationDataRow
 
 struct SummaryRow
 {
-    dballe::DBStation station;
+    /// Entry in the StationTable of the cursor
+    const dballe::DBStation* station;
     int id_levtr;
     wreport::Varcode code;
     DatetimeRange dtrange;
     size_t count = 0;
 
-    SummaryRow(const dballe::DBStation& station, int id_levtr,
+    SummaryRow(const dballe::DBStation* station, int id_levtr,
                wreport::Varcode code, const DatetimeRange& dtrange,
                size_t count)
         : station(station), id_levtr(id_levtr), code(code), dtrange(dtrange),
@@ -86,9 +124,32 @@ struct SummaryRow
     {
     }
 
+    const dballe::DBStation& get_station() const { return *station; }
+
     void dump(FILE* out) const;
 };
 
+/**
+ * Attributes read in advance for the upcoming rows of a cursor, when they
+ * were not loaded by the query
+ */
+struct AttrPrefetch
+{
+    /// Encoded attributes by data ID
+    std::unordered_map<int, std::vector<uint8_t>> attrs;
+    /// Value of Transaction::data_changes when attrs was loaded
+    unsigned data_changes = 0;
+
+    /**
+     * Send the attributes of the data row at the front of results to dest,
+     * loading those of the following rows as well if they are not available.
+     */
+    template <typename Table, typename Row>
+    void query(v7::Transaction& tr, Table& table,
+               const std::deque<Row>& results,
+               std::function<void(std::unique_ptr<wreport::Var>)> dest);
+};
+
 template <typename Cursor> struct ImplTraits
 {
 };
@@ -136,6 +197,9 @@ template <typename Impl> struct Base : public ImplTraits<Impl>::Parent
     /// Storage for the raw database results
     std::deque<Row> results;
 
+    /// Stations referenced by results
+    StationTable stations;
+
     /// True if we are at the start of the iteration
     bool at_start = true;
 
@@ -158,10 +222,14 @@ template <typename Impl> struct Base : public ImplTraits<Impl>::Parent
     {
         at_start = false;
         results.clear();
+        stations.clear();
         tr.reset();
     }
 
-    dballe::DBStation get_station() const override { return row().station; }
+    dballe::DBStation get_station() const override
+    {
+        return row().get_station();
+    }
 
     /**
      * Iterate the cursor until the end, returning the number of items.
@@ -184,7 +252,8 @@ template <typename Impl> struct Base : public ImplTraits<Impl>::Parent
 protected:
     int get_priority() const
     {
-        return tr->repinfo().get_priority(results.front().station.report);
+        return tr->repinfo().get_priority(
+            results.front().get_station().report);
     }
 };
 
@@ -215,6 +284,7 @@ protected:
 struct StationData : public Base<StationData>
 {
     bool with_attributes;
+    AttrPrefetch prefetch;
 
     StationData(DataQueryBuilder& qb, bool with_attributes);
     std::shared_ptr<dballe::db::Transaction> get_transaction() const override
@@ -222,7 +292,7 @@ struct StationData : public Base<StationData>
         return tr;
     }
     wreport::Varcode get_varcode() const override { return row().value.code(); }
-    wreport::Var get_var() const override { return *row().value; }
+    wreport::Var get_var() const override { return *row().decoded_value(); }
     int attr_reference_id() const override { return row().value.data_id; }
     void query_attrs(std::function<void(std::unique_ptr<wreport::Var>)> dest,
                      bool force_read) override;
@@ -279,12 +349,12 @@ protected:
     /// if the value has been ignored.
     bool add_to_best_results(const dballe::DBStation& station, int id_levtr,
                              const Datetime& datetime, int id_data,
-                             std::unique_ptr<wreport::Var> var);
+                             wreport::Var&& var, std::vector<uint8_t>&& attrs);
     /// Append or replace the last result according to datetime. Returns false
     /// if the value has been ignored.
     bool add_to_last_results(const dballe::DBStation& station, int id_levtr,
                              const Datetime& datetime, int id_data,
-                             std::unique_ptr<wreport::Var> var);
+                             wreport::Var&& var, std::vector<uint8_t>&& attrs);
 
     void load(Tracer<>& trc, const DataQueryBuilder& qb);
     void load_best(Tracer<>& trc, const DataQueryBuilder& qb);
@@ -292,6 +362,7 @@ protected:
 
 public:
     bool with_attributes;
+    AttrPrefetch prefetch;
 
     Data(DataQueryBuilder& qb, bool with_attributes);
 
@@ -302,7 +373,7 @@ public:
 
     Datetime get_datetime() const override { return row().datetime; }
     wreport::Varcode get_varcode() const override { return row().value.code(); }
-    wreport::Var get_var() const override { return *row().value; }
+    wreport::Var get_var() const override { return *row().decoded_value(); }
     int attr_reference_id() const override { return row().value.data_id; }
     Level get_level() const override { return get_levtr().level; }
     Trange get_trange() const override { return get_levtr().trange; }
@@ -336,7 +407,8 @@ protected:
 
     friend std::shared_ptr<dballe::CursorSummary>
     run_summary_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr,
-                      const core::Query& query, bool explain);
+                      const core::Query& query, bool explain, unsigned shards,
+                      unsigned shard);
 };
 
 std::shared_ptr<dballe::CursorStation>
@@ -348,9 +420,16 @@ run_station_data_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr,
 std::shared_ptr<dballe::CursorData>
 run_data_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr,
                const core::Query& query, bool explain);
+/**
+ * Run a summary query.
+ *
+ * If shards is more than 1, only query the part of the stations selected by
+ * shard (see QueryBuilder::shards)
+ */
 std::shared_ptr<dballe::CursorSummary>
 run_summary_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr,
-                  const core::Query& query, bool explain);
+                  const core::Query& query, bool explain, unsigned shards = 1,
+                  unsigned shard = 0);
 void run_delete_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr,
                       const core::Query& query, bool station_vars,
                       bool explain);
@@ -1,4 +1,9 @@
 #include "data.h"
+#include "dballe/db/v7/db.h"
+#include "dballe/db/v7/trace.h"
+#include "dballe/db/v7/transaction.h"
+#include "dballe/sql/querybuf.h"
+#include "dballe/sql/sql.h"
 #include "dballe/types.h"
 #include "dballe/values.h"
 #include <algorithm>
@@ -71,6 +76,47 @@ void DataCommon<Traits>::remove_attrs(Tracer<>& trc, int id_data,
     }
 }
 
+template <typename Traits>
+void DataCommon<Traits>::remove_ids(Tracer<>& trc, const std::vector<int>& ids)
+{
+    // Maximum number of IDs to put in a single DELETE query
+    static const unsigned batch_size = 1000;
+
+    for (size_t begin = 0; begin < ids.size(); begin += batch_size)
+    {
+        size_t end = std::min(begin + batch_size, ids.size());
+        sql::Querybuf dq(512);
+        dq.appendf("DELETE FROM %s WHERE id IN (", table_name);
+        dq.start_list(",");
+        for (size_t i = begin; i < end; ++i)
+            dq.append_listf("%d", ids[i]);
+        dq.append(")");
+        Tracer<> trc_del(trc ? trc->trace_delete(dq, end - begin) : nullptr);
+        tr.conn->execute(dq);
+    }
+}
+
+template <typename Traits>
+void DataCommon<Traits>::read_attrs_blobs(
+    Tracer<>& trc, const std::vector<int>& ids,
+    std::function<void(int id_data, std::vector<uint8_t> attrs)> dest)
+{
+    // Maximum number of IDs to put in a single SELECT query
+    static const unsigned batch_size = 1000;
+
+    for (size_t begin = 0; begin < ids.size(); begin += batch_size)
+    {
+        size_t end = std::min(begin + batch_size, ids.size());
+        sql::Querybuf q(512);
+        q.appendf("SELECT id, attrs FROM %s WHERE id IN (", table_name);
+        q.start_list(",");
+        for (size_t i = begin; i < end; ++i)
+            q.append_listf("%d", ids[i]);
+        q.append(")");
+        run_attrs_query(trc, q, dest);
+    }
+}
+
 template class DataCommon<StationDataTraits>;
 template class DataCommon<DataTraits>;
 
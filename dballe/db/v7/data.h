@@ -12,6 +12,7 @@
 #include <functional>
 #include <list>
 #include <memory>
+#include <string>
 #include <vector>
 #include <wreport/var.h>
 
@@ -50,6 +51,19 @@ protected:
      */
     virtual void remove_all_attrs(Tracer<>& trc, int id_data) = 0;
 
+    /**
+     * Delete the rows with the given IDs, using one DELETE query for each
+     * batch of IDs
+     */
+    void remove_ids(Tracer<>& trc, const std::vector<int>& ids);
+
+    /**
+     * Run a query selecting id and attrs, sending each resulting row to dest
+     */
+    virtual void run_attrs_query(
+        Tracer<>& trc, const std::string& query,
+        std::function<void(int id_data, std::vector<uint8_t> attrs)> dest) = 0;
+
 public:
     DataCommon(v7::Transaction& tr) : tr(tr) {}
     virtual ~DataCommon() {}
@@ -69,6 +83,22 @@ public:
     read_attrs(Tracer<>& trc, int id_data,
                std::function<void(std::unique_ptr<wreport::Var>)> dest) = 0;
 
+    /**
+     * Load from the database the encoded attributes of many values, using one
+     * query for each batch of IDs
+     *
+     * @param trc
+     *   Operation tracer using for debugging and diagnostics
+     * @param ids
+     *   IDs of the data rows for which we will read attributes
+     * @param dest
+     *   Function called with the ID and the encoded attributes of each row
+     *   found. The attributes can be decoded with Values::decode.
+     */
+    void read_attrs_blobs(
+        Tracer<>& trc, const std::vector<int>& ids,
+        std::function<void(int id_data, std::vector<uint8_t> attrs)> dest);
+
     /**
      * Merge the given attributes with the existing attributes of the given
      * variable:
@@ -89,6 +119,14 @@ public:
                         std::vector<typename Traits::BatchValue>& vars,
                         bool with_attrs) = 0;
 
+    /**
+     * Check if the database supports inserting values that may already
+     * exist, without looking up their IDs first.
+     *
+     * If false, upsert must not be called.
+     */
+    virtual bool has_upsert() const { return true; }
+
     /// Run the query to delete all records selected by the given QueryBuilder
     virtual void remove(Tracer<>& trc, const v7::IdQueryBuilder& qb) = 0;
 
@@ -152,18 +190,33 @@ struct StationData : public DataCommon<StationDataTraits>
                         std::vector<batch::StationDatum>& vars,
                         bool with_attrs) = 0;
 
+    /**
+     * Bulk variable insert, replacing (if overwrite is true) or keeping the
+     * values that already exist in the database.
+     *
+     * The id of each value is set to the ID of its row, or left unset if the
+     * existing value was kept and the database cannot return its ID.
+     */
+    virtual void upsert(Tracer<>& trc, int id_station,
+                        std::vector<batch::StationDatum>& vars,
+                        bool with_attrs, bool overwrite) = 0;
+
     /// Query contents of the data table
     virtual void
     query(Tracer<>& trc, int id_station,
           std::function<void(int id, wreport::Varcode code)> dest) = 0;
 
     /**
-     * Run a station data query, iterating on the resulting variables
+     * Run a station data query, iterating on the resulting variables.
+     *
+     * If the query selects attributes, they are passed encoded in attrs, and
+     * are not added to var.
      */
     virtual void run_station_data_query(
         Tracer<>& trc, const v7::DataQueryBuilder& qb,
         std::function<void(const dballe::DBStation& station, int id_data,
-                           std::unique_ptr<wreport::Var> var)>) = 0;
+                           wreport::Var&& var,
+                           std::vector<uint8_t>&& attrs)>) = 0;
 };
 
 struct Data : public DataCommon<DataTraits>
@@ -175,6 +228,17 @@ struct Data : public DataCommon<DataTraits>
                         std::vector<batch::MeasuredDatum>& vars,
                         bool with_attrs) = 0;
 
+    /**
+     * Bulk variable insert, replacing (if overwrite is true) or keeping the
+     * values that already exist in the database.
+     *
+     * The id of each value is set to the ID of its row, or left unset if the
+     * existing value was kept and the database cannot return its ID.
+     */
+    virtual void upsert(Tracer<>& trc, int id_station, const Datetime& datetime,
+                        std::vector<batch::MeasuredDatum>& vars,
+                        bool with_attrs, bool overwrite) = 0;
+
     /// Query contents of the data table
     virtual void
     query(Tracer<>& trc, int id_station, const Datetime& datetime,
@@ -182,13 +246,23 @@ struct Data : public DataCommon<DataTraits>
               dest) = 0;
 
     /**
-     * Run a data query, iterating on the resulting variables
+     * Return the most recent datetime of the data of a station, or a missing
+     * Datetime if the station has no data
+     */
+    virtual Datetime last_datetime(Tracer<>& trc, int id_station) = 0;
+
+    /**
+     * Run a data query, iterating on the resulting variables.
+     *
+     * If the query selects attributes, they are passed encoded in attrs, and
+     * are not added to var.
      */
     virtual void run_data_query(
         Tracer<>& trc, const v7::DataQueryBuilder& qb,
         std::function<void(const dballe::DBStation& station, int id_levtr,
                            const Datetime& datetime, int id_data,
-                           std::unique_ptr<wreport::Var> var)>) = 0;
+                           wreport::Var&& var,
+                           std::vector<uint8_t>&& attrs)>) = 0;
 
     /**
      * Run a summary query, iterating on the resulting variables
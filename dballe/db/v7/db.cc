@@ -4,6 +4,7 @@
 #include "dballe/db/v7/data.h"
 #include "dballe/db/v7/driver.h"
 #include "dballe/db/v7/levtr.h"
+#include "dballe/db/v7/pool.h"
 #include "dballe/db/v7/repinfo.h"
 #include "dballe/db/v7/station.h"
 #include "dballe/db/v7/transaction.h"
@@ -13,7 +14,10 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <limits.h>
+#include <mutex>
+#include <thread>
 #include <unistd.h>
 
 using namespace std;
@@ -48,14 +52,32 @@ DB::DB(shared_ptr<Connection> conn)
 DB::~DB()
 {
     trace->save();
+    delete m_readonly_pool;
     delete m_driver;
     delete trace;
 }
 
 v7::Driver& DB::driver() { return *m_driver; }
 
+void DB::set_readonly_pool_size(unsigned size)
+{
+    delete m_readonly_pool;
+    m_readonly_pool = nullptr;
+    if (size)
+        m_readonly_pool = new ConnectionPool(conn->get_url(), size);
+}
+
 std::shared_ptr<dballe::Transaction> DB::transaction(bool readonly)
 {
+    if (readonly && m_readonly_pool)
+    {
+        auto pooled = m_readonly_pool->acquire();
+        auto res    = pooled->conn->transaction(true);
+        return make_shared<v7::Transaction>(
+            dynamic_pointer_cast<v7::DB>(shared_from_this()), move(res),
+            pooled);
+    }
+
     auto res = conn->transaction(readonly);
     return make_shared<v7::Transaction>(
         dynamic_pointer_cast<v7::DB>(shared_from_this()), move(res));
@@ -75,6 +97,72 @@ void DB::disappear()
     // TODO: track open trasnsactions with weak pointers and roll them all
     // back, or raise errors if some of them have not been fired yet?
     m_driver->delete_tables_v7();
+    levtr_cache.clear();
+}
+
+void DB::query_summary_sharded(
+    const Query& query, unsigned shards,
+    std::function<void(dballe::CursorSummary&)> dest)
+{
+    // Without a pool, read-only transactions share the same connection and
+    // cannot run concurrently
+    if (shards < 2 || !m_readonly_pool)
+    {
+        auto tr  = transaction(true);
+        auto cur = tr->query_summary(query);
+        dest(*cur);
+        tr->rollback();
+        return;
+    }
+
+    const core::Query& q = core::Query::downcast(query);
+    std::mutex dest_mutex;
+    std::vector<std::exception_ptr> errors(shards);
+    std::vector<std::thread> threads;
+    threads.reserve(shards);
+    for (unsigned shard = 0; shard < shards; ++shard)
+    {
+        // Transactions are created here, one at a time, waiting for
+        // connections to be released by the threads that have finished
+        std::shared_ptr<v7::Transaction> tr;
+        try
+        {
+            tr = dynamic_pointer_cast<v7::Transaction>(transaction(true));
+        }
+        catch (...)
+        {
+            errors[shard] = std::current_exception();
+            break;
+        }
+        threads.emplace_back([&, tr, shard]() mutable {
+            try
+            {
+                Tracer<> trc(tr->trc ? tr->trc->trace_query_summary(query)
+                                     : nullptr);
+                auto cur = cursor::run_summary_query(trc, tr, q,
+                                                     explain_queries, shards,
+                                                     shard);
+                {
+                    std::lock_guard<std::mutex> lock(dest_mutex);
+                    dest(*cur);
+                }
+                cur.reset();
+                tr->rollback();
+            }
+            catch (...)
+            {
+                errors[shard] = std::current_exception();
+            }
+            // Give the connection back to the pool
+            tr.reset();
+        });
+    }
+
+    for (auto& t : threads)
+        t.join();
+    for (auto& e : errors)
+        if (e)
+            std::rethrow_exception(e);
 }
 
 void DB::reset(const char* repinfo_file)
@@ -96,6 +184,7 @@ void DB::vacuum()
     auto t   = conn->transaction();
     driver().vacuum_v7();
     t->commit();
+    levtr_cache.clear();
 }
 
 } // namespace v7
@@ -2,6 +2,7 @@
 #define DBA_DB_V7_H
 
 #include <dballe/db/db.h>
+#include <dballe/db/v7/cache.h>
 #include <dballe/db/v7/fwd.h>
 #include <dballe/db/v7/trace.h>
 #include <dballe/fwd.h>
@@ -26,11 +27,16 @@ public:
     Trace* trace         = nullptr;
     /// True if we print an EXPLAIN trace of all queries to stderr
     bool explain_queries = false;
+    /// Level/timerange cache shared by all transactions
+    SharedLevTrCache levtr_cache;
 
 protected:
     /// SQL driver backend
     v7::Driver* m_driver;
 
+    /// Extra connections used for read-only transactions, if enabled
+    v7::ConnectionPool* m_readonly_pool = nullptr;
+
     void init_after_connect();
 
 public:
@@ -42,6 +48,16 @@ public:
     /// Access the backend DB driver
     v7::Driver& driver();
 
+    /**
+     * Run read-only transactions using a pool of up to \a size extra
+     * connections to the same database, so that they can run concurrently
+     * from different threads.
+     *
+     * Use 0 to stop using the pool. This must not be called while read-only
+     * transactions are active.
+     */
+    void set_readonly_pool_size(unsigned size);
+
     std::shared_ptr<dballe::Transaction>
     transaction(bool readonly = false) override;
     std::shared_ptr<dballe::db::Transaction>
@@ -79,6 +95,10 @@ public:
      */
     void vacuum() override;
 
+    void query_summary_sharded(
+        const Query& query, unsigned shards,
+        std::function<void(dballe::CursorSummary&)> dest) override;
+
     friend class dballe::DB;
     friend class dballe::db::v7::Transaction;
 };
@@ -57,6 +57,8 @@ void Driver::remove_all(db::Format format)
     }
 }
 
+void Driver::checkpoint() {}
+
 void Driver::remove_all_v7()
 {
     connection.execute("DELETE FROM station_data");
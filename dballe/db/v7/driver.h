@@ -64,6 +64,13 @@ public:
     /// Perform database cleanup/maintenance on v7 databases
     virtual void vacuum_v7() = 0;
 
+    /**
+     * Reclaim the space of write-ahead logs after committing a large import.
+     *
+     * The default implementation does nothing.
+     */
+    virtual void checkpoint();
+
     /// Create a Driver for this connection
     static std::unique_ptr<Driver> create(dballe::sql::Connection& conn);
 };
@@ -1,6 +1,7 @@
 #include "cursor.h"
 #include "db.h"
 #include "dballe/core/query.h"
+#include "dballe/core/values.h"
 #include "dballe/db/v7/driver.h"
 #include "dballe/db/v7/levtr.h"
 #include "dballe/db/v7/station.h"
@@ -42,9 +43,11 @@ struct StationValues : public Values
 struct ProtoVar
 {
     int id_levtr;
-    std::unique_ptr<wreport::Var> var;
-    ProtoVar(int id_levtr, std::unique_ptr<wreport::Var> var)
-        : id_levtr(id_levtr), var(std::move(var))
+    wreport::Var var;
+    /// Encoded attributes, decoded when the variable is added to a message
+    std::vector<uint8_t> attrs;
+    ProtoVar(int id_levtr, wreport::Var&& var, std::vector<uint8_t>&& attrs)
+        : id_levtr(id_levtr), var(std::move(var)), attrs(std::move(attrs))
     {
     }
 };
@@ -113,6 +116,7 @@ struct Cursor : public impl::CursorMessage
 std::shared_ptr<dballe::CursorMessage>
 Transaction::query_messages(const Query& query)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_export_msgs(query) : nullptr);
     v7::LevTr& lt = levtr();
 
@@ -134,7 +138,7 @@ Transaction::query_messages(const Query& query)
     {
         fprintf(stderr, "EXPLAIN ");
         query.print(stderr);
-        db->conn->explain(qb.sql_query, stderr);
+        conn->explain(qb.sql_query, stderr);
     }
 
     // Retrieve results, buffering them locally to avoid performing concurrent
@@ -145,8 +149,8 @@ Transaction::query_messages(const Query& query)
     data().run_data_query(
         trc, qb,
         [&](const dballe::DBStation& station, int id_levtr,
-            const Datetime& datetime, int id_data,
-            std::unique_ptr<wreport::Var> var) {
+            const Datetime& datetime, int id_data, wreport::Var&& var,
+            std::vector<uint8_t>&& attrs) {
             if (station.id != last_ana_id || datetime != last_datetime)
             {
                 auto& vec = results[station.id];
@@ -168,7 +172,7 @@ Transaction::query_messages(const Query& query)
                 last_ana_id   = station.id;
             }
             id_levtrs.insert(id_levtr);
-            msg->vars.emplace_back(id_levtr, std::move(var));
+            msg->vars.emplace_back(id_levtr, std::move(var), std::move(attrs));
         });
 
     lt.prefetch_ids(trc, id_levtrs);
@@ -192,6 +196,7 @@ Transaction::query_messages(const Query& query)
                     ctx           = lt.to_msg(trc, pvar.id_levtr, *msg.msg);
                     last_id_levtr = pvar.id_levtr;
                 }
+                core::value::Decoder::decode_attrs(pvar.attrs, pvar.var);
                 ctx->values.set(std::move(pvar.var));
             }
             msg.vars.clear();
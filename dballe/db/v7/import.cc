@@ -8,6 +8,7 @@
 #include "dballe/msg/context.h"
 #include "dballe/msg/msg.h"
 #include "dballe/sql/sql.h"
+#include <algorithm>
 #include <cassert>
 
 using namespace wreport;
@@ -17,17 +18,49 @@ namespace dballe {
 namespace db {
 namespace v7 {
 
+bool Transaction::imports_value(const wreport::Var& var,
+                                const dballe::DBImportOptions& opts)
+{
+    if (!var.isset())
+        return false;
+    if (!opts.varlist.empty() &&
+        std::find(opts.varlist.begin(), opts.varlist.end(), var.code()) ==
+            opts.varlist.end())
+        return false;
+    return true;
+}
+
+unsigned Transaction::check_importable(const Message& message,
+                                       const dballe::DBImportOptions& opts)
+{
+    const impl::Message& msg = impl::Message::downcast(message);
+    if (msg.get_coords().is_missing())
+        throw error_notfound("coordinates not found in data to import");
+
+    unsigned count = 0;
+    for (const auto& ctx : msg.data)
+        for (const auto& val : ctx.values)
+            if (imports_value(*val, opts))
+                ++count;
+
+    if (count && msg.get_datetime().is_missing())
+        throw error_notfound("date/time informations not found (or "
+                             "incomplete) in message to insert");
+    return count;
+}
+
 void Transaction::add_msg_to_batch(Tracer<>& trc, const Message& message,
                                    const dballe::DBImportOptions& opts)
 {
     const impl::Message& msg = impl::Message::downcast(message);
 
+    // Fail before queueing anything if the message cannot be imported
+    unsigned count = check_importable(message, opts);
+
     batch::Station* station;
 
     // Coordinates
     Coords coords = msg.get_coords();
-    if (coords.is_missing())
-        throw error_notfound("coordinates not found in data to import");
 
     // Report code
     std::string report;
@@ -40,6 +73,9 @@ void Transaction::add_msg_to_batch(Tracer<>& trc, const Message& message,
     Ident ident = msg.get_ident();
     station     = batch.get_station(trc, report, coords, ident);
 
+    batch::UpdateMode on_conflict =
+        opts.overwrite ? batch::UPDATE : batch::IGNORE;
+
     if (opts.update_station || (station->is_new && station->id == MISSING_INT))
     {
         for (const auto& var : msg.station_data)
@@ -61,46 +97,35 @@ void Transaction::add_msg_to_batch(Tracer<>& trc, const Message& message,
             if (code == WR_VAR(0, 4, 6) && !var->next_attr())
                 continue;
 
-            station->get_station_data(trc).add(
-                var.get(), opts.overwrite ? batch::UPDATE : batch::IGNORE);
+            station->get_station_data(trc, on_conflict)
+                .add(var.get(), on_conflict);
         }
     }
 
+    // Without data values, the message may have no datetime
+    if (!count)
+        return;
+
     // Fill the bulk insert with the rest of the data
-    v7::LevTr& lt           = levtr();
-    // Defer creation of MeasuredData to prevent complaining about missing
-    // datetime info if we have no data to import
-    batch::MeasuredData* md = nullptr;
+    v7::LevTr& lt = levtr();
+    batch::MeasuredData& md =
+        station->get_measured_data(trc, msg.get_datetime(), on_conflict);
     for (const auto& ctx : msg.data)
     {
         int id_levtr = -1;
 
         for (const auto& val : ctx.values)
         {
-            if (not val->isset())
-                continue;
-            if (!opts.varlist.empty() &&
-                std::find(opts.varlist.begin(), opts.varlist.end(),
-                          val->code()) == opts.varlist.end())
+            if (!imports_value(*val, opts))
                 continue;
 
-            if (!md)
-            {
-                Datetime datetime = msg.get_datetime();
-                if (datetime.is_missing())
-                    throw error_notfound("date/time informations not found (or "
-                                         "incomplete) in message to insert");
-                md = &station->get_measured_data(trc, datetime);
-            }
-
             if (id_levtr == -1)
             {
                 // Get the database ID of the lev_tr
                 id_levtr = lt.obtain_id(trc, LevTrEntry(ctx.level, ctx.trange));
             }
 
-            md->add(id_levtr, val.get(),
-                    opts.overwrite ? batch::UPDATE : batch::IGNORE);
+            md.add(id_levtr, val.get(), on_conflict);
         }
     }
 }
@@ -108,6 +133,7 @@ void Transaction::add_msg_to_batch(Tracer<>& trc, const Message& message,
 void Transaction::import_message(const dballe::Message& message,
                                  const dballe::DBImportOptions& opts)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_import(1) : nullptr);
 
     batch.set_write_attrs(opts.import_attributes);
@@ -116,12 +142,14 @@ void Transaction::import_message(const dballe::Message& message,
 
     // Run the bulk insert
     batch.write_pending(trc);
+    ++imported_messages;
 }
 
 void Transaction::import_messages(
     const std::vector<std::shared_ptr<dballe::Message>>& messages,
     const dballe::DBImportOptions& opts)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_import(messages.size())
                            : nullptr);
 
@@ -132,6 +160,7 @@ void Transaction::import_messages(
 
     // Run the bulk insert
     batch.write_pending(trc);
+    imported_messages += messages.size();
 }
 
 } // namespace v7
@@ -1,5 +1,7 @@
 #include "levtr.h"
+#include "db.h"
 #include "dballe/msg/msg.h"
+#include "transaction.h"
 
 using namespace std;
 
@@ -13,6 +15,109 @@ LevTr::~LevTr() {}
 
 void LevTr::clear_cache() { cache.clear(); }
 
+SharedLevTrCache* LevTr::shared_cache()
+{
+    if (shared_invalid)
+        return nullptr;
+
+    SharedLevTrCache& shared = tr.db->levtr_cache;
+    if (!shared_checked)
+    {
+        // This happens before the first lookup, when the transaction has not
+        // yet added rows to levtr, so only committed entries are loaded
+        if (!shared.is_loaded())
+        {
+            std::vector<LevTrEntry> entries;
+            _dump([&](int id, const Level& level, const Trange& trange) {
+                entries.emplace_back(id, level, trange);
+            });
+            shared.load(entries);
+        }
+        shared_checked = true;
+    }
+    return &shared;
+}
+
+void LevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
+{
+    SharedLevTrCache* shared = shared_cache();
+    std::set<int> missing;
+    LevTrEntry entry;
+    for (auto id : ids)
+    {
+        if (cache.find_entry(id))
+            continue;
+        if (shared && shared->find_entry(id, entry))
+            cache.insert(entry);
+        else
+            missing.insert(id);
+    }
+    if (missing.empty())
+        return;
+    _prefetch_ids(trc, missing);
+}
+
+const LevTrEntry* LevTr::lookup_id(Tracer<>& trc, int id)
+{
+    // First look it up in the transaction cache
+    if (const LevTrEntry* res = cache.find_entry(id))
+        return res;
+
+    // Then in the connection-wide cache
+    if (SharedLevTrCache* shared = shared_cache())
+    {
+        LevTrEntry entry;
+        if (shared->find_entry(id, entry))
+            return cache.insert(entry);
+    }
+
+    return _lookup_id(trc, id);
+}
+
+int LevTr::obtain_id(Tracer<>& trc, const LevTrEntry& desc)
+{
+    int id = cache.find_id(desc);
+    if (id != MISSING_INT)
+        return id;
+
+    if (SharedLevTrCache* shared = shared_cache())
+    {
+        id = shared->find_id(desc);
+        if (id != MISSING_INT)
+        {
+            cache.insert(desc, id);
+            return id;
+        }
+    }
+
+    return _obtain_id(trc, desc);
+}
+
+void LevTr::publish_cache()
+{
+    if (shared_invalid)
+    {
+        // Rows have been removed: entries loaded meanwhile by other
+        // transactions may be stale
+        tr.db->levtr_cache.clear();
+        return;
+    }
+    if (!shared_checked)
+        return;
+
+    std::vector<LevTrEntry> entries;
+    entries.reserve(cache.by_id.size());
+    for (const auto& i : cache.by_id)
+        entries.push_back(*i.second);
+    tr.db->levtr_cache.publish(entries);
+}
+
+void LevTr::invalidate_shared_cache()
+{
+    shared_invalid = true;
+    tr.db->levtr_cache.clear();
+}
+
 const LevTrEntry& LevTr::lookup_cache(int id)
 {
     const LevTrEntry* res = cache.find_entry(id);
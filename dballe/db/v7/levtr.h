@@ -22,9 +22,29 @@ struct LevTr
 protected:
     v7::Transaction& tr;
     LevTrCache cache;
+    /// True if the shared cache has been checked and loaded if needed
+    bool shared_checked = false;
+    /// True if the shared cache cannot be used in this transaction
+    bool shared_invalid = false;
+
+    /**
+     * Return the connection-wide cache, loading it if needed, or nullptr if
+     * it cannot be used
+     */
+    SharedLevTrCache* shared_cache();
+
     virtual void
     _dump(std::function<void(int, const Level&, const Trange&)> out) = 0;
 
+    /// Load the given IDs from the database, and add them to the cache
+    virtual void _prefetch_ids(Tracer<>& trc, const std::set<int>& ids) = 0;
+
+    /// Look up a LevTr in the database given its ID
+    virtual const LevTrEntry* _lookup_id(Tracer<>& trc, int id) = 0;
+
+    /// Look up a LevTr in the database, inserting it if not found
+    virtual int _obtain_id(Tracer<>& trc, const LevTrEntry& desc) = 0;
+
 public:
     LevTr(v7::Transaction& tr);
     virtual ~LevTr();
@@ -41,7 +61,7 @@ public:
      * Given a set of IDs, load LevTr information for them and add it to the
      * cache.
      */
-    virtual void prefetch_ids(Tracer<>& trc, const std::set<int>& ids) = 0;
+    void prefetch_ids(Tracer<>& trc, const std::set<int>& ids);
 
     /**
      * Get/create a Context in the Msg for this level/timerange.
@@ -57,13 +77,27 @@ public:
     const LevTrEntry& lookup_cache(int id);
 
     /// Look up a LevTr from the database given its ID.
-    virtual const LevTrEntry* lookup_id(Tracer<>& trc, int id) = 0;
+    const LevTrEntry* lookup_id(Tracer<>& trc, int id);
 
     /**
      * Look up a LevTr from the database given its description. Insert a new
      * one if not found.
      */
-    virtual int obtain_id(Tracer<>& trc, const LevTrEntry& desc) = 0;
+    int obtain_id(Tracer<>& trc, const LevTrEntry& desc);
+
+    /**
+     * Add the entries of this transaction to the connection-wide cache.
+     *
+     * This is called after the transaction has been committed.
+     */
+    void publish_cache();
+
+    /**
+     * Stop using the connection-wide cache in this transaction, and empty it.
+     *
+     * This is called when the transaction removes rows from the levtr table.
+     */
+    void invalidate_shared_cache();
 
     /// Dump the entire contents of the table to an output stream
     void dump(FILE* out);
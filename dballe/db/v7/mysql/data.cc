@@ -23,6 +23,45 @@ namespace db {
 namespace v7 {
 namespace mysql {
 
+namespace {
+
+/**
+ * ON DUPLICATE KEY clauses used by upsert.
+ *
+ * Setting id=LAST_INSERT_ID(id) makes the ID of the existing row available
+ * as the last insert ID.
+ */
+const char* on_duplicate_replace =
+    " ON DUPLICATE KEY UPDATE id=LAST_INSERT_ID(id), value=VALUES(value), "
+    "attrs=VALUES(attrs)";
+const char* on_duplicate_keep =
+    " ON DUPLICATE KEY UPDATE id=LAST_INSERT_ID(id)";
+
+/// Maximum number of rows inserted at once is 2**max_insert_log2_rows
+const unsigned max_insert_log2_rows = 6;
+
+/// Columns and parameters of a row in the INSERT queries of each table
+template <typename Parent> struct InsertTraits;
+
+template <> struct InsertTraits<StationData>
+{
+    static constexpr const char* columns = "id_station, code, value, attrs";
+    static constexpr const char* row     = "(?, ?, ?, ?)";
+};
+
+template <> struct InsertTraits<Data>
+{
+    static constexpr const char* columns =
+        "id_station, id_levtr, datetime, code, value, attrs";
+    static constexpr const char* row = "(?, ?, ?, ?, ?, ?)";
+};
+
+/// Number of parameters bound for each row in the INSERT queries
+const unsigned station_data_columns = 4;
+const unsigned data_columns         = 6;
+
+} // namespace
+
 template class MySQLDataCommon<StationData>;
 template class MySQLDataCommon<Data>;
 
@@ -33,7 +72,109 @@ MySQLDataCommon<Parent>::MySQLDataCommon(v7::Transaction& tr,
 {
 }
 
-template <typename Parent> MySQLDataCommon<Parent>::~MySQLDataCommon() {}
+template <typename Parent> MySQLDataCommon<Parent>::~MySQLDataCommon()
+{
+    for (auto stm : insert_stms)
+        delete stm;
+    delete upsert_replace_stm;
+    delete upsert_keep_stm;
+}
+
+template <typename Parent>
+MySQLStatement& MySQLDataCommon<Parent>::insert_stm(unsigned log2_rows)
+{
+    if (insert_stms.size() <= log2_rows)
+        insert_stms.resize(log2_rows + 1, nullptr);
+    MySQLStatement*& stm = insert_stms[log2_rows];
+    if (!stm)
+    {
+        Querybuf qb;
+        qb.appendf("INSERT INTO %s (%s) VALUES ", Parent::table_name,
+                   InsertTraits<Parent>::columns);
+        qb.start_list(", ");
+        for (unsigned i = 0; i < (1u << log2_rows); ++i)
+            qb.append_list(InsertTraits<Parent>::row);
+        stm = conn.mysqlstatement(qb).release();
+    }
+    return *stm;
+}
+
+template <typename Parent>
+MySQLStatement& MySQLDataCommon<Parent>::upsert_stm(bool overwrite)
+{
+    MySQLStatement*& stm = overwrite ? upsert_replace_stm : upsert_keep_stm;
+    if (!stm)
+    {
+        Querybuf qb;
+        qb.appendf("INSERT INTO %s (%s) VALUES %s%s", Parent::table_name,
+                   InsertTraits<Parent>::columns, InsertTraits<Parent>::row,
+                   overwrite ? on_duplicate_replace : on_duplicate_keep);
+        stm = conn.mysqlstatement(qb).release();
+    }
+    return *stm;
+}
+
+template <typename Parent>
+unsigned MySQLDataCommon<Parent>::insert_chunk(size_t size)
+{
+    unsigned res = 0;
+    while (res < max_insert_log2_rows && ((size_t)2 << res) <= size)
+        ++res;
+    return res;
+}
+
+template <typename Parent>
+template <typename Datum>
+bool MySQLDataCommon<Parent>::write_rows(
+    Tracer<>& trc, std::vector<Datum>& vars, bool upsert, bool overwrite,
+    std::function<void(MySQLStatement& stm, unsigned row, const Datum& var,
+                       std::vector<uint8_t>& attrs)>
+        bind_row)
+{
+    std::sort(vars.begin(), vars.end());
+
+    // Skip duplicates
+    std::vector<Datum*> rows;
+    rows.reserve(vars.size());
+    for (auto v = vars.begin(); v != vars.end(); ++v)
+    {
+        auto next = v + 1;
+        if (next != vars.end() && *v == *next)
+            continue;
+        rows.push_back(&*v);
+    }
+
+    // The IDs of a multi-row INSERT can be computed from the first one only
+    // if they are assigned consecutively
+    unsigned step = upsert ? 0 : conn.autoinc_step();
+    bool ids_set  = true;
+    // Encoded attributes of the rows being bound
+    std::vector<std::vector<uint8_t>> attrs;
+    for (size_t pos = 0; pos < rows.size();)
+    {
+        unsigned log2_rows  = upsert ? 0 : insert_chunk(rows.size() - pos);
+        unsigned count      = 1u << log2_rows;
+        MySQLStatement& stm = upsert ? upsert_stm(overwrite)
+                                     : insert_stm(log2_rows);
+        if (attrs.size() < count)
+            attrs.resize(count);
+        for (unsigned i = 0; i < count; ++i)
+            bind_row(stm, i, *rows[pos + i], attrs[i]);
+
+        Tracer<> trc_ins(trc ? trc->trace_insert(stm.query, count) : nullptr);
+        stm.execute();
+        if (count == 1 || step)
+        {
+            int id = stm.get_last_insert_id();
+            for (unsigned i = 0; i < count; ++i)
+                rows[pos + i]->id = id + i * step;
+        }
+        else
+            ids_set = false;
+        pos += count;
+    }
+    return ids_set;
+}
 
 template <typename Parent>
 void MySQLDataCommon<Parent>::read_attrs(
@@ -49,6 +190,21 @@ void MySQLDataCommon<Parent>::read_attrs(
         trc_sel->add_row();
 }
 
+template <typename Parent>
+void MySQLDataCommon<Parent>::run_attrs_query(
+    Tracer<>& trc, const std::string& query,
+    std::function<void(int id_data, std::vector<uint8_t> attrs)> dest)
+{
+    Tracer<> trc_sel(trc ? trc->trace_select(query) : nullptr);
+    auto res = conn.exec_store(query);
+    while (auto row = res.fetch())
+    {
+        if (trc_sel)
+            trc_sel->add_row();
+        dest(row.as_int(0), row.as_blob(1));
+    }
+}
+
 template <typename Parent>
 void MySQLDataCommon<Parent>::write_attrs(Tracer<>& trc, int id_data,
                                           const Values& values)
@@ -93,34 +249,39 @@ void MySQLDataCommon<Parent>::remove(Tracer<>& trc,
     if (qb.bind_in_ident)
         throw error_unimplemented("binding in MySQL driver is not implemented");
 
-    std::unique_ptr<Varmatch> attr_filter;
-    if (!qb.query.attr_filter.empty())
-        attr_filter = Varmatch::parse(qb.query.attr_filter);
+    if (qb.query.attr_filter.empty())
+    {
+        // Delete all selected rows with a single query. MySQL does not allow
+        // a subquery on the table we are deleting from, unless it is
+        // materialized as a derived table
+        Querybuf dq(512);
+        dq.appendf("DELETE FROM %s WHERE id IN (SELECT id FROM (",
+                   Parent::table_name);
+        dq.append(qb.sql_query);
+        dq.append(") AS sel)");
+        Tracer<> trc_del(trc ? trc->trace_delete(dq) : nullptr);
+        conn.exec_no_data(dq);
+        return;
+    }
 
-    Querybuf dq(512);
-    dq.appendf("DELETE FROM %s WHERE id IN (", Parent::table_name);
-    dq.start_list(",");
-    unsigned count = 0;
+    // We need to apply attr_filter to all results of the query, so we collect
+    // the IDs of the matching ones and delete them in batches
+    std::unique_ptr<Varmatch> attr_filter =
+        Varmatch::parse(qb.query.attr_filter);
+    std::vector<int> ids;
     Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
     auto res = conn.exec_store(qb.sql_query);
     while (auto row = res.fetch())
     {
         if (trc_sel)
             trc_sel->add_row();
-        if (attr_filter.get() && !match_attrs(*attr_filter, row.as_blob(1)))
-            return;
-
-        // Note: if the query gets too long, we can split this in more DELETE
-        // runs
-        dq.append_list(row.as_cstring(0));
-        ++count;
-    }
-    dq.append(")");
-    if (count)
-    {
-        Tracer<> trc_del(trc ? trc->trace_delete(dq, count) : nullptr);
-        conn.exec_no_data(dq);
+        if (!match_attrs(*attr_filter, row.as_blob(1)))
+            continue;
+        ids.push_back(row.as_int(0));
     }
+    trc_sel.done();
+
+    this->remove_ids(trc, ids);
 }
 
 template <typename Parent>
@@ -186,43 +347,66 @@ void MySQLStationData::query(
     }
 }
 
+void MySQLStationData::bind_row(MySQLStatement& stm, unsigned row,
+                                int id_station, const batch::StationDatum& var,
+                                bool with_attrs, std::vector<uint8_t>& attrs)
+{
+    int base = row * station_data_columns;
+    stm.bind_val(base + 1, id_station);
+    stm.bind_val(base + 2, var.var->code());
+    stm.bind_val(base + 3, var.var->enqc());
+    if (with_attrs && var.var->next_attr())
+    {
+        core::value::Encoder enc;
+        enc.append_attributes(*var.var);
+        attrs = std::move(enc.buf);
+        stm.bind_val(base + 4, attrs);
+    }
+    else
+        stm.bind_null_val(base + 4);
+}
+
 void MySQLStationData::insert(Tracer<>& trc, int id_station,
                               std::vector<batch::StationDatum>& vars,
                               bool with_attrs)
 {
-    std::sort(vars.begin(), vars.end());
-    for (auto v = vars.begin(); v != vars.end(); ++v)
-    {
-        // Skip duplicates
-        auto next = v + 1;
-        if (next != vars.end() && *v == *next)
-            continue;
-        Querybuf qb;
-        string escaped_value = conn.escape(v->var->enqc());
-        if (with_attrs && v->var->next_attr())
-        {
-            core::value::Encoder enc;
-            enc.append_attributes(*v->var);
-            string escaped_attrs = conn.escape(enc.buf);
-            qb.appendf("INSERT INTO station_data (id_station, code, value, "
-                       "attrs) VALUES (%d, %d, '%s', X'%s')",
-                       id_station, (int)v->var->code(), escaped_value.c_str(),
-                       escaped_attrs.c_str());
-        }
-        else
-            qb.appendf("INSERT INTO station_data (id_station, code, value, "
-                       "attrs) VALUES (%d, %d, '%s', NULL)",
-                       id_station, (int)v->var->code(), escaped_value.c_str());
-        Tracer<> trc_ins(trc ? trc->trace_insert(qb, 1) : nullptr);
-        conn.exec_no_data(qb);
-        v->id = conn.get_last_insert_id();
-    }
+    bool ids_set = write_rows<batch::StationDatum>(
+        trc, vars, false, false,
+        [&](MySQLStatement& stm, unsigned row, const batch::StationDatum& var,
+            std::vector<uint8_t>& attrs) {
+            bind_row(stm, row, id_station, var, with_attrs, attrs);
+        });
+    if (ids_set)
+        return;
+
+    // Look up the IDs of the new rows, since vars is sorted by varcode
+    query(trc, id_station, [&](int id, wreport::Varcode code) {
+        auto i = std::lower_bound(vars.begin(), vars.end(), code,
+                                  [](const batch::StationDatum& d,
+                                     wreport::Varcode code) {
+                                      return d.var->code() < code;
+                                  });
+        for (; i != vars.end() && i->var->code() == code; ++i)
+            i->id = id;
+    });
+}
+
+void MySQLStationData::upsert(Tracer<>& trc, int id_station,
+                              std::vector<batch::StationDatum>& vars,
+                              bool with_attrs, bool overwrite)
+{
+    write_rows<batch::StationDatum>(
+        trc, vars, true, overwrite,
+        [&](MySQLStatement& stm, unsigned row, const batch::StationDatum& var,
+            std::vector<uint8_t>& attrs) {
+            bind_row(stm, row, id_station, var, with_attrs, attrs);
+        });
 }
 
 void MySQLStationData::run_station_data_query(
     Tracer<>& trc, const v7::DataQueryBuilder& qb,
     std::function<void(const dballe::DBStation& station, int id_data,
-                       std::unique_ptr<wreport::Var> var)>
+                       wreport::Var&& var, std::vector<uint8_t>&& attrs)>
         dest)
 {
     if (qb.bind_in_ident)
@@ -235,12 +419,13 @@ void MySQLStationData::run_station_data_query(
             trc_sel->add_row();
         wreport::Varcode code = row.as_int(5);
         const char* value     = row.as_cstring(7);
-        auto var              = newvar(code, value);
+        auto var              = dballe::var(code, value);
+        std::vector<uint8_t> attrs;
         if (qb.select_attrs)
-            core::value::Decoder::decode_attrs(row.as_blob(8), *var);
+            attrs = row.as_blob(8);
 
         // Postprocessing filter of attr_filter
-        if (qb.attr_filter && !qb.match_attrs(*var))
+        if (qb.attr_filter && !qb.match_attrs(attrs))
             return;
 
         int id_station = row.as_int(0);
@@ -258,7 +443,7 @@ void MySQLStationData::run_station_data_query(
 
         int id_data = row.as_int(6);
 
-        dest(station, id_data, move(var));
+        dest(station, id_data, move(var), move(attrs));
     });
 }
 
@@ -307,51 +492,91 @@ void MySQLData::query(
     }
 }
 
-void MySQLData::insert(Tracer<>& trc, int id_station, const Datetime& datetime,
-                       std::vector<batch::MeasuredDatum>& vars, bool with_attrs)
+Datetime MySQLData::last_datetime(Tracer<>& trc, int id_station)
 {
-    std::sort(vars.begin(), vars.end());
-    for (auto v = vars.begin(); v != vars.end(); ++v)
+    char strquery[128];
+    snprintf(strquery, 128,
+             "SELECT MAX(datetime) FROM data WHERE id_station=%d", id_station);
+    Tracer<> trc_sel(trc ? trc->trace_select(strquery) : nullptr);
+    auto res = conn.exec_store(strquery);
+    Datetime dt;
+    while (auto row = res.fetch())
     {
-        // Skip duplicates
-        auto next = v + 1;
-        if (next != vars.end() && *v == *next)
-            continue;
-        Querybuf qb;
-
-        const auto& dt       = datetime;
-        string escaped_value = conn.escape(v->var->enqc());
+        if (trc_sel)
+            trc_sel->add_row();
+        if (!row.isnull(0))
+            dt = row.as_datetime(0);
+    }
+    return dt;
+}
 
-        if (with_attrs && v->var->next_attr())
-        {
-            core::value::Encoder enc;
-            enc.append_attributes(*v->var);
-            string escaped_attrs = conn.escape(enc.buf);
-            qb.appendf("INSERT INTO data (id_station, id_levtr, datetime, "
-                       "code, value, attrs) VALUES (%d, %d, '%04d-%02d-%02d "
-                       "%02d:%02d:%02d', %d, '%s', X'%s')",
-                       id_station, v->id_levtr, dt.year, dt.month, dt.day,
-                       dt.hour, dt.minute, dt.second, (int)v->var->code(),
-                       escaped_value.c_str(), escaped_attrs.c_str());
-        }
-        else
-            qb.appendf("INSERT INTO data (id_station, id_levtr, datetime, "
-                       "code, value, attrs) VALUES (%d, %d, '%04d-%02d-%02d "
-                       "%02d:%02d:%02d', %d, '%s', NULL)",
-                       id_station, v->id_levtr, dt.year, dt.month, dt.day,
-                       dt.hour, dt.minute, dt.second, (int)v->var->code(),
-                       escaped_value.c_str());
-        Tracer<> trc_ins(trc ? trc->trace_insert(qb, 1) : nullptr);
-        conn.exec_no_data(qb);
-        v->id = conn.get_last_insert_id();
+void MySQLData::bind_row(MySQLStatement& stm, unsigned row, int id_station,
+                         const Datetime& datetime,
+                         const batch::MeasuredDatum& var, bool with_attrs,
+                         std::vector<uint8_t>& attrs)
+{
+    int base = row * data_columns;
+    stm.bind_val(base + 1, id_station);
+    stm.bind_val(base + 2, var.id_levtr);
+    stm.bind_val(base + 3, datetime);
+    stm.bind_val(base + 4, var.var->code());
+    stm.bind_val(base + 5, var.var->enqc());
+    if (with_attrs && var.var->next_attr())
+    {
+        core::value::Encoder enc;
+        enc.append_attributes(*var.var);
+        attrs = std::move(enc.buf);
+        stm.bind_val(base + 6, attrs);
     }
+    else
+        stm.bind_null_val(base + 6);
+}
+
+void MySQLData::insert(Tracer<>& trc, int id_station, const Datetime& datetime,
+                       std::vector<batch::MeasuredDatum>& vars, bool with_attrs)
+{
+    bool ids_set = write_rows<batch::MeasuredDatum>(
+        trc, vars, false, false,
+        [&](MySQLStatement& stm, unsigned row, const batch::MeasuredDatum& var,
+            std::vector<uint8_t>& attrs) {
+            bind_row(stm, row, id_station, datetime, var, with_attrs, attrs);
+        });
+    if (ids_set)
+        return;
+
+    // Look up the IDs of the new rows, since vars is sorted by level/timerange
+    // and varcode
+    query(trc, id_station, datetime,
+          [&](int id, int id_levtr, wreport::Varcode code) {
+              auto i = std::lower_bound(
+                  vars.begin(), vars.end(), IdVarcode(id_levtr, code),
+                  [](const batch::MeasuredDatum& d, const IdVarcode& key) {
+                      return IdVarcode(d.id_levtr, d.var->code()) < key;
+                  });
+              for (; i != vars.end() && i->id_levtr == id_levtr &&
+                     i->var->code() == code;
+                   ++i)
+                  i->id = id;
+          });
+}
+
+void MySQLData::upsert(Tracer<>& trc, int id_station, const Datetime& datetime,
+                       std::vector<batch::MeasuredDatum>& vars, bool with_attrs,
+                       bool overwrite)
+{
+    write_rows<batch::MeasuredDatum>(
+        trc, vars, true, overwrite,
+        [&](MySQLStatement& stm, unsigned row, const batch::MeasuredDatum& var,
+            std::vector<uint8_t>& attrs) {
+            bind_row(stm, row, id_station, datetime, var, with_attrs, attrs);
+        });
 }
 
 void MySQLData::run_data_query(
     Tracer<>& trc, const v7::DataQueryBuilder& qb,
     std::function<void(const dballe::DBStation& station, int id_levtr,
                        const Datetime& datetime, int id_data,
-                       std::unique_ptr<wreport::Var> var)>
+                       wreport::Var&& var, std::vector<uint8_t>&& attrs)>
         dest)
 {
     if (qb.bind_in_ident)
@@ -364,12 +589,13 @@ void MySQLData::run_data_query(
             trc_sel->add_row();
         wreport::Varcode code = row.as_int(6);
         const char* value     = row.as_cstring(9);
-        auto var              = newvar(code, value);
+        auto var              = dballe::var(code, value);
+        std::vector<uint8_t> attrs;
         if (qb.select_attrs)
-            core::value::Decoder::decode_attrs(row.as_blob(10), *var);
+            attrs = row.as_blob(10);
 
         // Postprocessing filter of attr_filter
-        if (qb.attr_filter && !qb.match_attrs(*var))
+        if (qb.attr_filter && !qb.match_attrs(attrs))
             return;
 
         int id_station = row.as_int(0);
@@ -389,7 +615,7 @@ void MySQLData::run_data_query(
         int id_data       = row.as_int(7);
         Datetime datetime = row.as_datetime(8);
 
-        dest(station, id_levtr, datetime, id_data, move(var));
+        dest(station, id_levtr, datetime, id_data, move(var), move(attrs));
     });
 }
 
@@ -4,6 +4,7 @@
 #include <dballe/db/v7/cache.h>
 #include <dballe/db/v7/data.h>
 #include <dballe/sql/fwd.h>
+#include <vector>
 
 namespace dballe {
 namespace db {
@@ -17,20 +18,47 @@ protected:
     /// DB connection
     dballe::sql::MySQLConnection& conn;
 
-#if 0
-    /// Precompiled read attributes statement
-    dballe::sql::MySQLStatement* read_attrs_stm = nullptr;
-    /// Precompiled write attributes statement
-    dballe::sql::MySQLStatement* write_attrs_stm = nullptr;
-    /// Precompiled remove attributes statement
-    dballe::sql::MySQLStatement* remove_attrs_stm = nullptr;
-    /// Precompiled select statement
-    dballe::sql::MySQLStatement* sstm = nullptr;
-    /// Precompiled insert statement
-    dballe::sql::MySQLStatement* istm = nullptr;
-    /// Precompiled update statement
-    dballe::sql::MySQLStatement* ustm = nullptr;
-#endif
+    /**
+     * Prepared INSERT statements for 1, 2, 4, ... rows, created when first
+     * needed
+     */
+    std::vector<dballe::sql::MySQLStatement*> insert_stms;
+    /// Prepared single row INSERT replacing existing values
+    dballe::sql::MySQLStatement* upsert_replace_stm = nullptr;
+    /// Prepared single row INSERT keeping existing values
+    dballe::sql::MySQLStatement* upsert_keep_stm    = nullptr;
+
+    /// Get the prepared statement to insert 2**log2_rows rows at a time
+    dballe::sql::MySQLStatement& insert_stm(unsigned log2_rows);
+
+    /// Get the prepared statement to insert one row, resolving conflicts
+    dballe::sql::MySQLStatement& upsert_stm(bool overwrite);
+
+    /**
+     * Compute how many rows to insert at once for a batch of size rows.
+     *
+     * Returns log2 of the number of rows to pass to insert_stm
+     */
+    unsigned insert_chunk(size_t size);
+
+    /**
+     * Insert vars, calling bind_row to bind the values of each row.
+     *
+     * If upsert is true, rows are inserted one at a time, replacing existing
+     * values if overwrite is true, or keeping them otherwise. If it is false,
+     * rows are inserted with multi-row INSERTs.
+     *
+     * Returns false if the IDs of the inserted rows could not be set, because
+     * the database does not guarantee them to be consecutive, and they need to
+     * be looked up.
+     */
+    template <typename Datum>
+    bool write_rows(Tracer<>& trc, std::vector<Datum>& vars, bool upsert,
+                    bool overwrite,
+                    std::function<void(dballe::sql::MySQLStatement& stm,
+                                       unsigned row, const Datum& var,
+                                       std::vector<uint8_t>& attrs)>
+                        bind_row);
 
 public:
     MySQLDataCommon(v7::Transaction& tr, dballe::sql::MySQLConnection& conn);
@@ -44,6 +72,10 @@ public:
     void read_attrs(
         Tracer<>& trc, int id_data,
         std::function<void(std::unique_ptr<wreport::Var>)> dest) override;
+    void run_attrs_query(Tracer<>& trc, const std::string& query,
+                         std::function<void(int id_data,
+                                            std::vector<uint8_t> attrs)>
+                             dest) override;
     void write_attrs(Tracer<>& trc, int id_data, const Values& values) override;
     void remove_all_attrs(Tracer<>& trc, int id_data) override;
     void remove(Tracer<>& trc, const v7::IdQueryBuilder& qb) override;
@@ -58,6 +90,12 @@ extern template class MySQLDataCommon<Data>;
  */
 class MySQLStationData : public MySQLDataCommon<StationData>
 {
+protected:
+    /// Bind the values of var to the parameters of row of stm
+    void bind_row(dballe::sql::MySQLStatement& stm, unsigned row,
+                  int id_station, const batch::StationDatum& var,
+                  bool with_attrs, std::vector<uint8_t>& attrs);
+
 public:
     using MySQLDataCommon::MySQLDataCommon;
 
@@ -69,10 +107,14 @@ public:
     void insert(Tracer<>& trc, int id_station,
                 std::vector<batch::StationDatum>& vars,
                 bool with_attrs) override;
+    void upsert(Tracer<>& trc, int id_station,
+                std::vector<batch::StationDatum>& vars, bool with_attrs,
+                bool overwrite) override;
     void run_station_data_query(
         Tracer<>& trc, const v7::DataQueryBuilder& qb,
         std::function<void(const dballe::DBStation& station, int id_data,
-                           std::unique_ptr<wreport::Var> var)>) override;
+                           wreport::Var&& var,
+                           std::vector<uint8_t>&& attrs)>) override;
     void dump(FILE* out) override;
     void clear_cache() override {}
 };
@@ -82,6 +124,13 @@ public:
  */
 class MySQLData : public MySQLDataCommon<Data>
 {
+protected:
+    /// Bind the values of var to the parameters of row of stm
+    void bind_row(dballe::sql::MySQLStatement& stm, unsigned row,
+                  int id_station, const Datetime& datetime,
+                  const batch::MeasuredDatum& var, bool with_attrs,
+                  std::vector<uint8_t>& attrs);
+
 public:
     using MySQLDataCommon::MySQLDataCommon;
 
@@ -90,14 +139,19 @@ public:
     void query(Tracer<>& trc, int id_station, const Datetime& datetime,
                std::function<void(int id, int id_levtr, wreport::Varcode code)>
                    dest) override;
+    Datetime last_datetime(Tracer<>& trc, int id_station) override;
     void insert(Tracer<>& trc, int id_station, const Datetime& datetime,
                 std::vector<batch::MeasuredDatum>& vars,
                 bool with_attrs) override;
+    void upsert(Tracer<>& trc, int id_station, const Datetime& datetime,
+                std::vector<batch::MeasuredDatum>& vars, bool with_attrs,
+                bool overwrite) override;
     void run_data_query(
         Tracer<>& trc, const v7::DataQueryBuilder& qb,
         std::function<void(const dballe::DBStation& station, int id_levtr,
                            const Datetime& datetime, int id_data,
-                           std::unique_ptr<wreport::Var> var)>) override;
+                           wreport::Var&& var,
+                           std::vector<uint8_t>&& attrs)>) override;
     void run_summary_query(
         Tracer<>& trc, const v7::SummaryQueryBuilder& qb,
         std::function<void(const dballe::DBStation& station, int id_levtr,
@@ -43,7 +43,7 @@ MySQLLevTr::MySQLLevTr(v7::Transaction& tr, MySQLConnection& conn)
 
 MySQLLevTr::~MySQLLevTr() {}
 
-void MySQLLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
+void MySQLLevTr::_prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
 {
     if (ids.empty())
         return;
@@ -74,11 +74,9 @@ void MySQLLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
     }
 }
 
-const LevTrEntry* MySQLLevTr::lookup_id(Tracer<>& trc, int id)
+const LevTrEntry* MySQLLevTr::_lookup_id(Tracer<>& trc, int id)
 {
-    const LevTrEntry* res = cache.find_entry(id);
-    if (res)
-        return res;
+    const LevTrEntry* res = nullptr;
 
     char query[128];
     snprintf(
@@ -111,11 +109,9 @@ const LevTrEntry* MySQLLevTr::lookup_id(Tracer<>& trc, int id)
     return res;
 }
 
-int MySQLLevTr::obtain_id(Tracer<>& trc, const LevTrEntry& desc)
+int MySQLLevTr::_obtain_id(Tracer<>& trc, const LevTrEntry& desc)
 {
-    int id = cache.find_id(desc);
-    if (id != MISSING_INT)
-        return id;
+    int id = MISSING_INT;
 
     char query[512];
     snprintf(query, 512, R"(
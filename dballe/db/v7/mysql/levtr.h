@@ -27,6 +27,9 @@ protected:
 
     void
     _dump(std::function<void(int, const Level&, const Trange&)> out) override;
+    void _prefetch_ids(Tracer<>& trc, const std::set<int>& ids) override;
+    const LevTrEntry* _lookup_id(Tracer<>& trc, int id) override;
+    int _obtain_id(Tracer<>& trc, const LevTrEntry& desc) override;
 
 public:
     MySQLLevTr(v7::Transaction& tr, dballe::sql::MySQLConnection& conn);
@@ -34,10 +37,6 @@ public:
     MySQLLevTr(const LevTr&&)                = delete;
     MySQLLevTr& operator=(const MySQLLevTr&) = delete;
     ~MySQLLevTr();
-
-    void prefetch_ids(Tracer<>& trc, const std::set<int>& ids) override;
-    const LevTrEntry* lookup_id(Tracer<>& trc, int id) override;
-    int obtain_id(Tracer<>& trc, const LevTrEntry& desc) override;
 };
 
 } // namespace mysql
@@ -0,0 +1,79 @@
+#include "pool.h"
+#include "dballe/db.h"
+#include "dballe/sql/sql.h"
+#include "driver.h"
+#include <wreport/error.h>
+
+using namespace wreport;
+using namespace std;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+
+PooledConnection::PooledConnection(
+    std::shared_ptr<dballe::sql::Connection> conn)
+    : conn(conn), driver(v7::Driver::create(*conn))
+{
+}
+
+PooledConnection::~PooledConnection() {}
+
+ConnectionPool::ConnectionPool(const std::string& url, unsigned size)
+    : url(url), size(size)
+{
+    if (url == "sqlite://" || url == "sqlite://:memory:")
+        throw error_consistency(
+            "cannot open more connections to a temporary SQLite database");
+}
+
+ConnectionPool::~ConnectionPool() {}
+
+std::shared_ptr<PooledConnection> ConnectionPool::acquire()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (idle.empty() && opened >= size)
+        released.wait(lock);
+
+    PooledConnection* res;
+    if (!idle.empty())
+    {
+        res = idle.back().release();
+        idle.pop_back();
+    }
+    else
+    {
+        // Open a new connection without holding the lock, to let other
+        // threads use the idle ones meanwhile
+        ++opened;
+        lock.unlock();
+        try
+        {
+            auto options = DBConnectOptions::create(url);
+            res = new PooledConnection(sql::Connection::create(*options));
+        }
+        catch (...)
+        {
+            lock.lock();
+            --opened;
+            released.notify_one();
+            throw;
+        }
+    }
+
+    return std::shared_ptr<PooledConnection>(
+        res, [this](PooledConnection* c) { release(c); });
+}
+
+void ConnectionPool::release(PooledConnection* conn)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.emplace_back(conn);
+    }
+    released.notify_one();
+}
+
+} // namespace v7
+} // namespace db
+} // namespace dballe
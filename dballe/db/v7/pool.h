@@ -0,0 +1,77 @@
+#ifndef DBALLE_DB_V7_POOL_H
+#define DBALLE_DB_V7_POOL_H
+
+#include <condition_variable>
+#include <dballe/db/v7/fwd.h>
+#include <dballe/sql/fwd.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+
+/// Database connection owned by a ConnectionPool, with its driver
+struct PooledConnection
+{
+    std::shared_ptr<dballe::sql::Connection> conn;
+    std::unique_ptr<v7::Driver> driver;
+
+    PooledConnection(std::shared_ptr<dballe::sql::Connection> conn);
+    PooledConnection(const PooledConnection&)            = delete;
+    PooledConnection(PooledConnection&&)                 = delete;
+    PooledConnection& operator=(const PooledConnection&) = delete;
+    PooledConnection& operator=(PooledConnection&&)      = delete;
+    ~PooledConnection();
+};
+
+/**
+ * Pool of extra connections to the same database, used to run read-only
+ * transactions concurrently.
+ *
+ * Connections are opened on demand, up to the given size. When all are in
+ * use, acquire() waits until one is released.
+ *
+ * All methods are thread-safe.
+ */
+class ConnectionPool
+{
+protected:
+    /// URL used to open new connections
+    std::string url;
+    /// Maximum number of connections
+    unsigned size;
+    /// Number of connections currently open
+    unsigned opened = 0;
+    /// Connections currently not in use
+    std::vector<std::unique_ptr<PooledConnection>> idle;
+    std::mutex mutex;
+    std::condition_variable released;
+
+    /// Return a connection to the pool
+    void release(PooledConnection* conn);
+
+public:
+    ConnectionPool(const std::string& url, unsigned size);
+    ConnectionPool(const ConnectionPool&)            = delete;
+    ConnectionPool(ConnectionPool&&)                 = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(ConnectionPool&&)      = delete;
+    ~ConnectionPool();
+
+    /**
+     * Get a connection for exclusive use, which goes back to the pool when
+     * the last reference to it is dropped.
+     *
+     * The pool must outlive all the connections it returns.
+     */
+    std::shared_ptr<PooledConnection> acquire();
+};
+
+} // namespace v7
+} // namespace db
+} // namespace dballe
+
+#endif
@@ -27,6 +27,15 @@ namespace postgresql {
 template class PostgreSQLDataCommon<StationData>;
 template class PostgreSQLDataCommon<Data>;
 
+namespace {
+
+/// ON CONFLICT actions used by upsert
+const char* on_conflict_replace =
+    "DO UPDATE SET value=EXCLUDED.value, attrs=EXCLUDED.attrs";
+const char* on_conflict_keep = "DO NOTHING";
+
+} // namespace
+
 template <typename Parent>
 PostgreSQLDataCommon<Parent>::PostgreSQLDataCommon(
     v7::Transaction& tr, dballe::sql::PostgreSQLConnection& conn)
@@ -58,6 +67,19 @@ void PostgreSQLDataCommon<Parent>::read_attrs(
         trc_sel->add_row();
 }
 
+template <typename Parent>
+void PostgreSQLDataCommon<Parent>::run_attrs_query(
+    Tracer<>& trc, const std::string& query,
+    std::function<void(int id_data, std::vector<uint8_t> attrs)> dest)
+{
+    Tracer<> trc_sel(trc ? trc->trace_select(query) : nullptr);
+    Result res = conn.exec(query);
+    if (trc_sel)
+        trc_sel->add_row(res.rowcount());
+    for (unsigned row = 0; row < res.rowcount(); ++row)
+        dest(res.get_int4(row, 0), res.get_bytea(row, 1));
+}
+
 template <typename Parent>
 void PostgreSQLDataCommon<Parent>::write_attrs(Tracer<>& trc, int id_data,
                                                const Values& values)
@@ -118,18 +140,9 @@ void PostgreSQLDataCommon<Parent>::remove(Tracer<>& trc,
     if (!qb.query.attr_filter.empty())
     {
         // We need to apply attr_filter to all results of the query, so we
-        // iterate the results and delete the matching ones one by one.
+        // collect the IDs of the matching ones and delete them in batches
         std::unique_ptr<Varmatch> attr_filter =
             Varmatch::parse(qb.query.attr_filter);
-        if (remove_data_query_name.empty())
-        {
-            remove_data_query_name = Parent::table_name;
-            remove_data_query_name += "v7_remove_data";
-            char query[64];
-            snprintf(query, 64, "DELETE FROM %s WHERE id=$1::int4",
-                     Parent::table_name);
-            conn.prepare(remove_data_query_name, query);
-        }
 
         Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
         Result to_remove;
@@ -140,15 +153,15 @@ void PostgreSQLDataCommon<Parent>::remove(Tracer<>& trc,
         if (trc_sel)
             trc_sel->add_row(to_remove.rowcount());
         trc_sel.done();
+
+        std::vector<int> ids;
         for (unsigned row = 0; row < to_remove.rowcount(); ++row)
         {
             if (!match_attrs(*attr_filter, to_remove.get_bytea(row, 1)))
-                return;
-            Tracer<> trc_del(trc ? trc->trace_delete(remove_data_query_name, 1)
-                                 : nullptr);
-            conn.exec_prepared(remove_data_query_name,
-                               (int)to_remove.get_int4(row, 0));
+                continue;
+            ids.push_back(to_remove.get_int4(row, 0));
         }
+        this->remove_ids(trc, ids);
     }
     else
     {
@@ -266,6 +279,21 @@ void PostgreSQLStationData::query(
 void PostgreSQLStationData::insert(Tracer<>& trc, int id_station,
                                    std::vector<batch::StationDatum>& vars,
                                    bool with_attrs)
+{
+    write(trc, id_station, vars, with_attrs, nullptr);
+}
+
+void PostgreSQLStationData::upsert(Tracer<>& trc, int id_station,
+                                   std::vector<batch::StationDatum>& vars,
+                                   bool with_attrs, bool overwrite)
+{
+    write(trc, id_station, vars, with_attrs,
+          overwrite ? on_conflict_replace : on_conflict_keep);
+}
+
+void PostgreSQLStationData::write(Tracer<>& trc, int id_station,
+                                  std::vector<batch::StationDatum>& vars,
+                                  bool with_attrs, const char* on_conflict)
 {
     std::sort(vars.begin(), vars.end());
 
@@ -300,31 +328,35 @@ void PostgreSQLStationData::insert(Tracer<>& trc, int id_station,
         dq.append(")");
         ++count;
     }
-    dq.append(" RETURNING id");
+    if (on_conflict)
+    {
+        dq.append(" ON CONFLICT (id_station, code) ");
+        dq.append(on_conflict);
+    }
+    dq.append(" RETURNING id, code");
 
     // fprintf(stderr, "Insert query: %s\n", dq.c_str());
 
-    // Run the insert query and read back the new IDs
+    // Run the insert query and read back the new IDs. Match them by code,
+    // since no row is returned for existing values that are kept
     Tracer<> trc_ins(trc ? trc->trace_insert(dq, count) : nullptr);
     Result res(conn.exec(dq));
-    unsigned row = 0;
-    for (auto v = vars.begin(); v != vars.end(); ++v)
+    auto by_code = [](const batch::StationDatum& d, wreport::Varcode c) {
+        return d.var->code() < c;
+    };
+    for (unsigned row = 0; row < res.rowcount(); ++row)
     {
-        // Skip duplicates
-        auto next = v + 1;
-        if (next != vars.end() && *v == *next)
-            continue;
-        if (row >= res.rowcount())
-            break;
-        v->id = res.get_int4(row, 0);
-        ++row;
+        wreport::Varcode code = (Varcode)res.get_int4(row, 1);
+        auto v = std::lower_bound(vars.begin(), vars.end(), code, by_code);
+        for (; v != vars.end() && v->var->code() == code; ++v)
+            v->id = res.get_int4(row, 0);
     }
 }
 
 void PostgreSQLStationData::run_station_data_query(
     Tracer<>& trc, const v7::DataQueryBuilder& qb,
     std::function<void(const dballe::DBStation& station, int id_data,
-                       std::unique_ptr<wreport::Var> var)>
+                       wreport::Var&& var, std::vector<uint8_t>&& attrs)>
         dest)
 {
     Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
@@ -354,12 +386,13 @@ void PostgreSQLStationData::run_station_data_query(
         {
             wreport::Varcode code = res.get_int4(row, 5);
             const char* value     = res.get_string(row, 7);
-            auto var              = newvar(code, value);
+            auto var              = dballe::var(code, value);
+            std::vector<uint8_t> attrs;
             if (qb.select_attrs)
-                core::value::Decoder::decode_attrs(res.get_bytea(row, 8), *var);
+                attrs = res.get_bytea(row, 8);
 
             // Postprocessing filter of attr_filter
-            if (qb.attr_filter && !qb.match_attrs(*var))
+            if (qb.attr_filter && !qb.match_attrs(attrs))
                 return;
 
             int id_station = res.get_int4(row, 0);
@@ -378,7 +411,7 @@ void PostgreSQLStationData::run_station_data_query(
 
             int id_data = res.get_int4(row, 6);
 
-            dest(station, id_data, move(var));
+            dest(station, id_data, move(var), move(attrs));
         }
     });
 }
@@ -400,12 +433,65 @@ void PostgreSQLStationData::dump(FILE* out)
     dumper.print_tail();
 }
 
-PostgreSQLData::PostgreSQLData(v7::Transaction& tr, PostgreSQLConnection& conn)
-    : PostgreSQLDataCommon(tr, conn)
+namespace {
+
+/// Datetime range covered by a partition of the data table
+struct Partition
+{
+    std::string name;
+    /// First datetime in the partition
+    Datetime min;
+    /// Last datetime in the partition
+    Datetime max;
+    /// First datetime after the partition
+    Datetime end;
+
+    Partition(const std::string& partitioning, int year, int month)
+    {
+        char buf[32];
+        if (partitioning == "monthly")
+        {
+            snprintf(buf, 32, "data_p%04d_%02d", year, month);
+            min = Datetime(year, month);
+            max = Datetime::upper_bound(year, month, MISSING_INT, MISSING_INT,
+                                        MISSING_INT, MISSING_INT);
+            end =
+                month == 12 ? Datetime(year + 1, 1) : Datetime(year, month + 1);
+        }
+        else
+        {
+            snprintf(buf, 32, "data_p%04d", year);
+            min = Datetime(year);
+            max = Datetime::upper_bound(year, MISSING_INT, MISSING_INT,
+                                        MISSING_INT, MISSING_INT, MISSING_INT);
+            end = Datetime(year + 1);
+        }
+        name = buf;
+    }
+
+    /// Parse a partition table name, returning false if it is not valid
+    static bool parse(const std::string& partitioning, const char* name,
+                      int& year, int& month)
+    {
+        month = 1;
+        if (partitioning == "monthly")
+            return sscanf(name, "data_p%d_%d", &year, &month) == 2;
+        else
+            return sscanf(name, "data_p%d", &year) == 1;
+    }
+};
+
+} // namespace
+
+PostgreSQLData::PostgreSQLData(v7::Transaction& tr, PostgreSQLConnection& conn,
+                               const std::string& partitioning)
+    : PostgreSQLDataCommon(tr, conn), partitioning(partitioning)
 {
     conn.prepare("datav7_select",
                  "SELECT id, id_levtr, code FROM data WHERE "
                  "id_station=$1::int4 AND datetime=$2::timestamp");
+    conn.prepare("datav7_select_last_datetime",
+                 "SELECT MAX(datetime) FROM data WHERE id_station=$1::int4");
 }
 
 void PostgreSQLData::query(
@@ -425,13 +511,46 @@ void PostgreSQLData::query(
     }
 }
 
+Datetime PostgreSQLData::last_datetime(Tracer<>& trc, int id_station)
+{
+    Tracer<> trc_sel(trc ? trc->trace_select("datav7_select_last_datetime")
+                         : nullptr);
+    auto res =
+        conn.exec_prepared_one_row("datav7_select_last_datetime", id_station);
+    if (trc_sel)
+        trc_sel->add_row(res.rowcount());
+    if (res.is_null(0, 0))
+        return Datetime();
+    return res.get_timestamp(0, 0);
+}
+
 void PostgreSQLData::insert(Tracer<>& trc, int id_station,
                             const Datetime& datetime,
                             std::vector<batch::MeasuredDatum>& vars,
                             bool with_attrs)
+{
+    write(trc, id_station, datetime, vars, with_attrs, nullptr);
+}
+
+void PostgreSQLData::upsert(Tracer<>& trc, int id_station,
+                            const Datetime& datetime,
+                            std::vector<batch::MeasuredDatum>& vars,
+                            bool with_attrs, bool overwrite)
+{
+    write(trc, id_station, datetime, vars, with_attrs,
+          overwrite ? on_conflict_replace : on_conflict_keep);
+}
+
+void PostgreSQLData::write(Tracer<>& trc, int id_station,
+                           const Datetime& datetime,
+                           std::vector<batch::MeasuredDatum>& vars,
+                           bool with_attrs, const char* on_conflict)
 {
     std::sort(vars.begin(), vars.end());
 
+    if (!partitioning.empty())
+        ensure_partition(trc, datetime);
+
     const Datetime& dt = datetime;
     char val_lead[64];
     snprintf(val_lead, 64, "(DEFAULT,%d,'%04d-%02d-%02d %02d:%02d:%02d',",
@@ -468,32 +587,114 @@ void PostgreSQLData::insert(Tracer<>& trc, int id_station,
         dq.append(")");
         ++count;
     }
-    dq.append(" RETURNING id");
+    if (on_conflict)
+    {
+        dq.append(" ON CONFLICT (id_station, datetime, id_levtr, code) ");
+        dq.append(on_conflict);
+    }
+    dq.append(" RETURNING id, id_levtr, code");
 
     // fprintf(stderr, "Insert query: %s\n", dq.c_str());
 
-    // Run the insert query and read back the new IDs
+    // Run the insert query and read back the new IDs. Match them by levtr
+    // and code, since no row is returned for existing values that are kept
     Tracer<> trc_ins(trc ? trc->trace_insert(dq, count) : nullptr);
     Result res(conn.exec(dq));
-    unsigned row = 0;
-    for (auto v = vars.begin(); v != vars.end(); ++v)
+    auto by_key = [](const batch::MeasuredDatum& d, const IdVarcode& key) {
+        return d.id_levtr < key.id ||
+               (d.id_levtr == key.id && d.var->code() < key.varcode);
+    };
+    for (unsigned row = 0; row < res.rowcount(); ++row)
     {
-        // Skip duplicates
-        auto next = v + 1;
-        if (next != vars.end() && *v == *next)
+        IdVarcode key(res.get_int4(row, 1), (Varcode)res.get_int4(row, 2));
+        auto v = std::lower_bound(vars.begin(), vars.end(), key, by_key);
+        for (; v != vars.end() && v->id_levtr == key.id &&
+               v->var->code() == key.varcode;
+             ++v)
+            v->id = res.get_int4(row, 0);
+    }
+}
+
+void PostgreSQLData::ensure_partition(Tracer<>& trc, const Datetime& dt)
+{
+    Partition part(partitioning, dt.year, dt.month);
+    if (partitions.find(part.name) != partitions.end())
+        return;
+
+    // IF NOT EXISTS avoids failing if another writer creates the same
+    // partition concurrently
+    Querybuf q(256);
+    q.appendf(
+        "CREATE TABLE IF NOT EXISTS %s PARTITION OF data FOR VALUES FROM (",
+        part.name.c_str());
+    conn.add_datetime(q, part.min);
+    q.append(") TO (");
+    conn.add_datetime(q, part.end);
+    q.append(")");
+    Tracer<> trc_ins(trc ? trc->trace_insert(q) : nullptr);
+    conn.exec_no_data(q.c_str());
+    partitions.insert(part.name);
+}
+
+void PostgreSQLData::drop_covered_partitions(Tracer<>& trc,
+                                             const v7::IdQueryBuilder& qb)
+{
+    // Only drop partitions if the query does not filter on anything except
+    // datetime
+    core::Query rest(qb.query);
+    rest.dtrange = DatetimeRange();
+    if (!rest.empty())
+        return;
+
+    const DatetimeRange& dtrange = qb.query.dtrange;
+    Tracer<> trc_sel(
+        trc ? trc->trace_select("SELECT relname FROM pg_inherits …") : nullptr);
+    Result res = conn.exec(R"(
+        SELECT c.relname
+          FROM pg_catalog.pg_inherits i
+          JOIN pg_catalog.pg_class c ON c.oid = i.inhrelid
+         WHERE i.inhparent = 'data'::regclass
+    )");
+    if (trc_sel)
+        trc_sel->add_row(res.rowcount());
+    trc_sel.done();
+
+    for (unsigned row = 0; row < res.rowcount(); ++row)
+    {
+        const char* name = res.get_string(row, 0);
+        int year, month;
+        if (!Partition::parse(partitioning, name, year, month))
+            continue;
+        Partition part(partitioning, year, month);
+        if (part.name != name)
+            continue;
+        if (!dtrange.min.is_missing() && part.min < dtrange.min)
             continue;
-        if (row >= res.rowcount())
-            break;
-        v->id = res.get_int4(row, 0);
-        ++row;
+        if (!dtrange.max.is_missing() && part.max > dtrange.max)
+            continue;
+
+        Querybuf q(64);
+        q.appendf("DROP TABLE %s", name);
+        Tracer<> trc_del(trc ? trc->trace_delete(q) : nullptr);
+        conn.exec_no_data(q.c_str());
+        partitions.erase(part.name);
     }
 }
 
+void PostgreSQLData::remove(Tracer<>& trc, const v7::IdQueryBuilder& qb)
+{
+    // Drop partitions whole when possible, then delete what remains with a
+    // normal query, which will only visit the partitions left
+    if (!partitioning.empty())
+        drop_covered_partitions(trc, qb);
+    PostgreSQLDataCommon::remove(trc, qb);
+}
+
 void PostgreSQLData::run_data_query(
     Tracer<>& trc, const v7::DataQueryBuilder& qb,
     std::function<void(const dballe::DBStation& station, int id_levtr,
                        const Datetime& datetime, int id_data,
-                       std::unique_ptr<wreport::Var> var)>
+                       wreport::Var&& var, std::vector<uint8_t>&& attrs)>
         dest)
 {
     Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
@@ -523,13 +724,13 @@ void PostgreSQLData::run_data_query(
         {
             wreport::Varcode code = res.get_int4(row, 6);
             const char* value     = res.get_string(row, 9);
-            auto var              = newvar(code, value);
+            auto var              = dballe::var(code, value);
+            std::vector<uint8_t> attrs;
             if (qb.select_attrs)
-                core::value::Decoder::decode_attrs(res.get_bytea(row, 10),
-                                                   *var);
+                attrs = res.get_bytea(row, 10);
 
             // Postprocessing filter of attr_filter
-            if (qb.attr_filter && !qb.match_attrs(*var))
+            if (qb.attr_filter && !qb.match_attrs(attrs))
                 return;
 
             int id_station = res.get_int4(row, 0);
@@ -550,7 +751,7 @@ void PostgreSQLData::run_data_query(
             int id_data       = res.get_int4(row, 7);
             Datetime datetime = res.get_timestamp(row, 8);
 
-            dest(station, id_levtr, datetime, id_data, move(var));
+            dest(station, id_levtr, datetime, id_data, move(var), move(attrs));
         }
     });
 }
@@ -4,6 +4,8 @@
 #include <dballe/db/v7/cache.h>
 #include <dballe/db/v7/data.h>
 #include <dballe/sql/fwd.h>
+#include <set>
+#include <string>
 
 namespace dballe {
 namespace db {
@@ -19,7 +21,6 @@ protected:
     std::string select_attrs_query_name;
     std::string write_attrs_query_name;
     std::string remove_attrs_query_name;
-    std::string remove_data_query_name;
 
 public:
     PostgreSQLDataCommon(v7::Transaction& tr,
@@ -33,6 +34,10 @@ public:
     void read_attrs(
         Tracer<>& trc, int id_data,
         std::function<void(std::unique_ptr<wreport::Var>)> dest) override;
+    void run_attrs_query(Tracer<>& trc, const std::string& query,
+                         std::function<void(int id_data,
+                                            std::vector<uint8_t> attrs)>
+                             dest) override;
     void write_attrs(Tracer<>& trc, int id_data, const Values& values) override;
     void remove_all_attrs(Tracer<>& trc, int id_data) override;
     void remove(Tracer<>& trc, const v7::IdQueryBuilder& qb) override;
@@ -44,6 +49,15 @@ extern template class PostgreSQLDataCommon<Data>;
 
 class PostgreSQLStationData : public PostgreSQLDataCommon<StationData>
 {
+protected:
+    /**
+     * Insert vars, resolving conflicts with the given ON CONFLICT action if
+     * it is not nullptr
+     */
+    void write(Tracer<>& trc, int id_station,
+               std::vector<batch::StationDatum>& vars, bool with_attrs,
+               const char* on_conflict);
+
 public:
     using PostgreSQLDataCommon::PostgreSQLDataCommon;
 
@@ -56,40 +70,77 @@ public:
     void insert(Tracer<>& trc, int id_station,
                 std::vector<batch::StationDatum>& vars,
                 bool with_attrs) override;
+    void upsert(Tracer<>& trc, int id_station,
+                std::vector<batch::StationDatum>& vars, bool with_attrs,
+                bool overwrite) override;
     void run_station_data_query(
         Tracer<>& trc, const v7::DataQueryBuilder& qb,
         std::function<void(const dballe::DBStation& station, int id_data,
-                           std::unique_ptr<wreport::Var> var)>) override;
+                           wreport::Var&& var,
+                           std::vector<uint8_t>&& attrs)>) override;
     void dump(FILE* out) override;
     void clear_cache() override {}
 };
 
 class PostgreSQLData : public PostgreSQLDataCommon<Data>
 {
+protected:
+    /**
+     * Partitioning scheme of the data table: empty if the table is not
+     * partitioned, "monthly" or "yearly" otherwise
+     */
+    std::string partitioning;
+
+    /// Names of the partitions known to exist
+    std::set<std::string> partitions;
+
+    /**
+     * Insert vars, resolving conflicts with the given ON CONFLICT action if
+     * it is not nullptr
+     */
+    void write(Tracer<>& trc, int id_station, const Datetime& datetime,
+               std::vector<batch::MeasuredDatum>& vars, bool with_attrs,
+               const char* on_conflict);
+
+    /// Create the partition for dt if it does not exist yet
+    void ensure_partition(Tracer<>& trc, const Datetime& dt);
+
+    /**
+     * Drop all the partitions fully contained in the datetime range of qb, if
+     * it has no other filters.
+     */
+    void drop_covered_partitions(Tracer<>& trc, const v7::IdQueryBuilder& qb);
+
 public:
     using PostgreSQLDataCommon::PostgreSQLDataCommon;
 
-    PostgreSQLData(v7::Transaction& tr,
-                   dballe::sql::PostgreSQLConnection& conn);
+    PostgreSQLData(v7::Transaction& tr, dballe::sql::PostgreSQLConnection& conn,
+                   const std::string& partitioning = std::string());
 
     void query(Tracer<>& trc, int id_station, const Datetime& datetime,
                std::function<void(int id, int id_levtr, wreport::Varcode code)>
                    dest) override;
+    Datetime last_datetime(Tracer<>& trc, int id_station) override;
     void insert(Tracer<>& trc, int id_station, const Datetime& datetime,
                 std::vector<batch::MeasuredDatum>& vars,
                 bool with_attrs) override;
+    void upsert(Tracer<>& trc, int id_station, const Datetime& datetime,
+                std::vector<batch::MeasuredDatum>& vars, bool with_attrs,
+                bool overwrite) override;
     void run_data_query(
         Tracer<>& trc, const v7::DataQueryBuilder& qb,
         std::function<void(const dballe::DBStation& station, int id_levtr,
                            const Datetime& datetime, int id_data,
-                           std::unique_ptr<wreport::Var> var)>) override;
+                           wreport::Var&& var,
+                           std::vector<uint8_t>&& attrs)>) override;
     void run_summary_query(
         Tracer<>& trc, const v7::SummaryQueryBuilder& qb,
         std::function<void(const dballe::DBStation& station, int id_levtr,
                            wreport::Varcode code, const DatetimeRange& datetime,
                            size_t size)>) override;
+    void remove(Tracer<>& trc, const v7::IdQueryBuilder& qb) override;
     void dump(FILE* out) override;
-    void clear_cache() override {}
+    void clear_cache() override { partitions.clear(); }
 };
 
 } // namespace postgresql
@@ -9,6 +9,7 @@
 #include "repinfo.h"
 #include "station.h"
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
 
 using namespace std;
@@ -21,7 +22,11 @@ namespace db {
 namespace v7 {
 namespace postgresql {
 
-Driver::Driver(PostgreSQLConnection& conn) : v7::Driver(conn), conn(conn) {}
+Driver::Driver(PostgreSQLConnection& conn)
+    : v7::Driver(conn), conn(conn),
+      partitioning(conn.get_setting("partitioning"))
+{
+}
 
 Driver::~Driver() {}
 
@@ -48,7 +53,7 @@ Driver::create_station_data(v7::Transaction& tr)
 
 std::unique_ptr<v7::Data> Driver::create_data(v7::Transaction& tr)
 {
-    return unique_ptr<v7::Data>(new PostgreSQLData(tr, conn));
+    return unique_ptr<v7::Data>(new PostgreSQLData(tr, conn, partitioning));
 }
 
 void Driver::create_tables_v7()
@@ -106,23 +111,56 @@ void Driver::create_tables_v7()
     conn.exec_no_data("CREATE UNIQUE INDEX station_data_uniq on "
                       "station_data(id_station, code);");
 
-    conn.exec_no_data(R"(
-        CREATE TABLE data (
-           id          SERIAL PRIMARY KEY,
-           id_station  INTEGER NOT NULL REFERENCES station (id) ON DELETE CASCADE,
-           id_levtr    INTEGER NOT NULL REFERENCES levtr(id) ON DELETE CASCADE,
-           datetime    TIMESTAMP NOT NULL,
-           code        INTEGER NOT NULL,
-           value       VARCHAR(255) NOT NULL,
-           attrs       BYTEA
-        );
-    )");
+    // Optionally partition the data table by datetime
+    string new_partitioning;
+    if (const char* env = getenv("DBA_DB_PARTITION"))
+        new_partitioning = env;
+    if (!new_partitioning.empty() && new_partitioning != "monthly" &&
+        new_partitioning != "yearly")
+        error_consistency::throwf("unsupported DBA_DB_PARTITION value '%s': "
+                                  "use 'monthly' or 'yearly'",
+                                  new_partitioning.c_str());
+
+    if (new_partitioning.empty())
+    {
+        conn.exec_no_data(R"(
+            CREATE TABLE data (
+               id          SERIAL PRIMARY KEY,
+               id_station  INTEGER NOT NULL REFERENCES station (id) ON DELETE CASCADE,
+               id_levtr    INTEGER NOT NULL REFERENCES levtr(id) ON DELETE CASCADE,
+               datetime    TIMESTAMP NOT NULL,
+               code        INTEGER NOT NULL,
+               value       VARCHAR(255) NOT NULL,
+               attrs       BYTEA
+            );
+        )");
+    }
+    else
+    {
+        // Partitions are created as needed when inserting data. The primary
+        // key of a partitioned table needs to include the partition key.
+        conn.exec_no_data(R"(
+            CREATE TABLE data (
+               id          SERIAL,
+               id_station  INTEGER NOT NULL REFERENCES station (id) ON DELETE CASCADE,
+               id_levtr    INTEGER NOT NULL REFERENCES levtr(id) ON DELETE CASCADE,
+               datetime    TIMESTAMP NOT NULL,
+               code        INTEGER NOT NULL,
+               value       VARCHAR(255) NOT NULL,
+               attrs       BYTEA,
+               PRIMARY KEY (id, datetime)
+            ) PARTITION BY RANGE (datetime);
+        )");
+    }
     conn.exec_no_data("CREATE UNIQUE INDEX data_uniq on data(id_station, "
                       "datetime, id_levtr, code);");
     // When possible, replace with a postgresql 9.5 BRIN index
     conn.exec_no_data("CREATE INDEX data_dt ON data(datetime);");
 
     conn.set_setting("version", "V7");
+    if (!new_partitioning.empty())
+        conn.set_setting("partitioning", new_partitioning);
+    partitioning = new_partitioning;
 }
 void Driver::delete_tables_v7()
 {
@@ -132,6 +170,7 @@ void Driver::delete_tables_v7()
     conn.drop_table_if_exists("station");
     conn.drop_table_if_exists("repinfo");
     conn.drop_settings();
+    partitioning.clear();
 }
 void Driver::vacuum_v7()
 {
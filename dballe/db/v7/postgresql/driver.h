@@ -3,6 +3,7 @@
 
 #include <dballe/db/v7/driver.h>
 #include <dballe/sql/fwd.h>
+#include <string>
 
 namespace dballe {
 namespace db {
@@ -13,6 +14,12 @@ struct Driver : public v7::Driver
 {
     dballe::sql::PostgreSQLConnection& conn;
 
+    /**
+     * Partitioning scheme of the data table: empty if the table is not
+     * partitioned, "monthly" or "yearly" otherwise
+     */
+    std::string partitioning;
+
     Driver(dballe::sql::PostgreSQLConnection& conn);
     virtual ~Driver();
 
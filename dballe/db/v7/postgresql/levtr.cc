@@ -56,7 +56,7 @@ PostgreSQLLevTr::PostgreSQLLevTr(v7::Transaction& tr,
 
 PostgreSQLLevTr::~PostgreSQLLevTr() {}
 
-void PostgreSQLLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
+void PostgreSQLLevTr::_prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
 {
     if (ids.empty())
         return;
@@ -84,13 +84,9 @@ void PostgreSQLLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
                            to_trange(res, row, 5))));
 }
 
-const LevTrEntry* PostgreSQLLevTr::lookup_id(Tracer<>& trc, int id)
+const LevTrEntry* PostgreSQLLevTr::_lookup_id(Tracer<>& trc, int id)
 {
     using namespace dballe::sql::postgresql;
-    const LevTrEntry* e = cache.find_entry(id);
-    if (e)
-        return e;
-
     Tracer<> trc_sel(trc ? trc->trace_select("v7_levtr_select_data") : nullptr);
     auto res = conn.exec_prepared("v7_levtr_select_data", id);
     if (trc_sel)
@@ -109,12 +105,10 @@ const LevTrEntry* PostgreSQLLevTr::lookup_id(Tracer<>& trc, int id)
     }
 }
 
-int PostgreSQLLevTr::obtain_id(Tracer<>& trc, const LevTrEntry& desc)
+int PostgreSQLLevTr::_obtain_id(Tracer<>& trc, const LevTrEntry& desc)
 {
     using namespace dballe::sql::postgresql;
-    int id = cache.find_id(desc);
-    if (id != MISSING_INT)
-        return id;
+    int id;
 
     Tracer<> trc_oid(trc ? trc->trace_select("v7_levtr_select_id") : nullptr);
     Result res =
@@ -24,6 +24,9 @@ protected:
 
     void
     _dump(std::function<void(int, const Level&, const Trange&)> out) override;
+    void _prefetch_ids(Tracer<>& trc, const std::set<int>& ids) override;
+    const LevTrEntry* _lookup_id(Tracer<>& trc, int id) override;
+    int _obtain_id(Tracer<>& trc, const LevTrEntry& desc) override;
 
 public:
     PostgreSQLLevTr(v7::Transaction& tr,
@@ -32,10 +35,6 @@ public:
     PostgreSQLLevTr(const LevTr&&)                     = delete;
     PostgreSQLLevTr& operator=(const PostgreSQLLevTr&) = delete;
     ~PostgreSQLLevTr();
-
-    void prefetch_ids(Tracer<>& trc, const std::set<int>& ids) override;
-    const LevTrEntry* lookup_id(Tracer<>& trc, int id) override;
-    int obtain_id(Tracer<>& trc, const LevTrEntry& desc) override;
 };
 
 } // namespace postgresql
@@ -3,6 +3,7 @@
 #include "dballe/core/aliases.h"
 #include "dballe/core/defs.h"
 #include "dballe/core/query.h"
+#include "dballe/core/values.h"
 #include "dballe/core/varmatch.h"
 #include "dballe/db/v7/repinfo.h"
 #include "dballe/sql/sql.h"
@@ -11,6 +12,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <regex.h>
+#include <sqlite3.h>
 #include <wreport/var.h>
 #ifdef HAVE_LIBPQ
 #include "dballe/sql/postgresql.h"
@@ -254,7 +256,7 @@ struct Constraints
 QueryBuilder::QueryBuilder(std::shared_ptr<v7::Transaction> tr,
                            const core::Query& query, unsigned int modifiers,
                            bool query_station_vars)
-    : conn(*tr->db->conn), tr(tr), query(query), sql_query(2048),
+    : conn(*tr->conn), tr(tr), query(query), sql_query(2048),
       sql_from(1024), sql_where(1024), modifiers(modifiers),
       query_station_vars(query_station_vars)
 {
@@ -284,12 +286,7 @@ void QueryBuilder::build()
     }
 
     // Finalise the query
-    sql_query.append(sql_from);
-    if (has_where)
-    {
-        sql_query.append(" WHERE ");
-        sql_query.append(sql_where);
-    }
+    build_from_where(has_where);
 
     // Append ORDER BY as needed
     if (!(modifiers & DBA_DB_MODIFIER_UNSORTED))
@@ -307,6 +304,16 @@ void QueryBuilder::build()
         sql_query.appendf(" LIMIT %d", query.limit);
 }
 
+void QueryBuilder::build_from_where(bool has_where)
+{
+    sql_query.append(sql_from);
+    if (has_where)
+    {
+        sql_query.append(" WHERE ");
+        sql_query.append(sql_where);
+    }
+}
+
 void StationQueryBuilder::build_select()
 {
     sql_query.append("SELECT s.id, s.rep, s.lat, s.lon, s.ident");
@@ -399,6 +406,24 @@ void DataQueryBuilder::build_select()
     select_data    = true;
     sql_from.append(" FROM station s");
 
+    // Compute query=best and query=last in SQL when the database can do it.
+    // attr_filter is checked in C++ after the query, so in that case we fall
+    // back to filtering the results in the cursor
+    if (!query_station_vars &&
+        (modifiers & (DBA_DB_MODIFIER_BEST | DBA_DB_MODIFIER_LAST)) &&
+        query.attr_filter.empty())
+    {
+        switch (conn.server_type)
+        {
+            case ServerType::SQLITE:
+                // Window functions are available since SQLite 3.25
+                best_last_in_sql = sqlite3_libversion_number() >= 3025000;
+                break;
+            case ServerType::POSTGRES: best_last_in_sql = true; break;
+            default:                   break;
+        }
+    }
+
     if (query_station_vars)
     {
         sql_from.append(" JOIN station_data d ON s.id=d.id_station");
@@ -429,10 +454,85 @@ bool DataQueryBuilder::build_where()
     return has_where;
 }
 
-bool DataQueryBuilder::match_attrs(const Var& var) const
+void DataQueryBuilder::build_from_where(bool has_where)
 {
-    for (const Var* a = var.next_attr(); a != NULL; a = a->next_attr())
-        if ((*attr_filter)(*a))
+    if (!best_last_in_sql)
+    {
+        QueryBuilder::build_from_where(has_where);
+        return;
+    }
+
+    // Select the rows whose IDs are chosen by query=best or query=last: all
+    // filtering happens in the inner query, so the outer one only needs to
+    // join the tables needed to output the results
+    sql_query.append(sql_from);
+    sql_query.append(" WHERE d.id IN (");
+    build_best_last_selector(has_where);
+    sql_query.append(")");
+}
+
+void DataQueryBuilder::build_best_last_selector(bool has_where)
+{
+    // Columns identifying the values among which query=best or query=last
+    // choose one
+    const char* group_by;
+    // Column used to pick the value to return, and join needed to access it
+    const char* pick;
+    const char* pick_join;
+    // Order of rows with the same pick value, keeping the one that filtering
+    // in the cursor would keep
+    const char* tie_break;
+    if (modifiers & DBA_DB_MODIFIER_BEST)
+    {
+        group_by  = "s.lat, s.lon, s.ident, d.id_levtr, d.datetime, d.code";
+        pick      = "r.prio";
+        pick_join = " JOIN repinfo r ON r.id=s.rep";
+        tie_break = "s.rep, d.id";
+    }
+    else
+    {
+        group_by  = "d.id_station, d.id_levtr, d.code";
+        pick      = "d.datetime";
+        pick_join = "";
+        tie_break = "d.id";
+    }
+
+    if (conn.server_type == ServerType::POSTGRES)
+    {
+        sql_query.appendf("SELECT DISTINCT ON (%s) d.id", group_by);
+        sql_query.append(sql_from);
+        sql_query.append(pick_join);
+        if (has_where)
+        {
+            sql_query.append(" WHERE ");
+            sql_query.append(sql_where);
+        }
+        sql_query.appendf(" ORDER BY %s, %s DESC, %s", group_by, pick,
+                          tie_break);
+    }
+    else
+    {
+        // Bare columns next to MAX would be taken from any of the rows with
+        // the maximum value, so number the rows of each group instead
+        sql_query.appendf("SELECT sel.id FROM (SELECT d.id AS id, ROW_NUMBER()"
+                          " OVER (PARTITION BY %s ORDER BY %s DESC, %s) AS pos",
+                          group_by, pick, tie_break);
+        sql_query.append(sql_from);
+        sql_query.append(pick_join);
+        if (has_where)
+        {
+            sql_query.append(" WHERE ");
+            sql_query.append(sql_where);
+        }
+        sql_query.append(") sel WHERE sel.pos=1");
+    }
+}
+
+bool DataQueryBuilder::match_attrs(const std::vector<uint8_t>& attrs) const
+{
+    core::value::Decoder dec(attrs);
+    while (dec.size)
+        if ((*attr_filter)(*dec.decode_var()))
             return true;
     return false;
 }
@@ -575,6 +675,11 @@ bool QueryBuilder::add_pa_where(const char* tbl)
         sql_where.append_listf("%s.id=%d", tbl, query.ana_id);
         c.found = true;
     }
+    if (shards > 1)
+    {
+        sql_where.append_listf("%s.id %% %u = %u", tbl, shards, shard);
+        c.found = true;
+    }
     c.add_lat();
     c.add_lon();
     c.add_mobile();
@@ -672,6 +777,8 @@ bool QueryBuilder::add_dt_where(const char* tbl)
     if (query_station_vars)
         return false;
 
+    // Datetimes are always compared with constants, so that PostgreSQL can
+    // prune the partitions of a partitioned data table at planning time
     bool found = false;
     if (!query.dtrange.is_missing())
     {
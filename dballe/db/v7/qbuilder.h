@@ -59,6 +59,14 @@ struct QueryBuilder
     /// True if we are querying station information, rather than measured data
     bool query_station_vars;
 
+    /**
+     * If more than 1, only select stations whose ID modulo shards is shard, to
+     * split a query in parts that can run concurrently
+     */
+    unsigned shards = 1;
+    /// Part of the query to select, when shards is more than 1
+    unsigned shard  = 0;
+
     QueryBuilder(std::shared_ptr<v7::Transaction> tr, const core::Query& query,
                  unsigned int modifiers, bool query_station_vars);
     virtual ~QueryBuilder() {}
@@ -74,6 +82,9 @@ protected:
     bool add_repinfo_where(const char* tbl);
     bool add_datafilter_where(const char* tbl);
 
+    /// Append the FROM and WHERE parts to sql_query
+    virtual void build_from_where(bool has_where);
+
     virtual void build_select()   = 0;
     virtual bool build_where()    = 0;
     virtual void build_order_by() = 0;
@@ -103,6 +114,12 @@ struct DataQueryBuilder : public QueryBuilder
     /// True if the select includes the attrs field
     bool select_attrs = false;
 
+    /**
+     * True if query=best or query=last are computed by the database, and the
+     * results need no further filtering
+     */
+    bool best_last_in_sql = false;
+
     DataQueryBuilder(std::shared_ptr<v7::Transaction> tr,
                      const core::Query& query, unsigned int modifiers,
                      bool query_station_vars);
@@ -110,12 +127,19 @@ struct DataQueryBuilder : public QueryBuilder
 
     // bool add_attrfilter_where(const char* tbl);
 
-    /// Match the attributes of var against attr_filter
-    bool match_attrs(const wreport::Var& var) const;
+    /// Match encoded attributes against attr_filter
+    bool match_attrs(const std::vector<uint8_t>& attrs) const;
 
     void build_select() override;
     bool build_where() override;
     void build_order_by() override;
+
+protected:
+    void build_from_where(bool has_where) override;
+
+    /// Append to sql_query a SELECT returning the data IDs chosen by
+    /// query=best or query=last
+    void build_best_last_selector(bool has_where);
 };
 
 struct IdQueryBuilder : public DataQueryBuilder
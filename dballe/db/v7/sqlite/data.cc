@@ -45,6 +45,18 @@ template <typename Parent> SQLiteDataCommon<Parent>::~SQLiteDataCommon()
     delete sstm;
     delete istm;
     delete ustm;
+    delete upsert_replace_stm;
+    delete upsert_keep_stm;
+}
+
+template <typename Parent> bool SQLiteDataCommon<Parent>::has_upsert() const
+{
+#if SQLITE_VERSION_NUMBER >= 3035000
+    // INSERT … RETURNING needs SQLite 3.35
+    return sqlite3_libversion_number() >= 3035000;
+#else
+    return false;
+#endif
 }
 
 template <typename Parent>
@@ -69,6 +81,20 @@ void SQLiteDataCommon<Parent>::read_attrs(
     });
 }
 
+template <typename Parent>
+void SQLiteDataCommon<Parent>::run_attrs_query(
+    Tracer<>& trc, const std::string& query,
+    std::function<void(int id_data, std::vector<uint8_t> attrs)> dest)
+{
+    auto stm = conn.sqlitestatement(query);
+    Tracer<> trc_sel(trc ? trc->trace_select(query) : nullptr);
+    stm->execute([&]() {
+        if (trc_sel)
+            trc_sel->add_row();
+        dest(stm->column_int(0), stm->column_blob(1));
+    });
+}
+
 template <typename Parent>
 void SQLiteDataCommon<Parent>::write_attrs(Tracer<>& trc, int id_data,
                                            const Values& values)
@@ -124,31 +150,45 @@ template <typename Parent>
 void SQLiteDataCommon<Parent>::remove(Tracer<>& trc,
                                       const v7::IdQueryBuilder& qb)
 {
-    char query[64];
-    snprintf(query, 64, "DELETE FROM %s WHERE id=?", Parent::table_name);
-    auto stmd = conn.sqlitestatement(query);
-    auto stm  = conn.sqlitestatement(qb.sql_query);
+    if (qb.query.attr_filter.empty())
+    {
+        // Delete all selected rows with a single query
+        Querybuf dq(512);
+        dq.append("DELETE FROM ");
+        dq.append(Parent::table_name);
+        dq.append(" WHERE id IN (");
+        dq.append(qb.sql_query);
+        dq.append(")");
+        Tracer<> trc_del(trc ? trc->trace_delete(dq) : nullptr);
+        auto stmd = conn.sqlitestatement(dq);
+        if (qb.bind_in_ident)
+            stmd->bind_val(1, qb.bind_in_ident);
+        stmd->execute();
+        if (trc_del)
+            trc_del->add_row(conn.changes());
+        return;
+    }
+
+    // We need to apply attr_filter to all results of the query, so we collect
+    // the IDs of the matching ones and delete them in batches
+    std::unique_ptr<Varmatch> attr_filter =
+        Varmatch::parse(qb.query.attr_filter);
+    std::vector<int> ids;
+    auto stm = conn.sqlitestatement(qb.sql_query);
     if (qb.bind_in_ident)
         stm->bind_val(1, qb.bind_in_ident);
 
-    std::unique_ptr<Varmatch> attr_filter;
-    if (!qb.query.attr_filter.empty())
-        attr_filter = Varmatch::parse(qb.query.attr_filter);
-
-    // Iterate all the data_id results, deleting the related data and attributes
     Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
     stm->execute([&]() {
         if (trc_sel)
             trc_sel->add_row();
-        if (attr_filter.get() &&
-            !match_attrs(*attr_filter, stm->column_blob(1)))
+        if (!match_attrs(*attr_filter, stm->column_blob(1)))
             return;
-
-        // Compile the DELETE query for the data
-        Tracer<> trc_del(trc ? trc->trace_delete(query, 1) : nullptr);
-        stmd->bind_val(1, stm->column_int(0));
-        stmd->execute();
+        ids.push_back(stm->column_int(0));
     });
+    trc_sel.done();
+
+    this->remove_ids(trc, ids);
 }
 
 template <typename Parent>
@@ -193,6 +233,13 @@ static const char* select_station_data_query =
 static const char* insert_station_data_query =
     "INSERT INTO station_data (id_station, code, value, attrs) VALUES (?, ?, "
     "?, ?)";
+static const char* upsert_replace_station_data_query =
+    "INSERT INTO station_data (id_station, code, value, attrs) VALUES (?, ?, "
+    "?, ?) ON CONFLICT (id_station, code) DO UPDATE SET value=excluded.value, "
+    "attrs=excluded.attrs RETURNING id";
+static const char* upsert_keep_station_data_query =
+    "INSERT INTO station_data (id_station, code, value, attrs) VALUES (?, ?, "
+    "?, ?) ON CONFLICT (id_station, code) DO NOTHING RETURNING id";
 
 SQLiteStationData::SQLiteStationData(v7::Transaction& tr,
                                      SQLiteConnection& conn)
@@ -247,10 +294,44 @@ void SQLiteStationData::insert(Tracer<>& trc, int id_station,
     }
 }
 
+void SQLiteStationData::upsert(Tracer<>& trc, int id_station,
+                               std::vector<batch::StationDatum>& vars,
+                               bool with_attrs, bool overwrite)
+{
+    const char* query     = overwrite ? upsert_replace_station_data_query
+                                      : upsert_keep_station_data_query;
+    SQLiteStatement*& stm = overwrite ? upsert_replace_stm : upsert_keep_stm;
+    if (!stm)
+        stm = conn.sqlitestatement(query).release();
+
+    std::sort(vars.begin(), vars.end());
+    stm->bind_val(1, id_station);
+    for (auto v = vars.begin(); v != vars.end(); ++v)
+    {
+        // Skip duplicates
+        auto next = v + 1;
+        if (next != vars.end() && *v == *next)
+            continue;
+        stm->bind_val(2, v->var->code());
+        stm->bind_val(3, v->var->enqc());
+        core::value::Encoder enc;
+        if (with_attrs && v->var->next_attr())
+        {
+            enc.append_attributes(*v->var);
+            stm->bind_val(4, enc.buf);
+        }
+        else
+            stm->bind_null_val(4);
+        Tracer<> trc_ins(trc ? trc->trace_insert(query, 1) : nullptr);
+        // No row is returned if an existing value was kept
+        stm->execute([&]() { v->id = stm->column_int(0); });
+    }
+}
+
 void SQLiteStationData::run_station_data_query(
     Tracer<>& trc, const v7::DataQueryBuilder& qb,
     std::function<void(const dballe::DBStation& station, int id_data,
-                       std::unique_ptr<wreport::Var> var)>
+                       wreport::Var&& var, std::vector<uint8_t>&& attrs)>
         dest)
 {
     Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
@@ -265,12 +346,13 @@ void SQLiteStationData::run_station_data_query(
             trc_sel->add_row();
         wreport::Varcode code = stm->column_int(5);
         const char* value     = stm->column_string(7);
-        auto var              = newvar(code, value);
+        auto var              = dballe::var(code, value);
+        std::vector<uint8_t> attrs;
         if (qb.select_attrs)
-            core::value::Decoder::decode_attrs(stm->column_blob(8), *var);
+            attrs = stm->column_blob(8);
 
         // Postprocessing filter of attr_filter
-        if (qb.attr_filter && !qb.match_attrs(*var))
+        if (qb.attr_filter && !qb.match_attrs(attrs))
             return;
 
         int id_station = stm->column_int(0);
@@ -288,7 +370,7 @@ void SQLiteStationData::run_station_data_query(
 
         int id_data = stm->column_int(6);
 
-        dest(station, id_data, move(var));
+        dest(station, id_data, move(var), move(attrs));
     });
 }
 
@@ -313,6 +395,15 @@ static const char* select_data_query =
 static const char* insert_data_query =
     "INSERT INTO data (id_station, id_levtr, datetime, code, value, attrs) "
     "VALUES (?, ?, ?, ?, ?, ?)";
+static const char* upsert_replace_data_query =
+    "INSERT INTO data (id_station, id_levtr, datetime, code, value, attrs) "
+    "VALUES (?, ?, ?, ?, ?, ?) ON CONFLICT (id_station, datetime, id_levtr, "
+    "code) DO UPDATE SET value=excluded.value, attrs=excluded.attrs "
+    "RETURNING id";
+static const char* upsert_keep_data_query =
+    "INSERT INTO data (id_station, id_levtr, datetime, code, value, attrs) "
+    "VALUES (?, ?, ?, ?, ?, ?) ON CONFLICT (id_station, datetime, id_levtr, "
+    "code) DO NOTHING RETURNING id";
 
 SQLiteData::SQLiteData(v7::Transaction& tr, SQLiteConnection& conn)
     : SQLiteDataCommon(tr, conn)
@@ -338,6 +429,21 @@ void SQLiteData::query(
     });
 }
 
+Datetime SQLiteData::last_datetime(Tracer<>& trc, int id_station)
+{
+    const char* query = "SELECT MAX(datetime) FROM data WHERE id_station=?";
+    Tracer<> trc_sel(trc ? trc->trace_select(query) : nullptr);
+    auto stm = conn.sqlitestatement(query);
+    stm->bind_val(1, id_station);
+    Datetime res;
+    stm->execute_one([&]() {
+        if (trc_sel)
+            trc_sel->add_row();
+        res = stm->column_datetime(0);
+    });
+    return res;
+}
+
 void SQLiteData::insert(Tracer<>& trc, int id_station, const Datetime& datetime,
                         std::vector<batch::MeasuredDatum>& vars,
                         bool with_attrs)
@@ -370,11 +476,47 @@ void SQLiteData::insert(Tracer<>& trc, int id_station, const Datetime& datetime,
     }
 }
 
+void SQLiteData::upsert(Tracer<>& trc, int id_station, const Datetime& datetime,
+                        std::vector<batch::MeasuredDatum>& vars,
+                        bool with_attrs, bool overwrite)
+{
+    const char* query     = overwrite ? upsert_replace_data_query
+                                      : upsert_keep_data_query;
+    SQLiteStatement*& stm = overwrite ? upsert_replace_stm : upsert_keep_stm;
+    if (!stm)
+        stm = conn.sqlitestatement(query).release();
+
+    std::sort(vars.begin(), vars.end());
+    stm->bind_val(1, id_station);
+    stm->bind_val(3, datetime);
+    for (auto v = vars.begin(); v != vars.end(); ++v)
+    {
+        // Skip duplicates
+        auto next = v + 1;
+        if (next != vars.end() && *v == *next)
+            continue;
+        Tracer<> trc_ins(trc ? trc->trace_insert(query, 1) : nullptr);
+        stm->bind_val(2, v->id_levtr);
+        stm->bind_val(4, v->var->code());
+        stm->bind_val(5, v->var->enqc());
+        core::value::Encoder enc;
+        if (with_attrs && v->var->next_attr())
+        {
+            enc.append_attributes(*v->var);
+            stm->bind_val(6, enc.buf);
+        }
+        else
+            stm->bind_null_val(6);
+        // No row is returned if an existing value was kept
+        stm->execute([&]() { v->id = stm->column_int(0); });
+    }
+}
+
 void SQLiteData::run_data_query(
     Tracer<>& trc, const v7::DataQueryBuilder& qb,
     std::function<void(const dballe::DBStation& station, int id_levtr,
                        const Datetime& datetime, int id_data,
-                       std::unique_ptr<wreport::Var> var)>
+                       wreport::Var&& var, std::vector<uint8_t>&& attrs)>
         dest)
 {
     Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
@@ -389,12 +531,13 @@ void SQLiteData::run_data_query(
             trc_sel->add_row();
         wreport::Varcode code = stm->column_int(6);
         const char* value     = stm->column_string(9);
-        auto var              = newvar(code, value);
+        auto var              = dballe::var(code, value);
+        std::vector<uint8_t> attrs;
         if (qb.select_attrs)
-            core::value::Decoder::decode_attrs(stm->column_blob(10), *var);
+            attrs = stm->column_blob(10);
 
         // Postprocessing filter of attr_filter
-        if (qb.attr_filter && !qb.match_attrs(*var))
+        if (qb.attr_filter && !qb.match_attrs(attrs))
             return;
 
         int id_station = stm->column_int(0);
@@ -414,7 +557,7 @@ void SQLiteData::run_data_query(
         int id_data       = stm->column_int(7);
         Datetime datetime = stm->column_datetime(8);
 
-        dest(station, id_levtr, datetime, id_data, move(var));
+        dest(station, id_levtr, datetime, id_data, move(var), move(attrs));
     });
 }
 
@@ -19,17 +19,21 @@ protected:
     dballe::sql::SQLiteConnection& conn;
 
     /// Precompiled read attributes statement
-    dballe::sql::SQLiteStatement* read_attrs_stm   = nullptr;
+    dballe::sql::SQLiteStatement* read_attrs_stm     = nullptr;
     /// Precompiled write attributes statement
-    dballe::sql::SQLiteStatement* write_attrs_stm  = nullptr;
+    dballe::sql::SQLiteStatement* write_attrs_stm    = nullptr;
     /// Precompiled remove attributes statement
-    dballe::sql::SQLiteStatement* remove_attrs_stm = nullptr;
+    dballe::sql::SQLiteStatement* remove_attrs_stm   = nullptr;
     /// Precompiled select statement
-    dballe::sql::SQLiteStatement* sstm             = nullptr;
+    dballe::sql::SQLiteStatement* sstm               = nullptr;
     /// Precompiled insert statement
-    dballe::sql::SQLiteStatement* istm             = nullptr;
+    dballe::sql::SQLiteStatement* istm               = nullptr;
     /// Precompiled update statement
-    dballe::sql::SQLiteStatement* ustm             = nullptr;
+    dballe::sql::SQLiteStatement* ustm               = nullptr;
+    /// Precompiled insert statement replacing existing values
+    dballe::sql::SQLiteStatement* upsert_replace_stm = nullptr;
+    /// Precompiled insert statement keeping existing values
+    dballe::sql::SQLiteStatement* upsert_keep_stm    = nullptr;
 
 public:
     SQLiteDataCommon(v7::Transaction& tr, dballe::sql::SQLiteConnection& conn);
@@ -40,9 +44,14 @@ public:
 
     void update(Tracer<>& trc, std::vector<typename Parent::BatchValue>& vars,
                 bool with_attrs) override;
+    bool has_upsert() const override;
     void read_attrs(
         Tracer<>& trc, int id_data,
         std::function<void(std::unique_ptr<wreport::Var>)> dest) override;
+    void run_attrs_query(Tracer<>& trc, const std::string& query,
+                         std::function<void(int id_data,
+                                            std::vector<uint8_t> attrs)>
+                             dest) override;
     void write_attrs(Tracer<>& trc, int id_data, const Values& values) override;
     void remove_all_attrs(Tracer<>& trc, int id_data) override;
     void remove(Tracer<>& trc, const v7::IdQueryBuilder& qb) override;
@@ -68,10 +77,14 @@ public:
     void insert(Tracer<>& trc, int id_station,
                 std::vector<batch::StationDatum>& vars,
                 bool with_attrs) override;
+    void upsert(Tracer<>& trc, int id_station,
+                std::vector<batch::StationDatum>& vars, bool with_attrs,
+                bool overwrite) override;
     void run_station_data_query(
         Tracer<>& trc, const v7::DataQueryBuilder& qb,
         std::function<void(const dballe::DBStation& station, int id_data,
-                           std::unique_ptr<wreport::Var> var)>) override;
+                           wreport::Var&& var,
+                           std::vector<uint8_t>&& attrs)>) override;
     void dump(FILE* out) override;
     void clear_cache() override {}
 };
@@ -89,14 +102,19 @@ public:
     void query(Tracer<>& trc, int id_station, const Datetime& datetime,
                std::function<void(int id, int id_levtr, wreport::Varcode code)>
                    dest) override;
+    Datetime last_datetime(Tracer<>& trc, int id_station) override;
     void insert(Tracer<>& trc, int id_station, const Datetime& datetime,
                 std::vector<batch::MeasuredDatum>& vars,
                 bool with_attrs) override;
+    void upsert(Tracer<>& trc, int id_station, const Datetime& datetime,
+                std::vector<batch::MeasuredDatum>& vars, bool with_attrs,
+                bool overwrite) override;
     void run_data_query(
         Tracer<>& trc, const v7::DataQueryBuilder& qb,
         std::function<void(const dballe::DBStation& station, int id_levtr,
                            const Datetime& datetime, int id_data,
-                           std::unique_ptr<wreport::Var> var)>) override;
+                           wreport::Var&& var,
+                           std::vector<uint8_t>&& attrs)>) override;
     void run_summary_query(
         Tracer<>& trc, const v7::SummaryQueryBuilder& qb,
         std::function<void(const dballe::DBStation& station, int id_levtr,
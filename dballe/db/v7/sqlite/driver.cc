@@ -152,6 +152,13 @@ void Driver::vacuum_v7()
     )");
 }
 
+void Driver::checkpoint()
+{
+    // If readers are still using the log, it is reused instead of truncated,
+    // and the next checkpoint will try again
+    conn.wal_checkpoint();
+}
+
 } // namespace sqlite
 } // namespace v7
 } // namespace db
@@ -25,6 +25,7 @@ struct Driver : public v7::Driver
     void create_tables_v7() override;
     void delete_tables_v7() override;
     void vacuum_v7() override;
+    void checkpoint() override;
 };
 
 } // namespace sqlite
@@ -63,7 +63,7 @@ SQLiteLevTr::~SQLiteLevTr()
     delete istm;
 }
 
-void SQLiteLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
+void SQLiteLevTr::_prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
 {
     if (ids.empty())
         return;
@@ -95,12 +95,9 @@ void SQLiteLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
     });
 }
 
-const LevTrEntry* SQLiteLevTr::lookup_id(Tracer<>& trc, int id)
+const LevTrEntry* SQLiteLevTr::_lookup_id(Tracer<>& trc, int id)
 {
-    // First look it up in the transaction cache
-    const LevTrEntry* res = cache.find_entry(id);
-    if (res)
-        return res;
+    const LevTrEntry* res = nullptr;
 
     Tracer<> trc_sel(trc ? trc->trace_select(select_data_query) : nullptr);
     sdstm->bind(id);
@@ -126,11 +123,9 @@ const LevTrEntry* SQLiteLevTr::lookup_id(Tracer<>& trc, int id)
     return res;
 }
 
-int SQLiteLevTr::obtain_id(Tracer<>& trc, const LevTrEntry& desc)
+int SQLiteLevTr::_obtain_id(Tracer<>& trc, const LevTrEntry& desc)
 {
-    int id = cache.find_id(desc);
-    if (id != MISSING_INT)
-        return id;
+    int id = MISSING_INT;
 
     Tracer<> trc_oid(trc ? trc->trace_select(select_query) : nullptr);
     sstm->bind(desc.level.ltype1, desc.level.l1, desc.level.ltype2,
@@ -35,6 +35,9 @@ protected:
 
     void
     _dump(std::function<void(int, const Level&, const Trange&)> out) override;
+    void _prefetch_ids(Tracer<>& trc, const std::set<int>& ids) override;
+    const LevTrEntry* _lookup_id(Tracer<>& trc, int id) override;
+    int _obtain_id(Tracer<>& trc, const LevTrEntry& desc) override;
 
 public:
     SQLiteLevTr(v7::Transaction& tr, dballe::sql::SQLiteConnection& conn);
@@ -42,10 +45,6 @@ public:
     SQLiteLevTr(const LevTr&&)                 = delete;
     SQLiteLevTr& operator=(const SQLiteLevTr&) = delete;
     ~SQLiteLevTr();
-
-    void prefetch_ids(Tracer<>& trc, const std::set<int>& id) override;
-    const LevTrEntry* lookup_id(Tracer<>& trc, int id) override;
-    int obtain_id(Tracer<>& trc, const LevTrEntry& desc) override;
 };
 
 } // namespace sqlite
@@ -196,35 +196,39 @@ QuietCollectTrace::~QuietCollectTrace()
         delete i;
 }
 
+trace::Step* QuietCollectTrace::add_step(trace::Step* step)
+{
+    std::lock_guard<std::mutex> lock(steps_mutex);
+    steps.push_back(step);
+    return step;
+}
+
 Tracer<> QuietCollectTrace::trace_connect(const std::string& url)
 {
-    steps.push_back(new trace::Step("connect", url));
-    return Tracer<>(steps.back());
+    return Tracer<>(add_step(new trace::Step("connect", url)));
 }
 
 Tracer<> QuietCollectTrace::trace_reset(const char* repinfo_file)
 {
-    steps.push_back(new trace::Step("reset", repinfo_file ? repinfo_file : ""));
-    return steps.back();
+    return Tracer<>(
+        add_step(new trace::Step("reset", repinfo_file ? repinfo_file : "")));
 }
 
 Tracer<trace::Transaction> QuietCollectTrace::trace_transaction()
 {
     trace::Transaction* res = new trace::Transaction;
-    steps.push_back(res);
+    add_step(res);
     return res;
 }
 
 Tracer<> QuietCollectTrace::trace_remove_all()
 {
-    steps.push_back(new trace::Step("remove_all"));
-    return Tracer<>(steps.back());
+    return Tracer<>(add_step(new trace::Step("remove_all")));
 }
 
 Tracer<> QuietCollectTrace::trace_vacuum()
 {
-    steps.push_back(new trace::Step("vacuum"));
-    return Tracer<>(steps.back());
+    return Tracer<>(add_step(new trace::Step("vacuum")));
 }
 
 CollectTrace::CollectTrace(const std::string& logdir)
@@ -247,8 +251,11 @@ void CollectTrace::save()
 
     writer.add("ops");
     writer.start_list();
-    for (const auto& s : steps)
-        s->to_json(writer);
+    {
+        std::lock_guard<std::mutex> lock(steps_mutex);
+        for (const auto& s : steps)
+            s->to_json(writer);
+    }
     writer.end_list();
 
     writer.end_mapping();
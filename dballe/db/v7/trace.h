@@ -4,6 +4,7 @@
 #include <dballe/core/json.h>
 #include <dballe/db/v7/fwd.h>
 #include <dballe/fwd.h>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -234,6 +235,11 @@ class QuietCollectTrace : public Trace
 {
 protected:
     std::vector<trace::Step*> steps;
+    /// Protect steps from concurrent transactions
+    std::mutex steps_mutex;
+
+    /// Thread-safe append to steps
+    trace::Step* add_step(trace::Step* step);
 
 public:
     QuietCollectTrace()                                    = default;
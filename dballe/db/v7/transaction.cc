@@ -7,11 +7,15 @@
 #include "dballe/sql/sql.h"
 #include "driver.h"
 #include "levtr.h"
+#include "pool.h"
 #include "repinfo.h"
 #include "station.h"
 #include "trace.h"
 #include <cassert>
+#include <map>
 #include <memory>
+#include <set>
+#include <unordered_map>
 
 using namespace wreport;
 using namespace std;
@@ -20,17 +24,26 @@ namespace dballe {
 namespace db {
 namespace v7 {
 
+namespace {
+
+/// Checkpoint write-ahead logs after committing at least this many messages
+const size_t checkpoint_after_messages = 1000;
+
+} // namespace
+
 Transaction::Transaction(
     std::shared_ptr<v7::DB> db,
-    std::unique_ptr<dballe::sql::Transaction> sql_transaction)
-    : db(db), sql_transaction(std::move(sql_transaction)), batch(*this),
+    std::unique_ptr<dballe::sql::Transaction> sql_transaction,
+    std::shared_ptr<v7::PooledConnection> pooled)
+    : db(db), pooled(pooled), conn(pooled ? pooled->conn : db->conn),
+      sql_transaction(std::move(sql_transaction)), batch(*this),
       trc(db->trace->trace_transaction())
 {
-    m_repinfo      = db->driver().create_repinfo(*this).release();
-    m_station      = db->driver().create_station(*this).release();
-    m_levtr        = db->driver().create_levtr(*this).release();
-    m_station_data = db->driver().create_station_data(*this).release();
-    m_data         = db->driver().create_data(*this).release();
+    m_repinfo      = driver().create_repinfo(*this).release();
+    m_station      = driver().create_station(*this).release();
+    m_levtr        = driver().create_levtr(*this).release();
+    m_station_data = driver().create_station_data(*this).release();
+    m_data         = driver().create_data(*this).release();
 }
 
 Transaction::~Transaction()
@@ -43,6 +56,11 @@ Transaction::~Transaction()
     delete m_repinfo;
 }
 
+v7::Driver& Transaction::driver()
+{
+    return pooled ? *pooled->driver : db->driver();
+}
+
 v7::Repinfo& Transaction::repinfo() { return *m_repinfo; }
 
 v7::Station& Transaction::station() { return *m_station; }
@@ -57,10 +75,14 @@ void Transaction::commit()
 {
     if (fired)
         return;
+    write_deferred();
     sql_transaction->commit();
+    levtr().publish_cache();
     clear_cached_state();
     fired = true;
     trc.done();
+    if (imported_messages >= checkpoint_after_messages)
+        driver().checkpoint();
 }
 
 void Transaction::rollback()
@@ -99,6 +121,221 @@ void Transaction::clear_cached_state()
             cur->discard();
 }
 
+void Transaction::write_deferred()
+{
+    if (!batch.count_deferred())
+        return;
+    Tracer<> trc(this->trc ? this->trc->trace_func("write_deferred")
+                           : nullptr);
+    batch.write_pending(trc);
+}
+
+namespace {
+
+/**
+ * Set the data IDs of the values in data from those known in md.
+ *
+ * Returns false if some IDs were not found.
+ */
+bool read_data_ids(const batch::MeasuredData& md, int id_levtr,
+                   core::Data& data)
+{
+    bool found_all = true;
+    for (auto& v : data.values)
+    {
+        auto i = md.ids_on_db.find(IdVarcode(id_levtr, v.code()));
+        if (i == md.ids_on_db.end() || i->id == MISSING_INT)
+        {
+            found_all = false;
+            continue;
+        }
+        v.data_id = i->id;
+    }
+    return found_all;
+}
+
+} // namespace
+
+void Transaction::resolve_data_ids(dballe::Data& vals)
+{
+    core::Data& data = core::Data::downcast(vals);
+    write_deferred();
+
+    Tracer<> trc(this->trc ? this->trc->trace_func("resolve_data_ids")
+                           : nullptr);
+    batch::Station* st = batch.get_station(trc, data.station, false);
+    data.station.id    = st->id;
+
+    int id_levtr = levtr().obtain_id(trc, LevTrEntry(data.level, data.trange));
+
+    // Use the IDs known from writing the values, and query the database only
+    // if some are missing
+    batch::MeasuredData* md =
+        &st->get_measured_data(trc, data.datetime, batch::IGNORE);
+    if (read_data_ids(*md, id_levtr, data) || md->loaded)
+        return;
+    md = &st->get_measured_data(trc, data.datetime);
+    read_data_ids(*md, id_levtr, data);
+}
+
+namespace {
+
+/// Order stations by report, coordinates and identifier, ignoring the ID
+struct StationKeyLess
+{
+    bool operator()(const DBStation* a, const DBStation* b) const
+    {
+        if (int res = a->report.compare(b->report))
+            return res < 0;
+        if (int res = a->coords.compare(b->coords))
+            return res < 0;
+        return a->ident.compare(b->ident) < 0;
+    }
+};
+
+} // namespace
+
+std::vector<db::StationRecord> Transaction::dump_stations(const Query& query)
+{
+    std::vector<db::StationRecord> res;
+    std::unordered_map<int, size_t> by_id;
+
+    auto stations = query_stations(query);
+    while (stations->next())
+    {
+        res.emplace_back();
+        res.back().station = stations->get_station();
+        by_id.emplace(res.back().station.id, res.size() - 1);
+    }
+
+    auto cur = dynamic_pointer_cast<db::CursorStationData>(
+        query_station_data(query));
+    while (cur->next())
+    {
+        auto i = by_id.find(cur->get_station().id);
+        if (i == by_id.end())
+            continue;
+        res[i->second].values.set(
+            DBValue(cur->attr_reference_id(), cur->get_var()));
+    }
+
+    return res;
+}
+
+db::StationSyncStats
+Transaction::sync_stations(std::vector<db::StationRecord>& stations,
+                           bool remove_missing)
+{
+    db::StationSyncStats stats;
+
+    // Read what is currently in the database in a single pass
+    std::vector<db::StationRecord> current = dump_stations(core::Query());
+    std::map<const DBStation*, const db::StationRecord*, StationKeyLess> by_key;
+    for (const auto& rec : current)
+        by_key.emplace(&rec.station, &rec);
+    std::set<const DBStation*, StationKeyLess> seen;
+
+    Tracer<> trc(this->trc ? this->trc->trace_func("sync_stations") : nullptr);
+    batch.set_write_attrs(true);
+    // Changed values of all stations, updated together by their IDs
+    std::vector<batch::StationDatum> to_update;
+    std::vector<int> to_remove;
+    for (auto& rec : stations)
+    {
+        if (!seen.insert(&rec.station).second)
+            throw error_consistency(
+                "station listed more than once in the stations to synchronise");
+
+        auto found = by_key.find(&rec.station);
+        const db::StationRecord* in_db =
+            found == by_key.end() ? nullptr : found->second;
+        if (!in_db)
+            ++stats.stations_added;
+
+        // Values that are not in the database yet need the station ID, and
+        // are inserted one station at a time
+        bool has_new = !in_db;
+        for (auto& val : rec.values)
+        {
+            const DBValue* old =
+                in_db ? in_db->values.maybe_value(val.code()) : nullptr;
+            val.data_id = old ? old->data_id : MISSING_INT;
+            if (!val.get() || !val->isset())
+                continue;
+            if (!old)
+            {
+                has_new = true;
+                ++stats.values_added;
+            }
+            else if (old->get() && old->get()->value_equals(*val))
+                ++stats.values_unchanged;
+            else
+            {
+                to_update.emplace_back(old->data_id, val.get());
+                ++stats.values_updated;
+            }
+        }
+
+        if (remove_missing && in_db)
+        {
+            for (const auto& val : in_db->values)
+            {
+                if (rec.values.maybe_value(val.code()))
+                    continue;
+                to_remove.push_back(val.data_id);
+                ++stats.values_removed;
+            }
+        }
+
+        if (!has_new)
+        {
+            rec.station.id = in_db->station.id;
+            continue;
+        }
+
+        DBStation station      = rec.station;
+        station.id             = in_db ? in_db->station.id : MISSING_INT;
+        batch::Station* st     = batch.get_known_station(trc, station);
+        batch::StationData& sd = st->station_data;
+        if (in_db)
+        {
+            for (const auto& val : in_db->values)
+                sd.ids_by_code.add(IdVarcode(val.data_id, val.code()));
+        }
+        for (auto& val : rec.values)
+            if (val.get() && val->isset() && val.data_id == MISSING_INT)
+                sd.add(val.get(), batch::UPDATE);
+
+        batch.write_pending(trc);
+
+        // Read the IDs of the new values from the results
+        rec.station.id = st->id;
+        for (auto& val : rec.values)
+        {
+            if (val.data_id != MISSING_INT)
+                continue;
+            auto i = sd.ids_by_code.find(val.code());
+            if (i != sd.ids_by_code.end())
+                val.data_id = i->id;
+        }
+    }
+
+    if (!to_update.empty())
+    {
+        station_data().update(trc, to_update, true);
+        ++data_changes;
+    }
+    for (int id : to_remove)
+        station_data().remove_by_id(trc, id);
+    if (!to_remove.empty())
+        ++data_changes;
+
+    // The batch still has the IDs of the last station, which may include
+    // removed values
+    batch.clear();
+    return stats;
+}
+
 Transaction& Transaction::downcast(dballe::db::Transaction& transaction)
 {
     v7::Transaction* t = dynamic_cast<v7::Transaction*>(&transaction);
@@ -109,7 +346,9 @@ Transaction& Transaction::downcast(dballe::db::Transaction& transaction)
 void Transaction::remove_all()
 {
     auto trc = db->trace->trace_remove_all();
-    db->driver().remove_all_v7(); // TODO: pass trace step
+    driver().remove_all_v7(); // TODO: pass trace step
+    ++data_changes;
+    levtr().invalidate_shared_cache();
     clear_cached_state();
 }
 
@@ -122,9 +361,11 @@ void Transaction::insert_station_data(dballe::Data& vals,
         batch.get_station(trc, data.station, opts.can_add_stations);
 
     // Add all the variables we find
-    batch::StationData& sd = st->get_station_data(trc);
+    batch::UpdateMode on_conflict =
+        opts.can_replace ? batch::UPDATE : batch::ERROR;
+    batch::StationData& sd = st->get_station_data(trc, on_conflict);
     for (auto& i : data.values)
-        sd.add(i.get(), opts.can_replace ? batch::UPDATE : batch::ERROR);
+        sd.add(i.get(), on_conflict);
 
     // Perform changes
     batch.write_pending(trc);
@@ -151,7 +392,10 @@ void Transaction::insert_data(dballe::Data& vals,
     batch::Station* st =
         batch.get_station(trc, data.station, opts.can_add_stations);
 
-    batch::MeasuredData& md = st->get_measured_data(trc, data.datetime);
+    batch::UpdateMode on_conflict =
+        opts.can_replace ? batch::UPDATE : batch::ERROR;
+    batch::MeasuredData& md =
+        st->get_measured_data(trc, data.datetime, on_conflict);
 
     if (data.level.is_missing())
         throw std::runtime_error(
@@ -165,54 +409,64 @@ void Transaction::insert_data(dballe::Data& vals,
 
     // Add all the variables we find
     for (auto& i : data.values)
-        md.add(id_levtr, i.get(),
-               opts.can_replace ? batch::UPDATE : batch::ERROR);
+        md.add(id_levtr, opts.defer ? batch.defer(*i) : i.get(), on_conflict);
+
+    if (opts.defer && batch.count_deferred() < batch.max_deferred)
+    {
+        // Leave the values queued: their IDs are not known yet
+        data.station.id = st->id;
+        for (auto& v : data.values)
+            v.data_id = MISSING_INT;
+        return;
+    }
 
     // Perform changes
     batch.write_pending(trc);
 
     // Read the IDs from the results
     data.station.id = st->id;
-    for (auto& v : data.values)
-    {
-        auto i = md.ids_on_db.find(IdVarcode(id_levtr, v.code()));
-        if (i == md.ids_on_db.end())
-            continue;
-        v.data_id = i->id;
-    }
+    read_data_ids(md, id_levtr, data);
 }
 
 void Transaction::remove_station_data(const Query& query)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_remove_station_data(query)
                            : nullptr);
     cursor::run_delete_query(
         trc, dynamic_pointer_cast<v7::Transaction>(shared_from_this()),
         core::Query::downcast(query), true, db->explain_queries);
+    ++data_changes;
     batch.clear();
 }
 
 void Transaction::remove_data(const Query& query)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_remove_data(query) : nullptr);
     cursor::run_delete_query(
         trc, dynamic_pointer_cast<v7::Transaction>(shared_from_this()),
         core::Query::downcast(query), false, db->explain_queries);
+    ++data_changes;
     batch.clear();
 }
 
 void Transaction::remove_station_data_by_id(int id)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_remove_station_data_by_id(id)
                            : nullptr);
     station_data().remove_by_id(trc, id);
+    ++data_changes;
     batch.clear();
 }
 
 void Transaction::remove_data_by_id(int id)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_remove_data_by_id(id) : nullptr);
     data().remove_by_id(trc, id);
+    ++data_changes;
     batch.clear();
 }
 
@@ -224,6 +478,7 @@ void Transaction::track_cursor(std::weak_ptr<dballe::Cursor> cursor)
 std::shared_ptr<dballe::CursorStation>
 Transaction::query_stations(const Query& query)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_query_stations(query) : nullptr);
     auto res = cursor::run_station_query(
         trc, dynamic_pointer_cast<v7::Transaction>(shared_from_this()),
@@ -235,6 +490,7 @@ Transaction::query_stations(const Query& query)
 std::shared_ptr<dballe::CursorStationData>
 Transaction::query_station_data(const Query& query)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_query_station_data(query)
                            : nullptr);
     auto res = cursor::run_station_data_query(
@@ -246,6 +502,7 @@ Transaction::query_station_data(const Query& query)
 
 std::shared_ptr<dballe::CursorData> Transaction::query_data(const Query& query)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_query_data(query) : nullptr);
     auto res = cursor::run_data_query(
         trc, dynamic_pointer_cast<v7::Transaction>(shared_from_this()),
@@ -257,6 +514,7 @@ std::shared_ptr<dballe::CursorData> Transaction::query_data(const Query& query)
 std::shared_ptr<dballe::CursorSummary>
 Transaction::query_summary(const Query& query)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_query_summary(query) : nullptr);
     auto res = cursor::run_summary_query(
         trc, dynamic_pointer_cast<v7::Transaction>(shared_from_this()),
@@ -268,6 +526,7 @@ Transaction::query_summary(const Query& query)
 void Transaction::attr_query_station(
     int data_id, std::function<void(std::unique_ptr<wreport::Var>)> dest)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_func("attr_query_station")
                            : nullptr);
     // Create the query
@@ -278,6 +537,7 @@ void Transaction::attr_query_station(
 void Transaction::attr_query_data(
     int data_id, std::function<void(std::unique_ptr<wreport::Var>)> dest)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_func("attr_query_data")
                            : nullptr);
     // Create the query
@@ -287,24 +547,30 @@ void Transaction::attr_query_data(
 
 void Transaction::attr_insert_station(int data_id, const Values& attrs)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_func("attr_insert_station")
                            : nullptr);
     auto& d = station_data();
     d.merge_attrs(trc, data_id, attrs);
+    ++data_changes;
 }
 
 void Transaction::attr_insert_data(int data_id, const Values& attrs)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_func("attr_insert_data")
                            : nullptr);
     auto& d = data();
     d.merge_attrs(trc, data_id, attrs);
+    ++data_changes;
 }
 
 void Transaction::attr_remove_station(int data_id, const db::AttrList& attrs)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_func("attr_remove_station")
                            : nullptr);
+    ++data_changes;
     if (attrs.empty())
     {
         // Delete all attributes
@@ -312,7 +578,7 @@ void Transaction::attr_remove_station(int data_id, const db::AttrList& attrs)
         snprintf(buf, 64, "UPDATE station_data SET attrs=NULL WHERE id=%d",
                  data_id);
         Tracer<> trc_upd(trc ? trc->trace_update(buf, 1) : nullptr);
-        db->conn->execute(buf);
+        conn->execute(buf);
     }
     else
     {
@@ -323,15 +589,17 @@ void Transaction::attr_remove_station(int data_id, const db::AttrList& attrs)
 
 void Transaction::attr_remove_data(int data_id, const db::AttrList& attrs)
 {
+    write_deferred();
     Tracer<> trc(this->trc ? this->trc->trace_func("attr_remove_data")
                            : nullptr);
+    ++data_changes;
     if (attrs.empty())
     {
         // Delete all attributes
         char buf[64];
         snprintf(buf, 64, "UPDATE data SET attrs=NULL WHERE id=%d", data_id);
         Tracer<> trc_upd(trc ? trc->trace_update(buf, 1) : nullptr);
-        db->conn->execute(buf);
+        conn->execute(buf);
     }
     else
     {
@@ -348,6 +616,7 @@ void Transaction::update_repinfo(const char* repinfo_file, int* added,
 
 void Transaction::dump(FILE* out)
 {
+    write_deferred();
     repinfo().dump(out);
     station().dump(out);
     levtr().dump(out);
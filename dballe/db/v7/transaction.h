@@ -33,10 +33,18 @@ protected:
                           const dballe::DBImportOptions& opts);
     void track_cursor(std::weak_ptr<dballe::Cursor> cursor);
 
+    /// Check if a data value is imported with the given options
+    static bool imports_value(const wreport::Var& var,
+                              const dballe::DBImportOptions& opts);
+
 public:
     typedef v7::DB DB;
 
     std::shared_ptr<v7::DB> db;
+    /// Connection from the read-only pool used by this transaction, if any
+    std::shared_ptr<v7::PooledConnection> pooled;
+    /// Database connection used by this transaction
+    std::shared_ptr<dballe::sql::Connection> conn;
     /// SQL-side transaction
     std::shared_ptr<dballe::sql::Transaction> sql_transaction;
     /// True if commit or rollback have already been called on this transaction
@@ -45,15 +53,29 @@ public:
     v7::Batch batch;
     /// Tracing system
     v7::Tracer<v7::trace::Transaction> trc;
+    /**
+     * Counter incremented at each change of values or attributes, used by
+     * cursors to find out when the attributes they read in advance may be
+     * outdated
+     */
+    unsigned data_changes = 0;
+    /**
+     * Number of messages imported by this transaction, used to checkpoint
+     * write-ahead logs after committing large imports
+     */
+    size_t imported_messages = 0;
 
     Transaction(std::shared_ptr<v7::DB> db,
-                std::unique_ptr<dballe::sql::Transaction> sql_transaction);
+                std::unique_ptr<dballe::sql::Transaction> sql_transaction,
+                std::shared_ptr<v7::PooledConnection> pooled = nullptr);
     Transaction(const Transaction&)            = delete;
     Transaction(Transaction&&)                 = delete;
     Transaction& operator=(const Transaction&) = delete;
     Transaction& operator=(Transaction&&)      = delete;
     ~Transaction();
 
+    /// Access the backend DB driver for the connection of this transaction
+    v7::Driver& driver();
     /// Access the repinfo table
     v7::Repinfo& repinfo();
     /// Access the station table
@@ -68,7 +90,18 @@ public:
     void commit() override;
     void rollback() override;
     void rollback_nothrow() noexcept override;
+
+    /**
+     * Write values queued by deferred inserts, before an operation that needs
+     * to see them in the database
+     */
+    void write_deferred();
+
     void clear_cached_state() override;
+    void resolve_data_ids(dballe::Data& vals) override;
+    std::vector<db::StationRecord> dump_stations(const Query& query) override;
+    db::StationSyncStats sync_stations(std::vector<db::StationRecord>& stations,
+                                       bool remove_missing = false) override;
 
     std::shared_ptr<dballe::CursorStation>
     query_stations(const Query& query) override;
@@ -109,6 +142,15 @@ public:
     void update_repinfo(const char* repinfo_file, int* added, int* deleted,
                         int* updated) override;
 
+    /**
+     * Check a message for the problems that would make its import fail,
+     * throwing the same exceptions as importing it.
+     *
+     * Returns the number of data values that would be imported.
+     */
+    static unsigned check_importable(const Message& message,
+                                     const dballe::DBImportOptions& opts);
+
     static Transaction& downcast(dballe::db::Transaction& transaction);
 
     void dump(FILE* out) override;
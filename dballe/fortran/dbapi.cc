@@ -9,6 +9,7 @@
 #include "dballe/message.h"
 #include "dballe/msg/msg.h"
 #include "dballe/values.h"
+#include <cstdlib>
 #include <cstring>
 
 using namespace wreport;
@@ -266,16 +267,19 @@ struct PrendiloOperation : public Operation
 {
     /// Store database variable IDs for all last inserted variables
     DbAPI& api;
-    std::vector<VarID> last_inserted_varids;
-    wreport::Varcode varcode     = 0;
-    int last_inserted_station_id = API::missing_int;
-    int last_inserted_data_id    = API::missing_int;
+    mutable std::vector<VarID> last_inserted_varids;
+    wreport::Varcode varcode             = 0;
+    mutable int last_inserted_station_id = API::missing_int;
+    mutable int last_inserted_data_id    = API::missing_int;
+    /// Copy of the data last inserted, while its IDs are still unknown
+    mutable std::unique_ptr<core::Data> unresolved;
     impl::DBInsertOptions opts;
 
     PrendiloOperation(DbAPI& api) : api(api)
     {
         opts.can_replace      = (api.perms & DbAPI::PERM_DATA_WRITE) != 0;
         opts.can_add_stations = (api.perms & DbAPI::PERM_ANA_WRITE) != 0;
+        opts.defer            = api.defer_inserts;
     }
 
     void set_varcode(wreport::Varcode varcode) override
@@ -283,30 +287,48 @@ struct PrendiloOperation : public Operation
         this->varcode = varcode;
     }
 
+    void read_ids(const core::Data& data, bool station) const
+    {
+        last_inserted_varids.clear();
+        for (const auto& v : data.values)
+            last_inserted_varids.push_back(VarID(v.code(), station, v.data_id));
+        last_inserted_station_id = data.station.id;
+        if (data.values.size() == 1)
+            last_inserted_data_id = data.values.begin()->data_id;
+        else
+            last_inserted_data_id = API::missing_int;
+    }
+
+    /// Look up the IDs of values whose insert was deferred
+    void resolve_ids() const
+    {
+        if (!unresolved)
+            return;
+        api.tr->resolve_data_ids(*unresolved);
+        read_ids(*unresolved, false);
+        unresolved.reset();
+    }
+
     void run()
     {
         // db::Transaction& tr, dballe::core::Data& input, bool station_context,
         // unsigned perms)
-        last_inserted_varids.clear();
         if (api.station_context)
         {
             api.tr->insert_station_data(api.input_data, opts);
-            for (const auto& v : api.input_data.values)
-                last_inserted_varids.push_back(
-                    VarID(v.code(), true, v.data_id));
+            read_ids(api.input_data, true);
         }
         else
         {
             api.tr->insert_data(api.input_data, opts);
-            for (const auto& v : api.input_data.values)
-                last_inserted_varids.push_back(
-                    VarID(v.code(), false, v.data_id));
+            // If the values have been queued, keep what is needed to find out
+            // their IDs if they are requested later
+            if (opts.defer &&
+                api.input_data.values.begin()->data_id == API::missing_int)
+                unresolved.reset(new core::Data(api.input_data));
+            else
+                read_ids(api.input_data, false);
         }
-        last_inserted_station_id = api.input_data.station.id;
-        if (api.input_data.values.size() == 1)
-            last_inserted_data_id = api.input_data.values.begin()->data_id;
-        else
-            last_inserted_data_id = API::missing_int;
     }
     void query_attributes(Attributes& dest) override
     {
@@ -315,6 +337,7 @@ struct PrendiloOperation : public Operation
     }
     void insert_attributes(Values& qcinput) override
     {
+        resolve_ids();
         int data_id     = MISSING_INT;
         bool is_station = false;
         // Lookup the variable we act on from the results of last insert_data
@@ -357,10 +380,12 @@ struct PrendiloOperation : public Operation
     {
         if (strcmp(param, "ana_id") == 0)
         {
+            resolve_ids();
             return last_inserted_station_id;
         }
         else if (strcmp(param, "context_id") == 0)
         {
+            resolve_ids();
             return last_inserted_data_id;
         }
         else
@@ -488,7 +513,8 @@ DbAPI::DbAPI(std::shared_ptr<db::Transaction> tr, const char* anaflag,
 
 DbAPI::DbAPI(std::shared_ptr<db::Transaction> tr, unsigned perms) : tr(tr)
 {
-    this->perms = perms;
+    this->perms   = perms;
+    defer_inserts = getenv("DBA_FORTRAN_DEFER_INSERTS") != nullptr;
 }
 
 DbAPI::~DbAPI() { shutdown(false); }
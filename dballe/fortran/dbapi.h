@@ -26,6 +26,11 @@ public:
     std::shared_ptr<db::Transaction> tr;
     InputFile* input_file   = nullptr;
     OutputFile* output_file = nullptr;
+    /**
+     * Queue inserted data to write it in batches, looking up the IDs of
+     * inserted values only when they are requested
+     */
+    bool defer_inserts      = false;
 
     DbAPI(std::shared_ptr<db::Transaction> tr, const char* anaflag,
           const char* dataflag, const char* attrflag);
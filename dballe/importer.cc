@@ -2,6 +2,7 @@
 #include "dballe/msg/json_codec.h"
 #include "dballe/msg/wr_codec.h"
 #include "file.h"
+#include <algorithm>
 #include <wreport/bulletin.h>
 #include <wreport/error.h>
 
@@ -19,14 +20,21 @@ ImporterOptions::ImporterOptions(const std::string& s)
 {
 }
 
+bool ImporterOptions::wants(wreport::Varcode code) const
+{
+    if (varlist.empty())
+        return true;
+    return std::find(varlist.begin(), varlist.end(), code) != varlist.end();
+}
+
 bool ImporterOptions::operator==(const ImporterOptions& o) const
 {
-    return simplified == o.simplified;
+    return simplified == o.simplified && varlist == o.varlist;
 }
 
 bool ImporterOptions::operator!=(const ImporterOptions& o) const
 {
-    return simplified != o.simplified;
+    return simplified != o.simplified || varlist != o.varlist;
 }
 
 void ImporterOptions::print(FILE* out)
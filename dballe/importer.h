@@ -7,6 +7,7 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include <wreport/varinfo.h>
 
 namespace wreport {
 struct Bulletin;
@@ -33,6 +34,26 @@ public:
         TAG   = 3,
     } domain_errors = DomainErrors::THROW;
 
+    /**
+     * If not empty, only interpret data values with these varcodes when
+     * decoding BUFR and CREX messages.
+     *
+     * Station information is always imported, and the variables that define
+     * the level or time range of other values are still interpreted.
+     */
+    std::vector<wreport::Varcode> varlist;
+
+    /// Check if values with the given varcode are to be imported
+    bool wants(wreport::Varcode code) const;
+
+    /**
+     * Number of threads used to interpret the subsets of a BUFR or CREX
+     * bulletin.
+     *
+     * Messages are still returned in the order of their subsets.
+     */
+    unsigned jobs = 1;
+
     bool operator==(const ImporterOptions&) const;
     bool operator!=(const ImporterOptions&) const;
 
@@ -434,6 +434,55 @@ void Tests::register_tests()
                 matcher::MATCH_YES);
     });
 
+    add_method("msg_match_combined", []() {
+        // Test a matcher with several constraints at the same time
+        auto m = get_matcher("block=11, yearmin=2000, rep_memo=SYNOP");
+
+        impl::Message matched;
+        wassert(actual_matcher_result(m->match(MatchedMsg(matched))) ==
+                matcher::MATCH_NO);
+
+        matched.set_block(11);
+        matched.set_datetime(Datetime(2001));
+        wassert(actual_matcher_result(m->match(MatchedMsg(matched))) ==
+                matcher::MATCH_NO);
+
+        matched.set_rep_memo("synop");
+        wassert(actual_matcher_result(m->match(MatchedMsg(matched))) ==
+                matcher::MATCH_YES);
+
+        matched.set_datetime(Datetime(1999));
+        wassert(actual_matcher_result(m->match(MatchedMsg(matched))) ==
+                matcher::MATCH_NO);
+
+        // The matcher converts back to the query it was created from
+        core::Query q;
+        m->to_query(q);
+        wassert(actual(q.block) == 11);
+        wassert(actual(q.station) == MISSING_INT);
+        wassert(actual(q.dtrange.min.year) == 2000);
+        wassert(actual(q.report) == "synop");
+    });
+
+    add_method("msg_match_coords_wrap", []() {
+        // Test a longitude range across the antimeridian
+        auto m = get_matcher("lonmin=170.0, lonmax=-170.0");
+
+        impl::Message matched;
+        matched.set_latitude(45.0);
+        matched.set_longitude(175.0);
+        wassert(actual_matcher_result(m->match(MatchedMsg(matched))) ==
+                matcher::MATCH_YES);
+
+        matched.set_longitude(-175.0);
+        wassert(actual_matcher_result(m->match(MatchedMsg(matched))) ==
+                matcher::MATCH_YES);
+
+        matched.set_longitude(0.0);
+        wassert(actual_matcher_result(m->match(MatchedMsg(matched))) ==
+                matcher::MATCH_NO);
+    });
+
     add_method("msg_match_empty", []() {
         // Test empty matcher
         std::unique_ptr<Matcher> m = Matcher::create(core::Query());
@@ -731,6 +780,23 @@ void Tests::register_tests()
                 matcher::MATCH_YES);
     });
 
+    add_method("msgs_match_combined", []() {
+        // Each constraint can be matched by a different message
+        auto m = get_matcher("block=11, yearmin=2000");
+
+        impl::Messages matched;
+        init(matched);
+        init(matched);
+        impl::Message::downcast(matched[0])->set_block(11);
+        impl::Message::downcast(matched[0])->set_datetime(Datetime(1999));
+        wassert(actual_matcher_result(m->match(MatchedMessages(matched))) ==
+                matcher::MATCH_NO);
+
+        impl::Message::downcast(matched[1])->set_datetime(Datetime(2001));
+        wassert(actual_matcher_result(m->match(MatchedMessages(matched))) ==
+                matcher::MATCH_YES);
+    });
+
     add_method("msgs_match_empty", []() {
         // Test empty matcher
         std::unique_ptr<Matcher> m = Matcher::create(core::Query());
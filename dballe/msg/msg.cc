@@ -896,37 +896,37 @@ void Message::set_impl(const Level& lev, const Trange& tr,
 void Message::seti(const Level& lev, const Trange& tr, Varcode code, int val,
                    int conf)
 {
-    unique_ptr<Var> var(newvar(code, val));
+    auto var = dballe::var(code, val);
     if (conf != -1)
-        var->seta(newvar(WR_VAR(0, 33, 7), conf));
+        var.seta(newvar(WR_VAR(0, 33, 7), conf));
     if (lev.is_missing() && tr.is_missing())
         station_data.set(std::move(var));
     else
-        set(lev, tr, std::move(var));
+        obtain_context(lev, tr).values.set(std::move(var));
 }
 
 void Message::setd(const Level& lev, const Trange& tr, Varcode code, double val,
                    int conf)
 {
-    unique_ptr<Var> var(newvar(code, val));
+    auto var = dballe::var(code, val);
     if (conf != -1)
-        var->seta(newvar(WR_VAR(0, 33, 7), conf));
+        var.seta(newvar(WR_VAR(0, 33, 7), conf));
     if (lev.is_missing() && tr.is_missing())
         station_data.set(std::move(var));
     else
-        set(lev, tr, std::move(var));
+        obtain_context(lev, tr).values.set(std::move(var));
 }
 
 void Message::setc(const Level& lev, const Trange& tr, Varcode code,
                    const char* val, int conf)
 {
-    unique_ptr<Var> var(newvar(code, val));
+    auto var = dballe::var(code, val);
     if (conf != -1)
-        var->seta(newvar(WR_VAR(0, 33, 7), conf));
+        var.seta(newvar(WR_VAR(0, 33, 7), conf));
     if (lev.is_missing() && tr.is_missing())
         station_data.set(std::move(var));
     else
-        set(lev, tr, std::move(var));
+        obtain_context(lev, tr).values.set(std::move(var));
 }
 
 MessageType Message::type_from_repmemo(const char* repmemo)
@@ -1124,6 +1124,33 @@ matcher::Result MatchedMsg::match_rep_memo(const char* memo) const
         return matcher::MATCH_NA;
 }
 
+bool MatchedMsg::resolve(
+    unsigned fields, std::function<void(const matcher::Resolved&)> dest) const
+{
+    using matcher::Resolved;
+    Resolved res;
+    if (fields & Resolved::STATION_ID)
+        if (const Var* var = m.station_data.maybe_var(WR_VAR(0, 1, 192)))
+            res.station_id = var->enqi();
+    if (fields & Resolved::WMO)
+    {
+        if (const Var* var = m.station_data.maybe_var(WR_VAR(0, 1, 1)))
+            res.block = var->enqi();
+        if (const Var* var = m.station_data.maybe_var(WR_VAR(0, 1, 2)))
+            res.station = var->enqi();
+    }
+    if (fields & Resolved::COORDS)
+        res.coords = m.get_coords();
+    if (fields & Resolved::DATETIME)
+        res.datetime = m.get_datetime();
+    if (fields & Resolved::REPORT)
+        if (const Var* var = m.station_data.maybe_var(sc::rep_memo.code))
+            if (var->isset())
+                res.report = var->enqc();
+    dest(res);
+    return true;
+}
+
 MatchedMessages::MatchedMessages(const Messages& m) : m(m) {}
 MatchedMessages::~MatchedMessages() {}
 
@@ -1183,5 +1210,13 @@ matcher::Result MatchedMessages::match_rep_memo(const char* memo) const
     return matcher::MATCH_NA;
 }
 
+bool MatchedMessages::resolve(
+    unsigned fields, std::function<void(const matcher::Resolved&)> dest) const
+{
+    for (const auto& i : m)
+        MatchedMsg(*impl::Message::downcast(i)).resolve(fields, dest);
+    return true;
+}
+
 } // namespace impl
 } // namespace dballe
@@ -376,6 +376,9 @@ struct MatchedMsg : public Matched
     matcher::Result match_coords(const LatRange& latrange,
                                  const LonRange& lonrange) const override;
     matcher::Result match_rep_memo(const char* memo) const override;
+    bool resolve(unsigned fields,
+                 std::function<void(const matcher::Resolved&)> dest)
+        const override;
 };
 
 /**
@@ -396,6 +399,9 @@ struct MatchedMessages : public Matched
     matcher::Result match_coords(const LatRange& latrange,
                                  const LonRange& lonrange) const override;
     matcher::Result match_rep_memo(const char* memo) const override;
+    bool resolve(unsigned fields,
+                 std::function<void(const matcher::Resolved&)> dest)
+        const override;
 };
 
 } // namespace impl
@@ -2,12 +2,18 @@
 #include "context.h"
 #include "dballe/core/shortcuts.h"
 #include "dballe/file.h"
+#include "dballe/var.h"
 #include "domain_errors.h"
 #include "msg.h"
 #include "wr_importers/base.h"
 #include <wreport/bulletin.h>
 #include <wreport/options.h>
 #include <wreport/vartable.h>
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 using namespace wreport;
 using namespace std;
@@ -16,6 +22,221 @@ namespace dballe {
 namespace impl {
 namespace msg {
 
+namespace {
+
+/// Number of subsets each thread can interpret ahead of those sent to dest
+const size_t subsets_per_job = 64;
+
+/// Create the importer for the data category of a bulletin
+std::unique_ptr<wr::Importer>
+create_importer(const wreport::Bulletin& msg,
+                const dballe::ImporterOptions& opts)
+{
+    // Infer the right importer. See Common Code Table C-13
+    switch (msg.data_category)
+    {
+        // Surface data - land
+        case 0:
+            switch (msg.data_subcategory)
+            {
+                // Routine aeronautical observations (METAR)
+                case 10: return wr::Importer::createMetar(opts);
+                default:
+                    // Old ECMWF METAR type
+                    if (msg.data_subcategory_local == 140)
+                        return wr::Importer::createMetar(opts);
+                    else
+                        return wr::Importer::createSynop(opts);
+            }
+        // Surface data - sea
+        case 1: return wr::Importer::createShip(opts);
+        // Vertical soundings (other than satellite)
+        case 2: return wr::Importer::createTemp(opts);
+        // Vertical soundings (satellite)
+        case 3: return wr::Importer::createSat(opts);
+        // Single level upper-air data (other than satellite)
+        case 4: return wr::Importer::createFlight(opts);
+        // Radar data
+        case 6:
+            if (msg.data_subcategory == 1)
+                // Doppler wind profiles
+                return wr::Importer::createTemp(opts);
+            else
+                return wr::Importer::createGeneric(opts);
+        // Physical/chemical constituents
+        case 8:  return wr::Importer::createPollution(opts);
+        default: return wr::Importer::createGeneric(opts);
+    }
+}
+
+/**
+ * Interpret the subsets of a bulletin with a set of threads, each with its
+ * own importer, created once for the whole bulletin.
+ *
+ * Threads interpret subsets at most a window ahead of the first one not yet
+ * sent to dest, and the resulting messages are sent to dest in the order of
+ * their subsets, by the calling thread.
+ */
+class ParallelSubsets
+{
+protected:
+    /// Result of interpreting a subset
+    struct Slot
+    {
+        std::shared_ptr<dballe::Message> result;
+        std::exception_ptr error;
+        bool ready = false;
+    };
+
+    const wreport::Bulletin& msg;
+    const dballe::ImporterOptions& opts;
+    MessageType type;
+    /// Results of the subsets being interpreted, by subset position modulo
+    /// their number
+    std::vector<Slot> slots;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    /// Notified when a subset has been interpreted
+    std::condition_variable decoded;
+    /// Notified when a subset has been sent to dest, or when stopping
+    std::condition_variable consumed;
+    /// Position of the next subset to interpret
+    size_t next_decode  = 0;
+    /// Position of the next subset to send to dest
+    size_t next_consume = 0;
+    /// Set to make the threads stop
+    bool stop           = false;
+
+    void work(wr::Importer& importer)
+    {
+        // wreport options are per thread
+        WreportVarOptionsForImport wreport_config(opts.domain_errors);
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            consumed.wait(lock, [this] {
+                return stop || next_decode >= msg.subsets.size() ||
+                       next_decode < next_consume + slots.size();
+            });
+            if (stop || next_decode >= msg.subsets.size())
+                return;
+            size_t pos = next_decode++;
+            lock.unlock();
+
+            std::shared_ptr<dballe::Message> result;
+            std::exception_ptr error;
+            try
+            {
+                auto newmsg  = std::make_shared<Message>();
+                newmsg->type = type;
+                importer.import_subset(msg, msg.subsets[pos], *newmsg);
+                result = std::move(newmsg);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            lock.lock();
+            Slot& slot  = slots[pos % slots.size()];
+            slot.result = std::move(result);
+            slot.error  = error;
+            slot.ready  = true;
+            decoded.notify_all();
+        }
+    }
+
+public:
+    ParallelSubsets(const wreport::Bulletin& msg,
+                    const dballe::ImporterOptions& opts, MessageType type,
+                    size_t window)
+        : msg(msg), opts(opts), type(type), slots(window)
+    {
+    }
+    ParallelSubsets(const ParallelSubsets&)            = delete;
+    ParallelSubsets& operator=(const ParallelSubsets&) = delete;
+
+    /**
+     * Stop and join the threads.
+     *
+     * This also runs if starting a thread or sending a result to dest throws,
+     * so that no thread is left joinable.
+     */
+    ~ParallelSubsets()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        consumed.notify_all();
+        for (auto& t : threads)
+            t.join();
+    }
+
+    /// Start one thread for each importer
+    void start(std::vector<std::unique_ptr<wr::Importer>>& importers)
+    {
+        threads.reserve(importers.size());
+        for (auto& importer : importers)
+        {
+            wr::Importer* imp = importer.get();
+            threads.emplace_back([this, imp] { work(*imp); });
+        }
+    }
+
+    /// Send the interpreted subsets to dest, in order
+    bool run(std::function<bool(std::shared_ptr<dballe::Message>)>& dest)
+    {
+        for (size_t pos = 0; pos < msg.subsets.size(); ++pos)
+        {
+            std::shared_ptr<dballe::Message> result;
+            std::exception_ptr error;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                Slot& slot = slots[pos % slots.size()];
+                decoded.wait(lock, [&slot] { return slot.ready; });
+                result       = std::move(slot.result);
+                error        = slot.error;
+                slot         = Slot();
+                next_consume = pos + 1;
+            }
+            consumed.notify_all();
+
+            // Report errors and results as a sequential import would
+            if (error)
+                std::rethrow_exception(error);
+            if (!dest(std::move(result)))
+                return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * Interpret the subsets of msg with opts.jobs threads, sending the results to
+ * dest in the order of their subsets
+ */
+bool foreach_decoded_subsets_parallel(
+    const wreport::Bulletin& msg, const dballe::ImporterOptions& opts,
+    std::function<bool(std::shared_ptr<dballe::Message>)> dest)
+{
+    // Load the DB-All.e variable table before the threads need it
+    varinfo(WR_VAR(0, 1, 1));
+
+    MessageType type = create_importer(msg, opts)->scanType(msg);
+    unsigned jobs    = std::min<size_t>(opts.jobs, msg.subsets.size());
+    std::vector<std::unique_ptr<wr::Importer>> importers;
+    for (unsigned j = 0; j < jobs; ++j)
+        importers.emplace_back(create_importer(msg, opts));
+
+    ParallelSubsets subsets(msg, opts, type, jobs * subsets_per_job);
+    subsets.start(importers);
+    return subsets.run(dest);
+}
+
+} // namespace
+
 WRImporter::WRImporter(const dballe::ImporterOptions& opts)
     : BulletinImporter(opts)
 {
@@ -65,46 +286,10 @@ bool WRImporter::foreach_decoded_bulletin(
 {
     WreportVarOptionsForImport wreport_config(opts.domain_errors);
 
-    // Infer the right importer. See Common Code Table C-13
-    std::unique_ptr<wr::Importer> importer;
-    switch (msg.data_category)
-    {
-        // Surface data - land
-        case 0:
-            switch (msg.data_subcategory)
-            {
-                // Routine aeronautical observations (METAR)
-                case 10: importer = wr::Importer::createMetar(opts); break;
-                default:
-                    // Old ECMWF METAR type
-                    if (msg.data_subcategory_local == 140)
-                        importer = wr::Importer::createMetar(opts);
-                    else
-                        importer = wr::Importer::createSynop(opts);
-                    break;
-            }
-            break;
-        // Surface data - sea
-        case 1: importer = wr::Importer::createShip(opts); break;
-        // Vertical soundings (other than satellite)
-        case 2: importer = wr::Importer::createTemp(opts); break;
-        // Vertical soundings (satellite)
-        case 3: importer = wr::Importer::createSat(opts); break;
-        // Single level upper-air data (other than satellite)
-        case 4: importer = wr::Importer::createFlight(opts); break;
-        // Radar data
-        case 6:
-            if (msg.data_subcategory == 1)
-                // Doppler wind profiles
-                importer = wr::Importer::createTemp(opts);
-            else
-                importer = wr::Importer::createGeneric(opts);
-            break;
-        // Physical/chemical constituents
-        case 8:  importer = wr::Importer::createPollution(opts); break;
-        default: importer = wr::Importer::createGeneric(opts); break;
-    }
+    if (opts.jobs > 1 && msg.subsets.size() > 1)
+        return foreach_decoded_subsets_parallel(msg, opts, dest);
 
+    std::unique_ptr<wr::Importer> importer = create_importer(msg, opts);
     MessageType type = importer->scanType(msg);
     for (unsigned i = 0; i < msg.subsets.size(); ++i)
     {
@@ -182,9 +367,17 @@ unique_ptr<wr::Template> WRExporter::infer_template(const Messages& msgs) const
 }
 
 unique_ptr<Bulletin> WRExporter::to_bulletin(const Messages& msgs) const
+{
+    wr::ExportPlan plan;
+    return to_bulletin(msgs, plan);
+}
+
+unique_ptr<Bulletin> WRExporter::to_bulletin(const Messages& msgs,
+                                             wr::ExportPlan& plan) const
 {
     std::unique_ptr<wr::Template> encoder = infer_template(msgs);
     // fprintf(stderr, "Encoding with template %s\n", encoder->name());
+    encoder->plan                         = &plan;
     auto res                              = make_bulletin();
     encoder->to_bulletin(*res);
     return res;
@@ -192,6 +385,51 @@ unique_ptr<Bulletin> WRExporter::to_bulletin(const Messages& msgs) const
 
 namespace wr {
 
+const msg::Context* ExportPlan::find(const Message& msg, const Level& level,
+                                     const Trange& trange)
+{
+    auto begin    = msg.data.begin();
+    auto end      = msg.data.end();
+    unsigned size = msg.data.size();
+
+    if (next < slots.size())
+    {
+        const Slot& slot = slots[next];
+        if (slot.found)
+        {
+            if (slot.pos < size && begin[slot.pos].compare(level, trange) == 0)
+            {
+                ++next;
+                return &begin[slot.pos];
+            }
+        }
+        else if (slot.pos <= size &&
+                 (slot.pos == 0 ||
+                  begin[slot.pos - 1].compare(level, trange) < 0) &&
+                 (slot.pos == size ||
+                  begin[slot.pos].compare(level, trange) > 0))
+        {
+            ++next;
+            return nullptr;
+        }
+    }
+
+    // The layout is different from the previous message: search
+    auto i = std::lower_bound(begin, end, 0,
+                              [&](const msg::Context& c, int) {
+                                  return c.compare(level, trange) < 0;
+                              });
+    Slot slot;
+    slot.pos   = i - begin;
+    slot.found = i != end && i->compare(level, trange) == 0;
+    if (next < slots.size())
+        slots[next] = slot;
+    else
+        slots.push_back(slot);
+    ++next;
+    return slot.found ? &*i : nullptr;
+}
+
 extern void register_synop(TemplateRegistry&);
 extern void register_ship(TemplateRegistry&);
 extern void register_buoy(TemplateRegistry&);
@@ -267,10 +505,18 @@ void Template::to_bulletin(wreport::Bulletin& bulletin)
 {
     setupBulletin(bulletin);
 
+    // Subsets of the same template have about the same size: reserve space
+    // for each one based on the previous, to avoid growing them one
+    // variable at a time
+    bulletin.subsets.reserve(msgs.size());
+    size_t last_size = 0;
     for (unsigned i = 0; i < msgs.size(); ++i)
     {
         Subset& s = bulletin.obtain_subset(i);
+        s.reserve(last_size);
+        plan->next = 0;
         to_subset(Message::downcast(*msgs[i]), s);
+        last_size = s.size();
     }
 }
 
@@ -316,7 +562,13 @@ void Template::to_subset(const Message& msg, wreport::Subset& subset)
 {
     this->msg           = &msg;
     this->subset        = &subset;
-    this->c_gnd_instant = msg.find_context(Level(1), Trange::instant());
+    this->c_gnd_instant = find_context(Level(1), Trange::instant());
+}
+
+const msg::Context* Template::find_context(const Level& level,
+                                           const Trange& trange) const
+{
+    return plan->find(*msg, level, trange);
 }
 
 void Template::add(Varcode code, const msg::Context* ctx,
@@ -367,13 +619,19 @@ void Template::add(Varcode code, const Values& values,
 
 void Template::add(Varcode code, const Shortcut& shortcut) const
 {
-    add(code, msg->get(shortcut));
+    if (shortcut.station_data)
+        add(code, msg->station_data, shortcut);
+    else
+        add(code, find_context(shortcut.level, shortcut.trange), shortcut);
 }
 
 void Template::add(Varcode code, Varcode srccode, const Level& level,
                    const Trange& trange) const
 {
-    add(code, msg->get(level, trange, srccode));
+    if (level.is_missing() && trange.is_missing())
+        add(code, msg->station_data.maybe_var(srccode));
+    else
+        add(code, find_context(level, trange), srccode);
 }
 
 void Template::add(wreport::Varcode code, const wreport::Var* var) const
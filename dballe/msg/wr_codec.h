@@ -9,6 +9,7 @@
 #include <map>
 #include <stdint.h>
 #include <string>
+#include <vector>
 #include <wreport/varinfo.h>
 
 namespace wreport {
@@ -79,7 +80,38 @@ public:
 
 namespace wr {
 class Template;
-}
+
+/**
+ * Positions in Message::data of the contexts looked up by a template while
+ * encoding a subset, in lookup order.
+ *
+ * Messages of a homogeneous export have the same layout of contexts, so the
+ * position used for the previous message can be checked with one or two
+ * comparisons instead of searching the contexts again.
+ */
+struct ExportPlan
+{
+    struct Slot
+    {
+        /// Position of the context, or where it would be if missing
+        unsigned pos;
+        /// True if the context exists
+        bool found;
+    };
+
+    std::vector<Slot> slots;
+    /// Next slot to use while encoding the current subset
+    unsigned next = 0;
+
+    /**
+     * Look up a context in msg, checking the next slot first and updating
+     * it if the message has a different layout
+     */
+    const msg::Context* find(const Message& msg, const Level& level,
+                             const Trange& trange);
+};
+
+} // namespace wr
 
 class WRExporter : public BulletinExporter
 {
@@ -93,6 +125,17 @@ public:
     to_bulletin(const std::vector<std::shared_ptr<dballe::Message>>& msgs)
         const override;
 
+    /**
+     * Export messages to a bulletin using the given plan, reusing the context
+     * positions stored in it by previous calls.
+     *
+     * Each thread encoding messages with the same exporter needs to use its
+     * own plan.
+     */
+    std::unique_ptr<wreport::Bulletin>
+    to_bulletin(const std::vector<std::shared_ptr<dballe::Message>>& msgs,
+                wr::ExportPlan& plan) const;
+
     /**
      * Infer a template name from the message contents
      */
@@ -166,12 +209,19 @@ protected:
     // Latitude and longitude, coarse accuracy
     void do_D01023() const;
 
+    /// Look up a context in the message being read, using the export plan
+    const msg::Context* find_context(const Level& level,
+                                     const Trange& trange) const;
+
 public:
     const dballe::ExporterOptions& opts;
     const Messages& msgs;
     const Message* msg                = 0; // Message being read
     const msg::Context* c_gnd_instant = 0;
     wreport::Subset* subset           = 0; // Subset being written
+    ExportPlan local_plan;
+    /// Context positions used to encode subsets
+    ExportPlan* plan = &local_plan;
 
     Template(const dballe::ExporterOptions& opts, const Messages& msgs)
         : opts(opts), msgs(msgs)
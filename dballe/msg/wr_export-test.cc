@@ -148,6 +148,30 @@ class Tests : public TestCase
                 throw TestFailed(ss.str());
             }
         });
+        add_method("reused_exporter", []() {
+            // Exporting messages with different layouts with the same
+            // export plan gives the same results as using a new plan each
+            // time
+            const char* fnames[] = {
+                "bufr/obs0-1.22.bufr",        "bufr/synop-rad1.bufr",
+                "bufr/synop-cloudbelow.bufr", "bufr/obs0-1.22.bufr",
+                "bufr/synop-tchange.bufr",    "bufr/synop-rad1.bufr",
+            };
+            auto exporter = get_exporter();
+            const auto& wrexporter =
+                dynamic_cast<const impl::msg::WRExporter&>(*exporter);
+            impl::msg::wr::ExportPlan plan;
+            for (const auto& fname : fnames)
+            {
+                WREPORT_TEST_INFO(info);
+                info() << fname;
+                impl::Messages msgs = read_msgs(fname, Encoding::BUFR);
+                std::string reused =
+                    wrexporter.to_bulletin(msgs, plan)->encode();
+                std::string fresh = exporter->to_bulletin(msgs)->encode();
+                wassert(actual(reused) == fresh);
+            }
+        });
         add_method("reproduce_temp", []() {
             // Export a well known TEMP which used to fail
             impl::Messages msgs = wcallchecked(read_msgs_csv("csv/temp1.csv"));
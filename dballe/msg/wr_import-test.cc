@@ -564,6 +564,108 @@ void Tests::register_tests()
         wassert(actual(v->enqd()) == 284.75);
     });
 
+    // Decode only the variables in varlist
+    add_method("varlist", [] {
+        impl::ImporterOptions opts;
+        opts.simplified = false;
+        opts.varlist.push_back(WR_VAR(0, 12, 101));
+        impl::Messages msgs = wcallchecked(
+            read_msgs("bufr/gts-synop-linate.bufr", Encoding::BUFR, opts));
+        wassert(actual(msgs.size()) == 1u);
+        const impl::Message& msg = impl::Message::downcast(*msgs[0]);
+
+        // Station data is always kept
+        wassert(actual(msg.station_data.empty()).isfalse());
+
+        const Var* v =
+            msg.get(Level(103, 2000), Trange(3, 0, 43200), WR_VAR(0, 12, 101));
+        wassert(actual(v).istrue());
+        wassert(actual(v->enqd()) == 284.75);
+
+        for (const auto& ctx : msg.data)
+            for (const auto& val : ctx.values)
+                wassert(actual_varcode(val.code()) == WR_VAR(0, 12, 101));
+    });
+
+    // Interpret subsets in parallel
+    add_method("jobs", [] {
+        impl::ImporterOptions opts;
+        impl::Messages msgs1 = wcallchecked(
+            read_msgs("bufr/synop-longname.bufr", Encoding::BUFR, opts));
+        wassert(actual(msgs1.size()) == 7u);
+
+        opts.jobs            = 3;
+        impl::Messages msgs2 = wcallchecked(
+            read_msgs("bufr/synop-longname.bufr", Encoding::BUFR, opts));
+        wassert(actual(impl::messages_diff(msgs1, msgs2)) == 0u);
+    });
+
+    // Interpret in parallel more subsets than the threads can interpret
+    // ahead of those already sent
+    add_method("jobs_many_subsets", [] {
+        BinaryMessage raw =
+            read_rawmsg("bufr/synop-longname.bufr", Encoding::BUFR);
+        auto bulletin = BufrBulletin::decode(raw.data);
+        size_t size   = bulletin->subsets.size();
+        for (size_t i = size; i < 300; ++i)
+        {
+            Subset subset(bulletin->subsets[i % size]);
+            bulletin->subsets.emplace_back(std::move(subset));
+        }
+
+        impl::ImporterOptions opts;
+        impl::Messages msgs1 =
+            Importer::create(Encoding::BUFR, opts)->from_bulletin(*bulletin);
+        wassert(actual(msgs1.size()) == 300u);
+
+        opts.jobs = 2;
+        impl::Messages msgs2 =
+            Importer::create(Encoding::BUFR, opts)->from_bulletin(*bulletin);
+        wassert(actual(impl::messages_diff(msgs1, msgs2)) == 0u);
+    });
+
+    // Errors in parallel interpretation are reported for the first subset
+    // that fails, after sending the results of all the subsets before it
+    add_method("jobs_error_order", [] {
+        BinaryMessage raw =
+            read_rawmsg("bufr/synop-longname.bufr", Encoding::BUFR);
+        auto bulletin = BufrBulletin::decode(raw.data);
+        size_t size   = bulletin->subsets.size();
+        for (size_t i = size; i < 300; ++i)
+        {
+            Subset subset(bulletin->subsets[i % size]);
+            bulletin->subsets.emplace_back(std::move(subset));
+        }
+        // A vertical significance at the start of a subset makes its
+        // interpretation fail
+        for (size_t pos : {250, 150})
+        {
+            Subset& subset = bulletin->subsets[pos];
+            subset.insert(subset.begin(),
+                          Var(subset.tables->btable->query(WR_VAR(0, 8, 2))));
+        }
+
+        for (unsigned jobs : {1, 3})
+        {
+            WREPORT_TEST_INFO(info);
+            info() << jobs << " jobs";
+            impl::ImporterOptions opts;
+            opts.jobs     = jobs;
+            auto importer = Importer::create(Encoding::BUFR, opts);
+            const auto& wrimporter =
+                dynamic_cast<const impl::msg::WRImporter&>(*importer);
+            unsigned sent = 0;
+            wassert_throws(
+                wreport::error_consistency,
+                wrimporter.foreach_decoded_bulletin(
+                    *bulletin, [&](std::shared_ptr<dballe::Message>) {
+                        ++sent;
+                        return true;
+                    }));
+            wassert(actual(sent) == 150u);
+        }
+    });
+
     // Soil temperature (see https://github.com/ARPA-SIMC/dballe/issues/41 )
     add_bufr_simplified_method(
         "test-soil1.bufr", [](const impl::Messages& msgs) {
@@ -52,14 +52,35 @@ void Importer::import_subset(const wreport::Bulletin& bulletin,
     postprocess();
 }
 
+bool Importer::wanted(wreport::Varcode code, const Level& level,
+                      const Trange& trange) const
+{
+    if (opts.varlist.empty())
+        return true;
+    if (level.is_missing() && trange.is_missing())
+        return true;
+    return opts.wants(code);
+}
+
+bool Importer::wanted(const Shortcut& shortcut) const
+{
+    if (opts.varlist.empty() || shortcut.station_data)
+        return true;
+    return opts.wants(shortcut.code);
+}
+
 void Importer::set(const wreport::Var& var, const Shortcut& shortcut)
 {
+    if (!wanted(shortcut))
+        return;
     msg->set(shortcut, var);
 }
 
 void Importer::set(const wreport::Var& var, wreport::Varcode code,
                    const Level& level, const Trange& trange)
 {
+    if (!wanted(code, level, trange))
+        return;
     msg->set(level, trange, code, var);
 }
 
@@ -443,7 +464,7 @@ void SynopBaseImporter::set_gen_sensor(const Var& var, Varcode code,
                                        const Level& lev_std,
                                        const Trange& tr_std)
 {
-    if (unsupported.is_unsupported())
+    if (unsupported.is_unsupported() || !wanted(code, lev_std, tr_std))
         return;
     auto res = create_interpreted(opts.simplified, code, var, lev_std, tr_std);
     res->set_sensor_height(level);
@@ -453,7 +474,7 @@ void SynopBaseImporter::set_gen_sensor(const Var& var, Varcode code,
 
 void SynopBaseImporter::set_gen_sensor(const Var& var, const Shortcut& shortcut)
 {
-    if (unsupported.is_unsupported())
+    if (unsupported.is_unsupported() || !wanted(shortcut))
         return;
     auto res = create_interpreted(opts.simplified, shortcut, var);
     res->set_sensor_height(level);
@@ -464,7 +485,7 @@ void SynopBaseImporter::set_gen_sensor(const Var& var, const Shortcut& shortcut)
 void SynopBaseImporter::set_baro_sensor(const Var& var,
                                         const Shortcut& shortcut)
 {
-    if (unsupported.is_unsupported())
+    if (unsupported.is_unsupported() || !wanted(shortcut))
         return;
     auto res = create_interpreted(opts.simplified, shortcut, var);
     res->set_barometer_height(level);
@@ -475,7 +496,7 @@ void SynopBaseImporter::set_baro_sensor(const Var& var,
 void SynopBaseImporter::set_past_weather(const wreport::Var& var,
                                          const Shortcut& shortcut)
 {
-    if (unsupported.is_unsupported())
+    if (unsupported.is_unsupported() || !wanted(shortcut))
         return;
     auto res = create_interpreted(opts.simplified, shortcut, var);
     res->trange =
@@ -492,7 +513,7 @@ void SynopBaseImporter::set_wind(const wreport::Var& var,
             "Found unsupported time significance %d for wind direction",
             trange.time_sig);
 
-    if (unsupported.is_unsupported())
+    if (unsupported.is_unsupported() || !wanted(shortcut))
         return;
     auto res   = create_interpreted(opts.simplified, shortcut, var);
     res->level = lev_std_wind;
@@ -504,7 +525,7 @@ void SynopBaseImporter::set_wind(const wreport::Var& var,
 void SynopBaseImporter::set_wind_max(const wreport::Var& var,
                                      const Shortcut& shortcut)
 {
-    if (unsupported.is_unsupported())
+    if (unsupported.is_unsupported() || !wanted(shortcut))
         return;
     auto res = create_interpreted(opts.simplified, shortcut, var, lev_std_wind,
                                   tr_std_wind_max10m);
@@ -29,6 +29,15 @@ protected:
     virtual void run();
     virtual void postprocess();
 
+    /**
+     * Check if a value is to be imported according to opts.varlist.
+     *
+     * Station information is always imported.
+     */
+    bool wanted(wreport::Varcode code, const Level& level,
+                const Trange& trange) const;
+    bool wanted(const Shortcut& shortcut) const;
+
     void set(const wreport::Var& var, const Shortcut& shortcut);
     void set(const wreport::Var& var, wreport::Varcode code, const Level& level,
              const Trange& trange);
@@ -139,6 +139,8 @@ void GenericImporter::import_var(const Var& var)
     {
         // Legacy variable conversions
         case WR_VAR(0, 8, 1): {
+            if (!wanted(WR_VAR(0, 8, 42), lev, tr))
+                break;
             unique_ptr<Var> nvar(
                 newvar(WR_VAR(0, 8, 42),
                        (int)convert_BUFR08001_to_BUFR08042(var.enqi())));
@@ -154,7 +156,7 @@ void GenericImporter::import_var(const Var& var)
         case WR_VAR(0, 4, 5): msg->set_minute_var(var); break;
         case WR_VAR(0, 4, 6): msg->set_second_var(var); break;
         // Anything else
-        default: msg->set(lev, tr, map_code_to_dballe(var.code()), var); break;
+        default: set(var, map_code_to_dballe(var.code()), lev, tr); break;
     }
 }
 
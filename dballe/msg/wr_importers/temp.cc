@@ -270,8 +270,7 @@ void TempImporter::import_var(const Var& var)
             break;
             /* Cloud information reported with vertical soundings */
         case WR_VAR(0, 8, 2):
-            msg->set(Level::cloud(258, 0), Trange::instant(), WR_VAR(0, 8, 2),
-                     var);
+            set(var, WR_VAR(0, 8, 2), Level::cloud(258, 0), Trange::instant());
             break;
         case WR_VAR(0, 20, 10): msg->set_cloud_n_var(var); break;
         case WR_VAR(0, 20, 11): msg->set_cloud_nh_var(var); break;
@@ -284,8 +283,8 @@ void TempImporter::import_var(const Var& var)
                 if (pos > 1 && (*subset)[pos - 2].code() == WR_VAR(0, 20, 12))
                     ++l2;
             }
-            msg->set(Level::cloud(258, l2), Trange::instant(),
-                     WR_VAR(0, 20, 12), var);
+            set(var, WR_VAR(0, 20, 12), Level::cloud(258, l2),
+                Trange::instant());
             break;
         }
         case WR_VAR(0, 22, 43):
@@ -295,8 +294,7 @@ void TempImporter::import_var(const Var& var)
         // Long time period or displacement (since launch time)
         case WR_VAR(0, 4, 16):
         case WR_VAR(0, 4, 86):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 4, 86),
-                     var);
+            set(var, WR_VAR(0, 4, 86), Level(100, press), Trange::instant());
             break;
         // Extended vertical sounding significance
         case WR_VAR(0, 8, 42): {
@@ -312,22 +310,22 @@ void TempImporter::import_var(const Var& var)
                 else
                     press = MISSING_INT;
             }
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 8, 42),
-                     var);
+            set(var, WR_VAR(0, 8, 42), Level(100, press), Trange::instant());
             break;
         }
         // Pressure
         case WR_VAR(0, 7, 4):
             press     = var.enqd();
             press_var = &var;
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 10, 4),
-                     var);
+            set(var, WR_VAR(0, 10, 4), Level(100, press), Trange::instant());
             break;
         // Vertical sounding significance
         case WR_VAR(0, 8, 1): {
             // This account for weird data that has '1' for VSS
             unsigned val = convert_BUFR08001_to_BUFR08042(var.enqi());
-            if (val != BUFR08042::ALL_MISSING)
+            if (val != BUFR08042::ALL_MISSING &&
+                wanted(WR_VAR(0, 8, 42), Level(100, press),
+                       Trange::instant()))
             {
                 unique_ptr<Var> nvar(newvar(WR_VAR(0, 8, 42), (int)val));
                 nvar->setattrs(var);
@@ -342,68 +340,54 @@ void TempImporter::import_var(const Var& var)
             break;
         // Geopotential
         case WR_VAR(0, 10, 3):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 10, 8),
-                     var);
+            set(var, WR_VAR(0, 10, 8), Level(100, press), Trange::instant());
             break;
         case WR_VAR(0, 10, 8):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 10, 8),
-                     var);
+            set(var, WR_VAR(0, 10, 8), Level(100, press), Trange::instant());
             break;
         case WR_VAR(0, 10, 9):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 10, 8),
-                     var);
+            set(var, WR_VAR(0, 10, 8), Level(100, press), Trange::instant());
             break;
         // Latitude displacement
         case WR_VAR(0, 5, 15):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 5, 15),
-                     var);
+            set(var, WR_VAR(0, 5, 15), Level(100, press), Trange::instant());
             break;
         // Longitude displacement
         case WR_VAR(0, 6, 15):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 6, 15),
-                     var);
+            set(var, WR_VAR(0, 6, 15), Level(100, press), Trange::instant());
             break;
         // Dry bulb temperature
         case WR_VAR(0, 12, 1):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 12, 101),
-                     var);
+            set(var, WR_VAR(0, 12, 101), Level(100, press), Trange::instant());
             break;
         case WR_VAR(0, 12, 101):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 12, 101),
-                     var);
+            set(var, WR_VAR(0, 12, 101), Level(100, press), Trange::instant());
             break;
         // Wet bulb temperature
         case WR_VAR(0, 12, 2):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 12, 2),
-                     var);
+            set(var, WR_VAR(0, 12, 2), Level(100, press), Trange::instant());
             break;
         // Dew point temperature
         case WR_VAR(0, 12, 3):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 12, 103),
-                     var);
+            set(var, WR_VAR(0, 12, 103), Level(100, press), Trange::instant());
             break;
         case WR_VAR(0, 12, 103):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 12, 103),
-                     var);
+            set(var, WR_VAR(0, 12, 103), Level(100, press), Trange::instant());
             break;
         // Wind direction
         case WR_VAR(0, 11, 1):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 11, 1),
-                     var);
+            set(var, WR_VAR(0, 11, 1), Level(100, press), Trange::instant());
             break;
         // Wind speed
         case WR_VAR(0, 11, 2):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 11, 2),
-                     var);
+            set(var, WR_VAR(0, 11, 2), Level(100, press), Trange::instant());
             break;
             /* Wind shear data at a pressure level */
         case WR_VAR(0, 11, 61):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 11, 61),
-                     var);
+            set(var, WR_VAR(0, 11, 61), Level(100, press), Trange::instant());
             break;
         case WR_VAR(0, 11, 62):
-            msg->set(Level(100, press), Trange::instant(), WR_VAR(0, 11, 62),
-                     var);
+            set(var, WR_VAR(0, 11, 62), Level(100, press), Trange::instant());
             break;
         default: WMOImporter::import_var(var); break;
     }
@@ -448,6 +432,7 @@ void TempImporter::import_group(unsigned start, unsigned length)
     // sounding group");
 
     // Import all values
+    const bool want_vss = wanted(WR_VAR(0, 8, 42), lev, Trange::instant());
     for (unsigned i = 0; i < length; ++i)
     {
         const Var& var = (*subset)[start + i];
@@ -459,6 +444,8 @@ void TempImporter::import_group(unsigned start, unsigned length)
                 case WR_VAR(0, 8, 42):
                     // Preserve missing VSS with only the one missing bit set,
                     // to act as a sounding context marker
+                    if (!want_vss)
+                        break;
                     msg->set(lev, Trange::instant(),
                              newvar(WR_VAR(0, 8, 42), (int)BUFR08042::MISSING));
                     break;
@@ -469,25 +456,27 @@ void TempImporter::import_group(unsigned start, unsigned length)
         {
             case WR_VAR(0, 4, 16):
             case WR_VAR(0, 4, 86):
-                msg->set(lev, Trange::instant(), WR_VAR(0, 4, 86), var);
+                set(var, WR_VAR(0, 4, 86), lev, Trange::instant());
                 break;
             case WR_VAR(0, 5, 1):
             case WR_VAR(0, 5, 2):
-                msg->set(lev, Trange::instant(), WR_VAR(0, 5, 1), var);
+                set(var, WR_VAR(0, 5, 1), lev, Trange::instant());
                 break;
             case WR_VAR(0, 5, 15):
-                msg->set(lev, Trange::instant(), WR_VAR(0, 5, 15), var);
+                set(var, WR_VAR(0, 5, 15), lev, Trange::instant());
                 break;
             case WR_VAR(0, 6, 1):
             case WR_VAR(0, 6, 2):
-                msg->set(lev, Trange::instant(), WR_VAR(0, 6, 1), var);
+                set(var, WR_VAR(0, 6, 1), lev, Trange::instant());
                 break;
             case WR_VAR(0, 6, 15):
-                msg->set(lev, Trange::instant(), WR_VAR(0, 6, 15), var);
+                set(var, WR_VAR(0, 6, 15), lev, Trange::instant());
                 break;
             case WR_VAR(0, 8, 1): {
                 // This accounts for weird data that has '1' for VSS
                 unsigned val = convert_BUFR08001_to_BUFR08042(var.enqi());
+                if (!want_vss)
+                    break;
                 if (val == BUFR08042::ALL_MISSING)
                     msg->set(lev, Trange::instant(),
                              newvar(WR_VAR(0, 8, 42), (int)BUFR08042::MISSING));
@@ -500,36 +489,36 @@ void TempImporter::import_group(unsigned start, unsigned length)
             }
             break;
             case WR_VAR(0, 8, 42):
-                msg->set(lev, Trange::instant(), WR_VAR(0, 8, 42), var);
+                set(var, WR_VAR(0, 8, 42), lev, Trange::instant());
                 break;
             case WR_VAR(0, 10, 3):
-                msg->set(lev, Trange::instant(), WR_VAR(0, 10, 8), var);
+                set(var, WR_VAR(0, 10, 8), lev, Trange::instant());
                 break;
             case WR_VAR(0, 10, 9):
-                msg->set(lev, Trange::instant(), WR_VAR(0, 10, 8), var);
+                set(var, WR_VAR(0, 10, 8), lev, Trange::instant());
                 break;
             case WR_VAR(0, 12, 1):
             case WR_VAR(0, 12, 101):
-                msg->set(lev, Trange::instant(), WR_VAR(0, 12, 101), var);
+                set(var, WR_VAR(0, 12, 101), lev, Trange::instant());
                 break;
             case WR_VAR(0, 12, 3):
             case WR_VAR(0, 12, 103):
-                msg->set(lev, Trange::instant(), WR_VAR(0, 12, 103), var);
+                set(var, WR_VAR(0, 12, 103), lev, Trange::instant());
                 break;
             case WR_VAR(0, 7, 4):
             case WR_VAR(0, 10, 4):
-                msg->set(lev, Trange::instant(), WR_VAR(0, 10, 4), var);
+                set(var, WR_VAR(0, 10, 4), lev, Trange::instant());
                 break;
             case WR_VAR(0, 11, 1):
             case WR_VAR(0, 11, 2):
-                msg->set(lev, Trange::instant(), var.code(), var);
+                set(var, var.code(), lev, Trange::instant());
                 break;
             // Variables from Radar doppler wind profiles
             case WR_VAR(0, 11, 6):
-                msg->set(lev, Trange::instant(), var.code(), var);
+                set(var, var.code(), lev, Trange::instant());
                 break;
             case WR_VAR(0, 11, 50):
-                msg->set(lev, Trange::instant(), var.code(), var);
+                set(var, var.code(), lev, Trange::instant());
                 break;
             case WR_VAR(0, 33, 2):
                 // Doppler wind profiles transmit quality information inline,
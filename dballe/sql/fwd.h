@@ -13,6 +13,7 @@ class Statement;
 class Connection;
 class Sequence;
 class MySQLConnection;
+class MySQLStatement;
 class PostgreSQLConnection;
 class SQLiteConnection;
 class SQLiteStatement;
@@ -278,6 +278,46 @@ class Tests : public FixtureTestCase<ConnectorFixture>
             f.conn->exec_no_data("INSERT INTO dballe_testai (val) VALUES (43)");
             wassert(actual(f.conn->get_last_insert_id()) == 2);
         });
+        add_method("prepared", [](Fixture& f) {
+            // Test prepared statements
+            f.conn->drop_table_if_exists("dballe_testps");
+            f.conn->exec_no_data(
+                "CREATE TABLE dballe_testps (id INTEGER AUTO_INCREMENT "
+                "PRIMARY KEY, val INTEGER, dt DATETIME, str VARCHAR(255), "
+                "buf VARBINARY(255))");
+            auto stm = f.conn->mysqlstatement(
+                "INSERT INTO dballe_testps (val, dt, str, buf) VALUES "
+                "(?, ?, ?, ?), (?, ?, ?, ?)");
+            // Strings and buffers are not copied, and need to stay valid
+            std::vector<uint8_t> buf{0x00, 0xff};
+            std::string str("bar");
+            stm->bind(42, Datetime(2018, 6, 1, 12, 30), "foo", buf, 43u,
+                      Datetime(2018, 6, 2), str);
+            stm->bind_null_val(8);
+            stm->execute();
+            wassert(actual(stm->changes()) == 2u);
+
+            // The rows of a multi-row insert get consecutive IDs
+            unsigned step = f.conn->autoinc_step();
+            int id        = stm->get_last_insert_id();
+            wassert(actual(id) == 1);
+
+            auto res = f.conn->exec_store(
+                "SELECT id, val, dt, str, buf FROM dballe_testps ORDER BY val");
+            wassert(actual(res.rowcount()) == 2);
+            auto row = res.fetch();
+            wassert(actual(row.as_int(1)) == 42);
+            wassert(actual(row.as_datetime(2)) == Datetime(2018, 6, 1, 12, 30));
+            wassert(actual(row.as_string(3)) == "foo");
+            wassert(actual(row.as_blob(4) == buf).istrue());
+            row = res.fetch();
+            if (step)
+                wassert(actual(row.as_int(0)) == id + (int)step);
+            wassert(actual(row.as_int(1)) == 43);
+            wassert(actual(row.as_datetime(2)) == Datetime(2018, 6, 2));
+            wassert(actual(row.as_string(3)) == "bar");
+            wassert_true(row.isnull(4));
+        });
     }
 } test("db_sql_mysql", "MYSQL");
 
@@ -584,6 +584,12 @@ struct MySQLTransaction : public Transaction
     }
 };
 
+std::unique_ptr<MySQLStatement>
+MySQLConnection::mysqlstatement(const std::string& query)
+{
+    return unique_ptr<MySQLStatement>(new MySQLStatement(*this, query));
+}
+
 std::unique_ptr<Transaction> MySQLConnection::transaction(bool readonly)
 {
     // The default MySQL isolation level is REPEATABLE READ
@@ -606,6 +612,24 @@ int MySQLConnection::get_last_insert_id()
     return mysql_insert_id(db);
 }
 
+unsigned MySQLConnection::autoinc_step()
+{
+    using namespace dballe::sql::mysql;
+    if (m_autoinc_step != -1)
+        return m_autoinc_step;
+
+    // With the "interleaved" lock mode, the rows of a multi-row INSERT can
+    // get non consecutive values if other INSERTs run concurrently
+    Result res(exec_store(
+        "SELECT @@innodb_autoinc_lock_mode, @@auto_increment_increment"));
+    Row row = res.expect_one_result();
+    if (row.as_int(0) == 2)
+        m_autoinc_step = 0;
+    else
+        m_autoinc_step = row.as_int(1);
+    return m_autoinc_step;
+}
+
 bool MySQLConnection::has_table(const std::string& name)
 {
     using namespace dballe::sql::mysql;
@@ -694,5 +718,148 @@ void MySQLConnection::explain(const std::string& query, FILE* out)
     });
 }
 
+MySQLStatement::MySQLStatement(MySQLConnection& conn, const std::string& query)
+    : conn(conn), query(query)
+{
+    trace_query("prepare: %s\n", query.c_str());
+    conn.check_connection();
+
+    stm = mysql_stmt_init(conn);
+    if (!stm)
+        throw error_mysql(conn, "cannot create a prepared statement");
+
+    if (mysql_stmt_prepare(stm, query.data(), query.size()))
+    {
+        error_mysql e(mysql_stmt_error(stm), "cannot prepare '" + query + "'");
+        mysql_stmt_close(stm);
+        throw e;
+    }
+
+    if (mysql_stmt_field_count(stm) != 0)
+    {
+        mysql_stmt_close(stm);
+        error_consistency::throwf("cannot prepare '%s': statements that "
+                                  "return rows are not supported",
+                                  query.c_str());
+    }
+
+    unsigned count = mysql_stmt_param_count(stm);
+    binds.resize(count);
+    params.resize(count);
+    for (unsigned i = 0; i < count; ++i)
+        bind_null_val(i + 1);
+}
+
+MySQLStatement::~MySQLStatement()
+{
+    // Do not close the statement if the connection has been lost in a fork
+    if (stm && !conn.forked)
+        mysql_stmt_close(stm);
+}
+
+MYSQL_BIND& MySQLStatement::reset_bind(int idx)
+{
+    if (idx < 1 || (unsigned)idx > binds.size())
+        error_consistency::throwf(
+            "cannot bind parameter %d of '%s', which has %zu parameters", idx,
+            query.c_str(), binds.size());
+    MYSQL_BIND& res = binds[idx - 1];
+    memset(&res, 0, sizeof(MYSQL_BIND));
+    return res;
+}
+
+void MySQLStatement::bind_null_val(int idx)
+{
+    MYSQL_BIND& b = reset_bind(idx);
+    b.buffer_type = MYSQL_TYPE_NULL;
+}
+
+void MySQLStatement::bind_number(int idx, long long val)
+{
+    MYSQL_BIND& b = reset_bind(idx);
+    Param& p      = params[idx - 1];
+    p.number      = val;
+    b.buffer_type = MYSQL_TYPE_LONGLONG;
+    b.buffer      = &p.number;
+}
+
+void MySQLStatement::bind_val(int idx, int val) { bind_number(idx, val); }
+
+void MySQLStatement::bind_val(int idx, unsigned val) { bind_number(idx, val); }
+
+void MySQLStatement::bind_val(int idx, unsigned short val)
+{
+    bind_number(idx, val);
+}
+
+void MySQLStatement::bind_val(int idx, const Datetime& val)
+{
+    MYSQL_BIND& b = reset_bind(idx);
+    Param& p      = params[idx - 1];
+    memset(&p.time, 0, sizeof(MYSQL_TIME));
+    p.time.year      = val.year;
+    p.time.month     = val.month;
+    p.time.day       = val.day;
+    p.time.hour      = val.hour;
+    p.time.minute    = val.minute;
+    p.time.second    = val.second;
+    p.time.time_type = MYSQL_TIMESTAMP_DATETIME;
+    b.buffer_type    = MYSQL_TYPE_DATETIME;
+    b.buffer         = &p.time;
+}
+
+void MySQLStatement::bind_val(int idx, const char* val)
+{
+    MYSQL_BIND& b   = reset_bind(idx);
+    Param& p        = params[idx - 1];
+    p.length        = strlen(val);
+    b.buffer_type   = MYSQL_TYPE_STRING;
+    b.buffer        = const_cast<char*>(val);
+    b.buffer_length = p.length;
+    b.length        = &p.length;
+}
+
+void MySQLStatement::bind_val(int idx, const std::string& val)
+{
+    MYSQL_BIND& b   = reset_bind(idx);
+    Param& p        = params[idx - 1];
+    p.length        = val.size();
+    b.buffer_type   = MYSQL_TYPE_STRING;
+    b.buffer        = const_cast<char*>(val.data());
+    b.buffer_length = p.length;
+    b.length        = &p.length;
+}
+
+void MySQLStatement::bind_val(int idx, const std::vector<uint8_t>& val)
+{
+    MYSQL_BIND& b   = reset_bind(idx);
+    Param& p        = params[idx - 1];
+    p.length        = val.size();
+    b.buffer_type   = MYSQL_TYPE_BLOB;
+    b.buffer        = const_cast<uint8_t*>(val.data());
+    b.buffer_length = p.length;
+    b.length        = &p.length;
+}
+
+void MySQLStatement::execute()
+{
+    trace_query("execute: %s\n", query.c_str());
+    conn.check_connection();
+
+    if (!binds.empty() && mysql_stmt_bind_param(stm, binds.data()))
+        throw error_mysql(mysql_stmt_error(stm),
+                          "cannot bind parameters of '" + query + "'");
+    if (mysql_stmt_execute(stm))
+        throw error_mysql(mysql_stmt_error(stm),
+                          "cannot execute '" + query + "'");
+}
+
+int MySQLStatement::get_last_insert_id() { return mysql_stmt_insert_id(stm); }
+
+unsigned long long MySQLStatement::changes()
+{
+    return mysql_stmt_affected_rows(stm);
+}
+
 } // namespace sql
 } // namespace dballe
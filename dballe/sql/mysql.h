@@ -7,6 +7,7 @@
 #include <cstdlib>
 #include <dballe/sql/sql.h>
 #include <functional>
+#include <memory>
 #include <mysql.h>
 #include <vector>
 
@@ -162,6 +163,8 @@ protected:
 
     void check_connection();
 
+    friend struct MySQLStatement;
+
 public:
     MySQLConnection(const MySQLConnection&)  = delete;
     MySQLConnection(const MySQLConnection&&) = delete;
@@ -205,6 +208,9 @@ public:
     void exec_use(const std::string& query,
                   std::function<void(const mysql::Row&)> dest);
 
+    /// Create a server-side prepared statement
+    std::unique_ptr<MySQLStatement> mysqlstatement(const std::string& query);
+
     std::unique_ptr<Transaction> transaction(bool readonly = false) override;
     bool has_table(const std::string& name) override;
     std::string get_setting(const std::string& key) override;
@@ -225,6 +231,105 @@ public:
      * If not supported, an exception is thrown.
      */
     int get_last_insert_id();
+
+    /**
+     * Return the difference between the AUTO_INCREMENT values that a single
+     * multi-row INSERT into an InnoDB table assigns to consecutive rows, or 0
+     * if they are not guaranteed to be assigned without gaps.
+     *
+     * If it is not 0, the IDs of all the rows of a multi-row INSERT can be
+     * computed from get_last_insert_id(), which is the ID of the first row.
+     */
+    unsigned autoinc_step();
+
+protected:
+    /// Cached value for autoinc_step(), or -1 if not yet known
+    int m_autoinc_step = -1;
+};
+
+/**
+ * MySQL server-side prepared statement.
+ *
+ * Only statements that return no rows, like INSERT, are supported.
+ *
+ * Parameter positions start from 1. Numbers and datetimes are copied when
+ * bound, while strings and buffers are referenced, and need to remain valid
+ * until execute() is called.
+ */
+struct MySQLStatement
+{
+    MySQLConnection& conn;
+    std::string query;
+    MYSQL_STMT* stm = nullptr;
+
+    MySQLStatement(MySQLConnection& conn, const std::string& query);
+    MySQLStatement(const MySQLStatement&)  = delete;
+    MySQLStatement(const MySQLStatement&&) = delete;
+    ~MySQLStatement();
+    MySQLStatement& operator=(const MySQLStatement&) = delete;
+
+    /**
+     * Bind all the arguments in a single invocation.
+     *
+     * Note that the parameter positions are used as bind column numbers, so
+     * calling this function twice will re-bind columns instead of adding new
+     * ones.
+     */
+    template <typename... Args> void bind(const Args&... args)
+    {
+        bindn<sizeof...(args)>(args...);
+    }
+
+    void bind_null_val(int idx);
+    void bind_val(int idx, int val);
+    void bind_val(int idx, unsigned val);
+    void bind_val(int idx, unsigned short val);
+    void bind_val(int idx, const Datetime& val);
+    void bind_val(int idx, const char* val);
+    void bind_val(int idx, const std::string& val);
+    void bind_val(int idx, const std::vector<uint8_t>& val);
+
+    /// Run the statement with the currently bound parameters
+    void execute();
+
+    /**
+     * Return the AUTO_INCREMENT value generated by the last execute(), or the
+     * value of LAST_INSERT_ID(expr) if it was used
+     */
+    int get_last_insert_id();
+
+    /// Number of rows changed by the last execute()
+    unsigned long long changes();
+
+protected:
+    /// Storage for the values of numeric and datetime parameters
+    struct Param
+    {
+        long long number;
+        MYSQL_TIME time;
+        unsigned long length;
+    };
+
+    std::vector<MYSQL_BIND> binds;
+    std::vector<Param> params;
+
+    /// Reset the binding of parameter idx and return it
+    MYSQL_BIND& reset_bind(int idx);
+
+    /// Bind an integer parameter
+    void bind_number(int idx, long long val);
+
+private:
+    // Implementation of variadic bind: terminating condition
+    template <size_t total> void bindn() {}
+    // Implementation of variadic bind: recursive iteration over the parameter
+    // pack
+    template <size_t total, typename... Args, typename T>
+    void bindn(const T& first, const Args&... args)
+    {
+        bind_val(total - sizeof...(args), first);
+        bindn<total>(args...);
+    }
 };
 
 } // namespace sql
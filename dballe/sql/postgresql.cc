@@ -474,20 +474,12 @@ void PostgreSQLConnection::set_setting(const std::string& key,
         exec_no_data("CREATE TABLE dballe_settings (\"key\" TEXT NOT NULL "
                      "PRIMARY KEY, value TEXT NOT NULL)");
 
-    auto trans = transaction();
-    exec_no_data("LOCK TABLE dballe_settings IN EXCLUSIVE MODE");
-    auto s = exec_one_row(
-        "SELECT EXISTS (SELECT 1 FROM dballe_settings WHERE \"key\"=$1::text)",
-        key);
-    if (s.get_bool(0, 0))
-        exec_no_data(
-            "UPDATE dballe_settings SET value=$2::text WHERE \"key\"=$1::text",
-            key, value);
-    else
-        exec_no_data("INSERT INTO dballe_settings (\"key\", value) VALUES "
-                     "($1::text, $2::text)",
-                     key, value);
-    trans->commit();
+    // Use a single statement, so that the setting is written as part of the
+    // current transaction, if there is one
+    exec_no_data("INSERT INTO dballe_settings (\"key\", value) VALUES "
+                 "($1::text, $2::text) ON CONFLICT (\"key\") DO UPDATE SET "
+                 "value=EXCLUDED.value",
+                 key, value);
 }
 
 void PostgreSQLConnection::drop_settings()
@@ -104,7 +104,8 @@ public:
     /**
      * Set a value in the settings table.
      *
-     * The table is created if it does not exist.
+     * The table is created if it does not exist. The value is written as part
+     * of the current transaction, if one is open.
      */
     virtual void set_setting(const std::string& key,
                              const std::string& value) = 0;
@@ -1,6 +1,7 @@
 #include "dballe/core/tests.h"
 #include "dballe/db.h"
 #include "sqlite.h"
+#include <sys/stat.h>
 
 using namespace std;
 using namespace dballe;
@@ -189,6 +190,46 @@ void Tests::register_tests()
             *DBConnectOptions::create("sqlite:test.sqlite?a=b,c=d"));
         wassert_true(conn->server_type == sql::ServerType::SQLITE);
     });
+
+    add_method("profiles", [](Fixture& f) {
+        auto journal_mode = [](std::shared_ptr<Connection> conn) {
+            auto c = std::dynamic_pointer_cast<SQLiteConnection>(conn);
+            auto s = c->sqlitestatement("PRAGMA journal_mode");
+            std::string res;
+            s->execute_one([&]() { res = s->column_string(0); });
+            return res;
+        };
+
+        auto conn =
+            Connection::create(*DBConnectOptions::create("sqlite:test.sqlite"));
+        wassert(actual(journal_mode(conn)) == "memory");
+
+        conn.reset();
+        conn = Connection::create(*DBConnectOptions::create(
+            "sqlite:test.sqlite?profile=concurrent"));
+        wassert(actual(journal_mode(conn)) == "wal");
+        wassert(actual(conn->get_url()) ==
+                "sqlite://test.sqlite?profile=concurrent");
+
+        // The write-ahead log can be truncated on request
+        conn->execute("CREATE TABLE IF NOT EXISTS wal_test (val INTEGER)");
+        conn->execute("INSERT INTO wal_test VALUES (1)");
+        auto sqlite_conn = std::dynamic_pointer_cast<SQLiteConnection>(conn);
+        wassert_true(sqlite_conn->wal_checkpoint());
+        struct stat st;
+        wassert(actual(::stat("test.sqlite-wal", &st)) == 0);
+        wassert(actual(st.st_size) == 0);
+
+        // This also takes the file out of WAL mode
+        conn.reset();
+        conn = Connection::create(
+            *DBConnectOptions::create("sqlite:test.sqlite?profile=bulk"));
+        wassert(actual(journal_mode(conn)) == "memory");
+
+        wassert_throws(wreport::error_consistency,
+                       Connection::create(*DBConnectOptions::create(
+                           "sqlite:test.sqlite?profile=fast")));
+    });
 }
 
 } // namespace
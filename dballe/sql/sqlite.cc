@@ -1,4 +1,5 @@
 #include "sqlite.h"
+#include "dballe/core/string.h"
 #include "dballe/types.h"
 #include "querybuf.h"
 #include <cstdarg>
@@ -43,6 +44,29 @@ static int trace_callback(unsigned T, void* C, void* P, void* X)
 }
 #endif
 
+/// Write val as a zero padded number of the given number of digits
+inline void format_digits(char* buf, unsigned val, unsigned digits)
+{
+    for (unsigned i = digits; i > 0; --i)
+    {
+        buf[i - 1] = '0' + val % 10;
+        val /= 10;
+    }
+}
+
+/// Parse a number of the given number of digits, returning -1 on error
+inline int parse_digits(const char* buf, unsigned digits)
+{
+    int res = 0;
+    for (unsigned i = 0; i < digits; ++i)
+    {
+        if (buf[i] < '0' || buf[i] > '9')
+            return -1;
+        res = res * 10 + (buf[i] - '0');
+    }
+    return res;
+}
+
 } // namespace
 
 error_sqlite::error_sqlite(sqlite3* db, const std::string& msg)
@@ -122,6 +146,20 @@ void SQLiteConnection::open_file(const std::string& pathname, int flags)
 {
     this->pathname = pathname;
     this->flags    = flags;
+
+    std::string args = pathname;
+    std::string name;
+    if (!url_pop_query_string(args, "profile", name) || name == "default")
+        profile = SQLiteProfile::DEFAULT;
+    else if (name == "concurrent")
+        profile = SQLiteProfile::CONCURRENT;
+    else if (name == "bulk")
+        profile = SQLiteProfile::BULK;
+    else
+        error_consistency::throwf("unsupported SQLite profile '%s' "
+                                  "(supported: default, concurrent, bulk)",
+                                  name.c_str());
+
     url            = "sqlite://" + pathname;
     reopen();
 }
@@ -169,9 +207,30 @@ void SQLiteConnection::init_after_connect()
     // set_autocommit(false);
 
     exec("PRAGMA foreign_keys = ON");
-    exec("PRAGMA journal_mode = MEMORY");
     exec("PRAGMA legacy_file_format = 0");
 
+    switch (profile)
+    {
+        case SQLiteProfile::DEFAULT:
+            exec("PRAGMA journal_mode = MEMORY");
+            break;
+        case SQLiteProfile::CONCURRENT:
+            exec("PRAGMA journal_mode = WAL");
+            exec("PRAGMA synchronous = NORMAL");
+            exec("PRAGMA mmap_size = 268435456");
+            exec("PRAGMA cache_size = -65536");
+            exec("PRAGMA temp_store = MEMORY");
+            sqlite3_busy_timeout(db, 10000);
+            break;
+        case SQLiteProfile::BULK:
+            exec("PRAGMA journal_mode = MEMORY");
+            exec("PRAGMA synchronous = OFF");
+            exec("PRAGMA mmap_size = 268435456");
+            exec("PRAGMA cache_size = -262144");
+            exec("PRAGMA temp_store = MEMORY");
+            break;
+    }
+
     if (getenv("DBA_INSECURE_SQLITE") != NULL)
         exec("PRAGMA synchronous = OFF");
 
@@ -355,6 +414,18 @@ void SQLiteConnection::drop_settings()
 
 int SQLiteConnection::changes() { return sqlite3_changes(db); }
 
+bool SQLiteConnection::wal_checkpoint()
+{
+    check_connection();
+    int res = sqlite3_wal_checkpoint_v2(db, nullptr, SQLITE_CHECKPOINT_TRUNCATE,
+                                        nullptr, nullptr);
+    if (res == SQLITE_BUSY)
+        return false;
+    if (res != SQLITE_OK)
+        throw error_sqlite(db, "cannot checkpoint the write-ahead log");
+    return true;
+}
+
 #if SQLITE_VERSION_NUMBER >= 3014000
 void SQLiteConnection::trace(unsigned mask)
 {
@@ -389,8 +460,35 @@ SQLiteStatement::~SQLiteStatement()
 Datetime SQLiteStatement::column_datetime(int col)
 {
     Datetime res;
-    string dt = column_string(col);
-    sscanf(dt.c_str(), "%04hu-%02hhu-%02hhu %02hhu:%02hhu:%02hhu", &res.year,
+    const char* dt = column_string(col);
+    if (!dt)
+        return res;
+
+    // Parse the common "YYYY-MM-DD HH:MM:SS" form without going through
+    // sscanf
+    if (sqlite3_column_bytes(stm, col) == 19 && dt[4] == '-' &&
+        dt[7] == '-' && dt[10] == ' ' && dt[13] == ':' && dt[16] == ':')
+    {
+        int ye = parse_digits(dt, 4);
+        int mo = parse_digits(dt + 5, 2);
+        int da = parse_digits(dt + 8, 2);
+        int ho = parse_digits(dt + 11, 2);
+        int mi = parse_digits(dt + 14, 2);
+        int se = parse_digits(dt + 17, 2);
+        if (ye != -1 && mo != -1 && da != -1 && ho != -1 && mi != -1 &&
+            se != -1)
+        {
+            res.year   = ye;
+            res.month  = mo;
+            res.day    = da;
+            res.hour   = ho;
+            res.minute = mi;
+            res.second = se;
+            return res;
+        }
+    }
+
+    sscanf(dt, "%04hu-%02hhu-%02hhu %02hhu:%02hhu:%02hhu", &res.year,
            &res.month, &res.day, &res.hour, &res.minute, &res.second);
     return res;
 }
@@ -486,10 +584,30 @@ void SQLiteStatement::bind_val(int idx, unsigned short val)
 
 void SQLiteStatement::bind_val(int idx, const Datetime& val)
 {
-    char* buf;
-    int size = asprintf(&buf, "%04d-%02d-%02d %02d:%02d:%02d", val.year,
-                        val.month, val.day, val.hour, val.minute, val.second);
-    if (sqlite3_bind_text(stm, idx, buf, size, free) != SQLITE_OK)
+    char buf[32];
+    int size;
+    if (val.year <= 9999 && val.month <= 99 && val.day <= 99 &&
+        val.hour <= 99 && val.minute <= 99 && val.second <= 99)
+    {
+        // Format "YYYY-MM-DD HH:MM:SS" without going through printf
+        format_digits(buf, val.year, 4);
+        buf[4] = '-';
+        format_digits(buf + 5, val.month, 2);
+        buf[7] = '-';
+        format_digits(buf + 8, val.day, 2);
+        buf[10] = ' ';
+        format_digits(buf + 11, val.hour, 2);
+        buf[13] = ':';
+        format_digits(buf + 14, val.minute, 2);
+        buf[16] = ':';
+        format_digits(buf + 17, val.second, 2);
+        size = 19;
+    }
+    else
+        size = snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d",
+                        val.year, val.month, val.day, val.hour, val.minute,
+                        val.second);
+    if (sqlite3_bind_text(stm, idx, buf, size, SQLITE_TRANSIENT) != SQLITE_OK)
         throw error_sqlite(conn,
                            "cannot bind a text (from Datetime) input column");
 }
@@ -31,6 +31,24 @@ struct error_sqlite : public dballe::error_db
         WREPORT_THROWF_ATTRS(2, 3);
 };
 
+/**
+ * Tuning of an SQLite connection, selected with ?profile= in the database URL
+ */
+enum class SQLiteProfile {
+    /// Journal in memory (profile=default)
+    DEFAULT,
+    /**
+     * Write-ahead log with memory mapped I/O and a busy timeout, to let
+     * readers work while a writer is active (profile=concurrent)
+     */
+    CONCURRENT,
+    /**
+     * Journal in memory, larger cache and no syncing to disk: fast, but not
+     * safe against crashes (profile=bulk)
+     */
+    BULK,
+};
+
 /// Database connection
 class SQLiteConnection : public Connection
 {
@@ -39,6 +57,8 @@ protected:
     std::string pathname;
     /// Connection flags
     int flags   = 0;
+    /// Connection tuning profile
+    SQLiteProfile profile = SQLiteProfile::DEFAULT;
     /// Database connection
     sqlite3* db = nullptr;
     /// Marker to catch attempts to reuse connections in forked processes
@@ -101,6 +121,16 @@ public:
     /// Count the number of rows modified by the last query that was run
     int changes();
 
+    /**
+     * Checkpoint the write-ahead log, if the connection uses one, and
+     * truncate it.
+     *
+     * Waits for active readers at most for the busy timeout of the
+     * connection, and returns false if they still prevented truncating the
+     * log.
+     */
+    bool wal_checkpoint();
+
     /// Wrap sqlite3_exec, without a callback
     void exec(const std::string& query);
     void exec_nothrow(const std::string& query) noexcept;
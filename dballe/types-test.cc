@@ -64,6 +64,30 @@ void Tests::register_tests()
         wassert_throws(wreport::error_consistency,
                        Datetime::from_iso8601("2020-07-01"));
     });
+    add_method("datetime_packed", []() {
+        Datetime dt(2020, 7, 1, 12, 30, 45);
+        wassert(actual(Datetime::from_packed(dt.to_packed())) == dt);
+        Datetime missing = Datetime::from_packed(Datetime().to_packed());
+        wassert_true(missing.is_missing());
+
+        // Packed values sort like datetimes, with missing values last
+        wassert(actual(Datetime(2013, 12, 31, 23, 59, 59).to_packed()) <
+                Datetime(2014, 1, 1, 0, 0, 0).to_packed());
+        wassert(actual(Datetime(2013, 1, 1, 0, 0, 0).to_packed()) <
+                Datetime(2013, 1, 1, 0, 0, 1).to_packed());
+        wassert(actual(Datetime(9999, 12, 31, 23, 59, 60).to_packed()) <
+                Datetime().to_packed());
+        wassert(actual(Datetime(2013, 1, 1).compare(Datetime(2014, 1, 1))) <
+                0);
+        wassert(actual(Datetime(2014, 1, 1).compare(Datetime(2013, 1, 1))) >
+                0);
+        wassert(actual(Datetime(2014, 1, 1).compare(Datetime(2014, 1, 1))) ==
+                0);
+
+        std::hash<Datetime> hash;
+        wassert(actual(hash(dt)) == hash(Datetime(2020, 7, 1, 12, 30, 45)));
+    });
+
     add_method("datetime_jdays", []() {
         // Test Date to/from julian days conversion
         Date d(2015, 4, 25);
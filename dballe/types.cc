@@ -525,55 +525,27 @@ int Datetime::to_julian() const
     return Date::calendar_to_julian(year, month, day);
 }
 
-int Datetime::compare(const Datetime& o) const
-{
-    if (int res = year - o.year)
-        return res;
-    if (int res = month - o.month)
-        return res;
-    if (int res = day - o.day)
-        return res;
-    if (int res = hour - o.hour)
-        return res;
-    if (int res = minute - o.minute)
-        return res;
-    return second - o.second;
-}
-
-bool Datetime::operator==(const Datetime& o) const
-{
-    return std::tie(year, month, day, hour, minute, second) ==
-           std::tie(o.year, o.month, o.day, o.hour, o.minute, o.second);
-}
-
-bool Datetime::operator!=(const Datetime& o) const
-{
-    return std::tie(year, month, day, hour, minute, second) !=
-           std::tie(o.year, o.month, o.day, o.hour, o.minute, o.second);
-}
-
-bool Datetime::operator<(const Datetime& o) const
-{
-    return std::tie(year, month, day, hour, minute, second) <
-           std::tie(o.year, o.month, o.day, o.hour, o.minute, o.second);
-}
-
-bool Datetime::operator>(const Datetime& o) const
-{
-    return std::tie(year, month, day, hour, minute, second) >
-           std::tie(o.year, o.month, o.day, o.hour, o.minute, o.second);
-}
-
-bool Datetime::operator<=(const Datetime& o) const
-{
-    return std::tie(year, month, day, hour, minute, second) <=
-           std::tie(o.year, o.month, o.day, o.hour, o.minute, o.second);
+Datetime Datetime::from_packed(uint64_t val)
+{
+    Datetime res;
+    res.year   = (val >> 40) & 0xffff;
+    res.month  = (val >> 32) & 0xff;
+    res.day    = (val >> 24) & 0xff;
+    res.hour   = (val >> 16) & 0xff;
+    res.minute = (val >> 8) & 0xff;
+    res.second = val & 0xff;
+    return res;
 }
 
-bool Datetime::operator>=(const Datetime& o) const
+int Datetime::compare(const Datetime& o) const
 {
-    return std::tie(year, month, day, hour, minute, second) >=
-           std::tie(o.year, o.month, o.day, o.hour, o.minute, o.second);
+    uint64_t a = to_packed();
+    uint64_t b = o.to_packed();
+    if (a < b)
+        return -1;
+    if (a > b)
+        return 1;
+    return 0;
 }
 
 Datetime Datetime::from_iso8601(const char* str)
@@ -1955,6 +1927,12 @@ size_t hash<dballe::Trange>::operator()(dballe::Trange const& o) const noexcept
     return res;
 }
 
+size_t
+hash<dballe::Datetime>::operator()(dballe::Datetime const& o) const noexcept
+{
+    return hash<uint64_t>()(o.to_packed());
+}
+
 size_t hash<dballe::Coords>::operator()(dballe::Coords const& o) const noexcept
 {
     return o.lat xor o.lon;
@@ -5,6 +5,7 @@
  * Common base types used by most of DB-All.e code.
  */
 
+#include <cstdint>
 #include <dballe/fwd.h>
 #include <functional>
 #include <iosfwd>
@@ -215,6 +216,22 @@ struct Datetime
     /// Convert the date to Julian day
     int to_julian() const;
 
+    /**
+     * Encode the datetime in a single integer, which sorts in the same order
+     * as the datetime.
+     *
+     * The missing datetime is encoded as a value higher than all others.
+     */
+    uint64_t to_packed() const
+    {
+        return ((uint64_t)year << 40) | ((uint64_t)month << 32) |
+               ((uint64_t)day << 24) | ((uint64_t)hour << 16) |
+               ((uint64_t)minute << 8) | (uint64_t)second;
+    }
+
+    /// Decode a datetime encoded with to_packed()
+    static Datetime from_packed(uint64_t val);
+
     /**
      * Generic comparison
      *
@@ -224,12 +241,30 @@ struct Datetime
      */
     int compare(const Datetime& other) const;
 
-    bool operator==(const Datetime& o) const;
-    bool operator!=(const Datetime& o) const;
-    bool operator<(const Datetime& o) const;
-    bool operator>(const Datetime& o) const;
-    bool operator<=(const Datetime& o) const;
-    bool operator>=(const Datetime& o) const;
+    bool operator==(const Datetime& o) const
+    {
+        return to_packed() == o.to_packed();
+    }
+    bool operator!=(const Datetime& o) const
+    {
+        return to_packed() != o.to_packed();
+    }
+    bool operator<(const Datetime& o) const
+    {
+        return to_packed() < o.to_packed();
+    }
+    bool operator>(const Datetime& o) const
+    {
+        return to_packed() > o.to_packed();
+    }
+    bool operator<=(const Datetime& o) const
+    {
+        return to_packed() <= o.to_packed();
+    }
+    bool operator>=(const Datetime& o) const
+    {
+        return to_packed() >= o.to_packed();
+    }
 
     /**
      * Print to an output stream in ISO8601 combined format.
@@ -1013,6 +1048,13 @@ template <> struct hash<dballe::Trange>
     result_type operator()(argument_type const& o) const noexcept;
 };
 
+template <> struct hash<dballe::Datetime>
+{
+    typedef dballe::Datetime argument_type;
+    typedef size_t result_type;
+    result_type operator()(argument_type const& o) const noexcept;
+};
+
 template <> struct hash<dballe::Coords>
 {
     typedef dballe::Coords argument_type;
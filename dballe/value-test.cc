@@ -1,5 +1,6 @@
 #include "core/tests.h"
 #include "value.h"
+#include "var.h"
 
 using namespace std;
 using namespace wreport::tests;
@@ -18,6 +19,41 @@ void Tests::register_tests()
 {
 
     add_method("empty", []() noexcept {});
+
+    add_method("inline", []() {
+        Value val(var(WR_VAR(0, 12, 101), 280.23));
+        wassert(actual(val.code()) == WR_VAR(0, 12, 101));
+        wassert(actual(val->enqd()) == 280.23);
+
+        // Copies are independent
+        Value copy(val);
+        copy->setd(281.0);
+        wassert(actual(val->enqd()) == 280.23);
+        wassert_false(copy == val);
+
+        // Moving leaves the source empty
+        Value moved(std::move(copy));
+        wassert_false(copy.get());
+        wassert(actual(moved->enqd()) == 281.0);
+
+        // Strings and attributes are preserved
+        DBValue sval(12, var(WR_VAR(0, 1, 19), "test"));
+        sval->seta(newvar(WR_VAR(0, 33, 7), 50));
+        DBValue scopy;
+        scopy = sval;
+        wassert(actual(scopy.data_id) == 12);
+        wassert(actual(scopy->enqs()) == "test");
+        wassert(actual(scopy->enqa(WR_VAR(0, 33, 7))->enqi()) == 50);
+
+        // Converting to and from heap variables
+        auto released = scopy.release();
+        wassert_false(scopy.get());
+        wassert(actual(released->enqs()) == "test");
+        scopy.reset(std::move(released));
+        wassert(actual(scopy->enqs()) == "test");
+        scopy.reset(std::unique_ptr<wreport::Var>());
+        wassert_false(scopy.get());
+    });
 }
 
 } // namespace
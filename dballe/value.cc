@@ -5,37 +5,32 @@
 
 namespace dballe {
 
-Value::Value(const Value& o)
-    : m_var(o.m_var ? new wreport::Var(*o.m_var) : nullptr)
+Value::Value(Value&& o) noexcept : m_var(std::move(o.m_var))
 {
+    o.m_var.reset();
 }
 
-Value::Value(const wreport::Var& var) : m_var(new wreport::Var(var)) {}
-
-Value::~Value() { delete m_var; }
-
-Value& Value::operator=(const Value& o)
+Value::Value(std::unique_ptr<wreport::Var>&& var)
 {
-    if (this == &o)
-        return *this;
-    delete m_var;
-    m_var = o.m_var ? new wreport::Var(*o.m_var) : nullptr;
-    return *this;
+    if (var)
+        m_var.emplace(std::move(*var));
+    var.reset();
 }
 
-Value& Value::operator=(Value&& o)
+Value::~Value() {}
+
+Value& Value::operator=(Value&& o) noexcept
 {
     if (this == &o)
         return *this;
-    delete m_var;
-    m_var   = o.m_var;
-    o.m_var = nullptr;
+    m_var = std::move(o.m_var);
+    o.m_var.reset();
     return *this;
 }
 
 bool Value::operator==(const Value& o) const
 {
-    if (m_var == o.m_var)
+    if (!m_var && !o.m_var)
         return true;
     if (!m_var || !o.m_var)
         return false;
@@ -44,7 +39,7 @@ bool Value::operator==(const Value& o) const
 
 bool Value::operator!=(const Value& o) const
 {
-    if (m_var == o.m_var)
+    if (!m_var && !o.m_var)
         return false;
     if (!m_var || !o.m_var)
         return true;
@@ -61,22 +56,25 @@ void Value::print(FILE* out) const
 
 wreport::Varcode Value::code() const { return m_var ? m_var->code() : 0; }
 
-void Value::reset(const wreport::Var& var)
-{
-    delete m_var;
-    m_var = new wreport::Var(var);
-}
+void Value::reset(const wreport::Var& var) { m_var.emplace(var); }
+
+void Value::reset(wreport::Var&& var) { m_var.emplace(std::move(var)); }
 
 void Value::reset(std::unique_ptr<wreport::Var>&& var)
 {
-    delete m_var;
-    m_var = var.release();
+    if (var)
+        m_var.emplace(std::move(*var));
+    else
+        m_var.reset();
+    var.reset();
 }
 
 std::unique_ptr<wreport::Var> Value::release()
 {
-    std::unique_ptr<wreport::Var> res(m_var);
-    m_var = nullptr;
+    if (!m_var)
+        return std::unique_ptr<wreport::Var>();
+    std::unique_ptr<wreport::Var> res(new wreport::Var(std::move(*m_var)));
+    m_var.reset();
     return res;
 }
 
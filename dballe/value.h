@@ -4,46 +4,53 @@
 #include <dballe/fwd.h>
 #include <iosfwd>
 #include <memory>
-#include <wreport/varinfo.h>
-
-namespace wreport {
-struct Var;
-}
+#include <optional>
+#include <wreport/var.h>
 
 namespace dballe {
 
 /**
- * Container for a wreport::Var pointer
+ * Container for a wreport::Var
+ *
+ * The variable is stored inline, so that numeric values without attributes
+ * need no memory allocation. Strings and attributes are still allocated by
+ * wreport::Var itself.
+ *
+ * Pointers and references to the variable are invalidated when the Value is
+ * moved, as it happens for example when a Values grows.
  */
 class Value
 {
 protected:
-    wreport::Var* m_var = nullptr;
+    std::optional<wreport::Var> m_var;
 
 public:
-    Value() = default;
-    Value(const Value& o);
-    Value(Value&& o) : m_var(o.m_var) { o.m_var = nullptr; }
+    Value()               = default;
+    Value(const Value& o) = default;
+    Value(Value&& o) noexcept;
 
     /// Construct from a wreport::Var
-    Value(const wreport::Var& var);
+    Value(const wreport::Var& var) : m_var(var) {}
+
+    /// Construct from a wreport::Var, moving its contents
+    Value(wreport::Var&& var) : m_var(std::move(var)) {}
 
     /// Construct from a wreport::Var, taking ownership of it
-    Value(std::unique_ptr<wreport::Var>&& var) : m_var(var.release()) {}
+    Value(std::unique_ptr<wreport::Var>&& var);
 
     ~Value();
 
-    Value& operator=(const Value& o);
-    Value& operator=(Value&& o);
+    Value& operator=(const Value& o) = default;
+    Value& operator=(Value&& o) noexcept;
 
     bool operator==(const Value& o) const;
     bool operator!=(const Value& o) const;
 
-    const wreport::Var* get() const { return m_var; }
-    wreport::Var* get() { return m_var; }
+    const wreport::Var* get() const { return m_var ? &*m_var : nullptr; }
+    wreport::Var* get() { return m_var ? &*m_var : nullptr; }
 
-    const wreport::Var* operator->() const { return m_var; }
-    wreport::Var* operator->() { return m_var; }
+    const wreport::Var* operator->() const { return &*m_var; }
+    wreport::Var* operator->() { return &*m_var; }
 
     const wreport::Var& operator*() const { return *m_var; }
     wreport::Var& operator*() { return *m_var; }
@@ -54,6 +61,9 @@ public:
     /// Fill from a wreport::Var
     void reset(const wreport::Var& var);
 
+    /// Fill from a wreport::Var, moving its contents
+    void reset(wreport::Var&& var);
+
     /// Fill from a wreport::Var, taking ownership of it
     void reset(std::unique_ptr<wreport::Var>&& var);
 
@@ -83,6 +93,12 @@ struct DBValue : public Value
     {
     }
 
+    /// Construct from a wreport::Var, moving its contents
+    DBValue(int data_id, wreport::Var&& var)
+        : Value(std::move(var)), data_id(data_id)
+    {
+    }
+
     /// Construct from a wreport::Var, taking ownership of it
     DBValue(int data_id, std::unique_ptr<wreport::Var>&& var)
         : Value(std::move(var)), data_id(data_id)
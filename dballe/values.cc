@@ -114,6 +114,15 @@ template <typename Value> void ValuesBase<Value>::set(const wreport::Var& v)
         i->reset(v);
 }
 
+template <typename Value> void ValuesBase<Value>::set(wreport::Var&& v)
+{
+    auto i = find(v.code());
+    if (i == end())
+        insert_new(Value(std::move(v)));
+    else
+        i->reset(std::move(v));
+}
+
 template <typename Value>
 void ValuesBase<Value>::set(std::unique_ptr<wreport::Var>&& v)
 {
@@ -139,7 +148,7 @@ void ValuesBase<Value>::merge(ValuesBase<Value>&& vals)
         operator=(std::move(vals));
     else
     {
-        for (const auto& vi : vals)
+        for (auto& vi : vals)
             set(std::move(*vi));
         vals.clear();
     }
@@ -284,9 +293,10 @@ Values::Values(DBValues&& o)
 {
     clear();
     reserve(o.size());
-    o.move_to([&](std::unique_ptr<wreport::Var> var) {
-        m_values.emplace_back(std::move(var));
-    });
+    for (auto& val : o)
+        if (Var* var = val.get())
+            m_values.emplace_back(std::move(*var));
+    o.clear();
 }
 
 Values& Values::operator=(const DBValues& o)
@@ -303,9 +313,10 @@ Values& Values::operator=(DBValues&& o)
 {
     clear();
     reserve(o.size());
-    o.move_to([&](std::unique_ptr<wreport::Var> var) {
-        m_values.emplace_back(std::move(var));
-    });
+    for (auto& val : o)
+        if (Var* var = val.get())
+            m_values.emplace_back(std::move(*var));
+    o.clear();
     return *this;
 }
 
@@ -322,9 +333,10 @@ DBValues::DBValues(Values&& o)
 {
     clear();
     reserve(o.size());
-    o.move_to([&](std::unique_ptr<wreport::Var> var) {
-        m_values.emplace_back(std::move(var));
-    });
+    for (auto& val : o)
+        if (Var* var = val.get())
+            m_values.emplace_back(std::move(*var));
+    o.clear();
 }
 
 DBValues& DBValues::operator=(const Values& o)
@@ -341,9 +353,10 @@ DBValues& DBValues::operator=(Values&& o)
 {
     clear();
     reserve(o.size());
-    o.move_to([&](std::unique_ptr<wreport::Var> var) {
-        m_values.emplace_back(std::move(var));
-    });
+    for (auto& val : o)
+        if (Var* var = val.get())
+            m_values.emplace_back(std::move(*var));
+    o.clear();
     return *this;
 }
 
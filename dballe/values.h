@@ -54,6 +54,9 @@ public:
     /// Set from a wreport::Var
     void set(const wreport::Var&);
 
+    /// Set from a wreport::Var, moving its contents
+    void set(wreport::Var&&);
+
     /// Set from a wreport::Var, taking ownership of it
     void set(std::unique_ptr<wreport::Var>&&);
 
@@ -72,13 +75,13 @@ public:
     /// Set a variable value, creating it if it does not exist
     template <typename C, typename T> void set(const C& code, const T& val)
     {
-        this->set(newvar(code, val));
+        this->set(dballe::var(code, val));
     }
 
     template <typename C, typename T> void setf(const C& code, const T& val)
     {
-        auto var = newvar(code);
-        var->setf(val);
+        auto var = dballe::var(code);
+        var.setf(val);
         this->set(std::move(var));
     }
 
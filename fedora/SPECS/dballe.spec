@@ -79,7 +79,7 @@ Requires: %{name}-common = %{?epoch:%epoch:}%{version}-%{release}
 %package  -n libdballe-devel
 Summary:  DB-ALL.e core C development library
 Group:    Applications/Meteo
-Requires: libdballe9 = %{?epoch:%epoch:}%{version}-%{release}
+Requires: libdballe10 = %{?epoch:%epoch:}%{version}-%{release}
 Requires: popt-devel
 Requires: postgresql-devel
 Requires: mariadb-devel
@@ -123,14 +123,14 @@ Group: Applications/Meteo
  This is the documentation for the core DB_All.e development library.
 
 
-%package  -n libdballe9
+%package  -n libdballe10
 Summary:   DB-ALL.e core shared library
 Group:    Applications/Meteo
 Requires: %{name}-common >= %{?epoch:%epoch:}%{version}-%{release}
 Requires: pkgconfig(libwreport) >= 3.41
 Obsoletes: libdballe6 < 8.21
 
-%description -n libdballe9
+%description -n libdballe10
 DB-ALL.e C shared library
  DB-All.e is a fast on-disk database where meteorological observed and
  forecast data can be stored, searched, retrieved and updated.
@@ -158,7 +158,7 @@ Requires: libdballe-devel = %{?epoch:%epoch:}%{version}-%{release}
 Summary:  DB-ALL.e Fortran shared library
 Group:    Applications/Meteo
 Requires: %{name}-common >= %{?epoch:%epoch:}%{version}-%{release}
-Requires: libdballe9 = %{?epoch:%epoch:}%{version}-%{release}
+Requires: libdballe10 = %{?epoch:%epoch:}%{version}-%{release}
 Provides: lidballef4 = %{?epoch:%epoch:}%{version}-%{release}
 Obsoletes: libdballef4 < 8.21
 
@@ -233,7 +233,7 @@ mv $RPM_BUILD_ROOT%{_includedir}/dballe/dballef.mod $RPM_BUILD_ROOT%{_fmoddir}
 %{_datadir}/wreport/dballe.txt
 %{_datadir}/wreport/repinfo.csv
 
-%files -n libdballe9
+%files -n libdballe10
 %defattr(-,root,root,-)
 %{_libdir}/libdballe.so.*
 
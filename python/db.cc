@@ -177,13 +177,20 @@ struct insert_data : MethKwargs<insert_data<Impl>, Impl>
     constexpr static const char* name = "insert_data";
     constexpr static const char* signature =
         "record: Union[Dict[str, Any], dballe.Cursor, dballe.Data], "
-        "can_replace: bool=False, can_add_stations: bool=False";
-    constexpr static const char* returns = "Dict[str, int]";
+        "can_replace: bool=False, can_add_stations: bool=False, "
+        "defer: bool=False";
+    constexpr static const char* returns = "Optional[Dict[str, int]]";
     constexpr static const char* summary = "Insert data values in the database";
     constexpr static const char* doc     = R"(
 The return value is a dict that always contains `ana_id` mapped to the station
 ID just inserted, and an entry for each varcode inserted mapping to the
 database ID of its value.
+
+If `defer` is True, the values can be queued and written later together with
+those of the following calls, which is faster when inserting many records one
+at a time. In that case the return value is None, since the IDs may not be
+known yet. Queued values are written before any other operation on the
+transaction, and when the transaction is committed.
 )";
     static PyObject* run(Impl* self, PyObject* args, PyObject* kw)
     {
@@ -191,13 +198,14 @@ database ID of its value.
             return nullptr;
 
         static const char* kwlist[] = {"data", "can_replace",
-                                       "can_add_stations", NULL};
+                                       "can_add_stations", "defer", NULL};
         PyObject* pydata;
         int can_replace      = 0;
         int can_add_stations = 0;
-        if (!PyArg_ParseTupleAndKeywords(args, kw, "O|ii",
-                                         const_cast<char**>(kwlist), &pydata,
-                                         &can_replace, &can_add_stations))
+        int defer            = 0;
+        if (!PyArg_ParseTupleAndKeywords(
+                args, kw, "O|iii", const_cast<char**>(kwlist), &pydata,
+                &can_replace, &can_add_stations, &defer))
             return nullptr;
 
         try
@@ -207,8 +215,11 @@ database ID of its value.
             impl::DBInsertOptions opts;
             opts.can_replace      = can_replace;
             opts.can_add_stations = can_add_stations;
+            opts.defer            = defer;
             self->db->insert_data(*data, opts);
             gil.lock();
+            if (defer)
+                Py_RETURN_NONE;
             return get_insert_ids(*data);
         }
         DBALLE_CATCH_RETURN_PYO
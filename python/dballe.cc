@@ -14,6 +14,7 @@
 #include "message.h"
 #include "types.h"
 #include "utils/wreport.h"
+#include "volnd.h"
 #include <wreport/python.h>
 
 using namespace std;
@@ -209,6 +210,7 @@ PyMODINIT_FUNC PyInit__dballe(void)
         register_db(m);
         register_cursor(m);
         register_explorer(m);
+        register_volnd(m);
 
         // Create a Capsule containing the API struct's address
         pyo_unique_ptr c_api_object(throw_ifnull(
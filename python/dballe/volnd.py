@@ -38,6 +38,7 @@ This example code extracts temperatures in a station by datetime matrix::
 # TODO: leggere i dati di anagrafica
 
 import dballe
+import _dballe
 from collections import namedtuple
 import datetime
 import sys
@@ -169,6 +170,13 @@ class ListIndex(Index, list):
             self.append(self.details_from_record(rec))
         return pos
 
+    def _append_native(self, key, details):
+        """
+        Append an entry found by the native indexing code of read()
+        """
+        self._map[key] = len(self)
+        self.append(details)
+
 
 class AnaIndexEntry(namedtuple("AnaIndexEntry", ("id", "lat", "lon", "ident"))):
     """
@@ -215,6 +223,9 @@ class AnaIndex(ListIndex):
     def _splitInit(self, el):
         return el[0], el
 
+    def _append_native(self, key, details):
+        super(AnaIndex, self)._append_native(key, AnaIndexEntry(*details))
+
     def short_name(self):
         return "AnaIndex["+str(len(self))+"]"
 
@@ -580,16 +591,23 @@ class Data:
 
         shape = tuple(len(x) for x in self.dims)
 
+        # Values collected by the native code of read() fill the arrays
+        # themselves
+        native = isinstance(self.vals, _dballe._VolndValues)
+
         # Create the data array, with all values set as missing
         # print "volnd finalise instantiate"
         if self.info.type == "string":
             # print self.info, "string"
             a = numpy.empty(shape, dtype=object)
             # Fill the array with all the values, at the given indexes
-            for pos, val in self.vals:
-                if self._checkConflicts and a[pos] is not None:
-                    raise IndexError("Got more than one value for " + self.name + " at position " + str(pos))
-                a[pos] = val
+            if native:
+                self.vals.fill(a, None, self._checkConflicts)
+            else:
+                for pos, val in self.vals:
+                    if self._checkConflicts and a[pos] is not None:
+                        raise IndexError("Got more than one value for " + self.name + " at position " + str(pos))
+                    a[pos] = val
         else:
             if self.info.type == "integer":
                 a = self._instantiateIntMatrix()
@@ -598,11 +616,14 @@ class Data:
             mask = numpy.ones(shape, dtype=bool)
 
             # Fill the array with all the values, at the given indexes
-            for pos, val in self.vals:
-                if self._checkConflicts and not mask[pos]:
-                    raise IndexError("Got more than one value for " + self.name + " at position " + str(pos))
-                a[pos] = val.enqd()
-                mask[pos] = False
+            if native:
+                self.vals.fill(a, mask, self._checkConflicts)
+            else:
+                for pos, val in self.vals:
+                    if self._checkConflicts and not mask[pos]:
+                        raise IndexError("Got more than one value for " + self.name + " at position " + str(pos))
+                    a[pos] = val.enqd()
+                    mask[pos] = False
             a = ma.array(a, mask=mask)
 
         # Replace the intermediate data with the results
@@ -626,6 +647,35 @@ class Data:
         return "Data("+", ".join(x.short_name() for x in self.dims)+"):"+self.vals.__repr__()
 
 
+# Indices that read() can handle in native code, with their kind
+_native_kinds = {
+    AnaIndex: "ana",
+    NetworkIndex: "network",
+    LevelIndex: "level",
+    TimeRangeIndex: "trange",
+    DateTimeIndex: "datetime",
+}
+
+
+def _read_native(cursor, dims, kinds, filter, checkConflicts, attributes):
+    """
+    Implementation of read() that indexes the cursor in native code, and
+    fills the arrays directly from the collected values
+    """
+    vars = {}
+    collected = _dballe._volnd_read(cursor, dims, kinds, filter=filter,
+                                    attributes=attributes)
+    for code, (var_dims, values, attrs) in collected.items():
+        var = Data(code, var_dims, checkConflicts)
+        var.vals = values
+        for acode, avalues in attrs.items():
+            data = Data(code, var_dims, False)
+            data.vals = avalues
+            var.attrs[acode] = data
+        vars[code] = var
+    return vars
+
+
 def read(cursor, dims, filter=None, checkConflicts=True, attributes=None):
     """
     *cursor* is a dballe.Cursor resulting from a dballe query
@@ -645,6 +695,34 @@ def read(cursor, dims, filter=None, checkConflicts=True, attributes=None):
     if it is a sequence, then it is the sequence of attributes that should
     be read.
     """
+    # Index the cursor in native code unless there are custom indices
+    kinds = [_native_kinds.get(type(d)) for d in dims]
+    native = None not in kinds and isinstance(
+            cursor, (dballe.CursorData, dballe.CursorDataDB))
+
+    if native:
+        vars = _read_native(cursor, dims, kinds, filter, checkConflicts,
+                            attributes)
+    else:
+        vars = _read_python(cursor, dims, filter, checkConflicts, attributes)
+
+    # Now that we have collected all the values, create the arrays
+    #print "volnd finalise"
+    invalid = []
+    for k, var in vars.items():
+        if not var.finalise():
+            invalid.append(k)
+    for k in invalid:
+        del vars[k]
+
+    return vars
+
+
+def _read_python(cursor, dims, filter, checkConflicts, attributes):
+    """
+    Implementation of read() that indexes the cursor in Python, used for
+    custom indices
+    """
     vars = {}
     # Iterate results
     for rec in cursor:
@@ -676,14 +754,4 @@ def read(cursor, dims, filter=None, checkConflicts=True, attributes=None):
             else:
                 var.appendAttrs(arec, attributes)
 
-
-    # Now that we have collected all the values, create the arrays
-    #print "volnd finalise"
-    invalid = []
-    for k, var in vars.items():
-        if not var.finalise():
-            invalid.append(k)
-    for k in invalid:
-        del vars[k]
-
     return vars
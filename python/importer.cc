@@ -208,7 +208,7 @@ using a uniform data model.
 Note that one binary message is often decoded to multiple data messages, in
 case, for example, of compressed BUFR files.
 
-Constructor: Importer(encoding: str, simplified: bool=True, domain_errors="raise")
+Constructor: Importer(encoding: str, simplified: bool=True, domain_errors="raise", jobs: int=1)
 
 :arg encoding: can be :code:`"BUFR"` or :code:`"CREX"`.
 :arg simplified: controls whether messages are constructed using standard levels and
@@ -224,6 +224,8 @@ Constructor: Importer(encoding: str, simplified: bool=True, domain_errors="raise
                     changes the value to the nearest valid extreme of the
                     domain. "tag" changes the value to the nearest valid
                     extreme of the domain and sets attribute B33192=0
+:arg jobs: number of threads used to interpret the subsets of BUFR and CREX
+           messages. Messages are returned in the order of their subsets
 
 When a message is imported in simplified mode, the actual context information
 will be stored as data attributes.
@@ -256,13 +258,14 @@ Example usage::
     static int _init(Impl* self, PyObject* args, PyObject* kw)
     {
         static const char* kwlist[] = {"encoding", "simplified",
-                                       "domain_errors", nullptr};
+                                       "domain_errors", "jobs", nullptr};
         const char* encoding        = nullptr;
         int simplified              = -1;
         const char* domain_errors   = "raise";
-        if (!PyArg_ParseTupleAndKeywords(args, kw, "s|ps",
-                                         const_cast<char**>(kwlist), &encoding,
-                                         &simplified, &domain_errors))
+        int jobs                    = 1;
+        if (!PyArg_ParseTupleAndKeywords(
+                args, kw, "s|psi", const_cast<char**>(kwlist), &encoding,
+                &simplified, &domain_errors, &jobs))
             return -1;
 
         try
@@ -290,6 +293,13 @@ Example usage::
                     domain_errors);
                 throw PythonException();
             }
+            if (jobs < 1)
+            {
+                PyErr_Format(PyExc_ValueError,
+                             "jobs argument must be at least 1, got %d", jobs);
+                throw PythonException();
+            }
+            opts.jobs = jobs;
             self->importer =
                 Importer::create(File::parse_encoding(encoding), opts)
                     .release();
@@ -846,6 +846,22 @@ class CommonDBTestMixin(DballeDBMixin):
                 })
             self.assertEqual(str(e.exception), "'station not found in the database'")
 
+    def test_insert_deferred(self):
+        with self.transaction() as tr:
+            for hour in range(3):
+                ids = tr.insert_data({
+                    "report": "synop",
+                    "lat": 44.5, "lon": 11.4,
+                    "level": dballe.Level(1),
+                    "trange": dballe.Trange(254),
+                    "datetime": datetime.datetime(2013, 4, 25, hour, 0, 0),
+                    "B12101": 22.4 + hour,
+                }, can_add_stations=True, defer=True)
+                self.assertIsNone(ids)
+
+            values = [cur["B12101"].enqd() for cur in tr.query_data({"rep_memo": "synop", "var": "B12101"})]
+            self.assertEqual(values, [22.4, 23.4, 24.4])
+
     def test_cursor_delete(self):
         # See: #140
         with self.transaction() as tr:
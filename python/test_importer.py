@@ -151,3 +151,17 @@ class TestImporter(MessageTestMixin, unittest.TestCase):
         a = val.enqa("B33192")
         self.assertTrue(a)
         self.assertEqual(a.enqi(), 0)
+
+    def test_jobs(self):
+        pathname = test_pathname("bufr/synop-longname.bufr")
+        with dballe.File(pathname) as f:
+            binmsg = next(f)
+
+        with self.assertRaises(ValueError):
+            dballe.Importer("BUFR", jobs=0)
+
+        msgs1 = dballe.Importer("BUFR").from_binary(binmsg)
+        msgs2 = dballe.Importer("BUFR", jobs=3).from_binary(binmsg)
+        self.assertEqual(len(msgs1), 7)
+        self.assertEqual([m.ident for m in msgs2], [m.ident for m in msgs1])
+        self.assertEqual([m.coords for m in msgs2], [m.coords for m in msgs1])
@@ -280,6 +280,34 @@ class ReadMixin(DballeDBMixin):
             self.assertEqual([x for x in data.vals.mask[:, netidx].flat], [x for x in a.vals.mask[:, netidx].flat])
             self.assertEqual(round(ma.average(a.vals)), 54)
 
+    def testNativeMatchesPython(self):
+        # Subclasses of the builtin indices are indexed in Python: the result
+        # should be the same as with the native implementation
+        class PyAnaIndex(AnaIndex):
+            pass
+
+        class PyNetworkIndex(NetworkIndex):
+            pass
+
+        with self.db.transaction() as tr:
+            query = dict(datetime=datetime.datetime(2007, 1, 1, 0, 0, 0))
+            native = read(tr.query_data(query), (AnaIndex(), NetworkIndex()),
+                          checkConflicts=False, attributes=True)
+            python = read(tr.query_data(query), (PyAnaIndex(), PyNetworkIndex()),
+                          checkConflicts=False, attributes=True)
+
+        self.assertEqual(sorted(native.keys()), sorted(python.keys()))
+        for code, data in native.items():
+            other = python[code]
+            self.assertEqual(list(data.dims[0]), list(other.dims[0]))
+            self.assertEqual(list(data.dims[1]), list(other.dims[1]))
+            self.assertEqual(data.vals.dtype, other.vals.dtype)
+            self.assertEqual(data.vals.mask.tolist(), other.vals.mask.tolist())
+            self.assertEqual(data.vals.tolist(), other.vals.tolist())
+            self.assertEqual(sorted(data.attrs.keys()), sorted(other.attrs.keys()))
+            for acode, adata in data.attrs.items():
+                self.assertEqual(adata.vals.tolist(), other.attrs[acode].vals.tolist())
+
     def testEmptyExport(self):
         with self.db.transaction() as tr:
             query = {}
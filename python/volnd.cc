@@ -0,0 +1,823 @@
+#include "volnd.h"
+#include "common.h"
+#include "cursor.h"
+#include "dballe/cursor.h"
+#include "dballe/db/v7/cursor.h"
+#include "types.h"
+#include "utils/type.h"
+#include "utils/values.h"
+#include "utils/wreport.h"
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace dballe;
+using namespace dballe::python;
+using namespace wreport;
+
+extern "C" {
+PyTypeObject* dpy_VolndValues_Type = nullptr;
+}
+
+namespace dballe {
+namespace python {
+namespace volnd {
+
+namespace {
+
+/// Py_buffer acquired for writing, released on destruction
+struct WritableBuffer : public Py_buffer
+{
+    explicit WritableBuffer(PyObject* o)
+    {
+        if (PyObject_GetBuffer(o, this, PyBUF_RECORDS) == -1)
+            throw PythonException();
+    }
+    WritableBuffer(const WritableBuffer&)            = delete;
+    WritableBuffer& operator=(const WritableBuffer&) = delete;
+    ~WritableBuffer() { PyBuffer_Release(this); }
+
+    /// Format character of the buffer items, ignoring native byte order marks
+    char format_char() const
+    {
+        const char* fmt = format ? format : "B";
+        if (*fmt == '@' || *fmt == '=')
+            ++fmt;
+        if (!fmt[0] || fmt[1])
+            return 0;
+        return fmt[0];
+    }
+};
+
+typedef void (*store_func)(char* dest, double val);
+
+template <typename T> void store_number(char* dest, double val)
+{
+    T v = static_cast<T>(val);
+    memcpy(dest, &v, sizeof(T));
+}
+
+/// Choose how to store numbers in an array, based on its item format
+store_func store_for(const WritableBuffer& buf)
+{
+    switch (buf.format_char())
+    {
+        case 'b':
+        case 'h':
+        case 'i':
+        case 'l':
+        case 'q':
+            switch (buf.itemsize)
+            {
+                case 1: return store_number<int8_t>;
+                case 2: return store_number<int16_t>;
+                case 4: return store_number<int32_t>;
+                case 8: return store_number<int64_t>;
+            }
+            break;
+        case 'B':
+        case 'H':
+        case 'I':
+        case 'L':
+        case 'Q':
+            switch (buf.itemsize)
+            {
+                case 1: return store_number<uint8_t>;
+                case 2: return store_number<uint16_t>;
+                case 4: return store_number<uint32_t>;
+                case 8: return store_number<uint64_t>;
+            }
+            break;
+        case 'f':
+            if (buf.itemsize == sizeof(float))
+                return store_number<float>;
+            break;
+        case 'd':
+            if (buf.itemsize == sizeof(double))
+                return store_number<double>;
+            break;
+    }
+    PyErr_Format(PyExc_TypeError, "cannot store numbers in an array of '%s'",
+                 buf.format ? buf.format : "B");
+    throw PythonException();
+}
+
+} // namespace
+
+/**
+ * Values collected for a variable or for one of its attributes, together with
+ * their position in the output matrix
+ */
+struct Values
+{
+    /// Name of the variable, used in error messages
+    std::string name;
+    /// Number of dimensions of the output matrix
+    unsigned ndim;
+    /// If true, store wreport.Var objects instead of numbers
+    bool objects;
+    /// Number of values collected
+    size_t count = 0;
+    /// Positions of all values, ndim items per value
+    std::vector<unsigned> positions;
+    /// Numeric values, when objects is false
+    std::vector<double> numbers;
+    /// wreport.Var objects, when objects is true
+    std::vector<PyObject*> vars;
+
+    Values(const std::string& name, unsigned ndim, bool objects)
+        : name(name), ndim(ndim), objects(objects)
+    {
+    }
+    Values(const Values&)            = delete;
+    Values& operator=(const Values&) = delete;
+    ~Values()
+    {
+        for (auto o : vars)
+            Py_DECREF(o);
+    }
+
+    void append(const unsigned* pos, const wreport::Var& var)
+    {
+        positions.insert(positions.end(), pos, pos + ndim);
+        if (objects)
+            vars.push_back(wreport_api.var_create(var));
+        else
+            numbers.push_back(var.enqd());
+        ++count;
+    }
+
+    void append(const unsigned* pos, PyObject* var)
+    {
+        if (!objects)
+            return append(pos, wreport_api.var(var));
+        positions.insert(positions.end(), pos, pos + ndim);
+        Py_INCREF(var);
+        vars.push_back(var);
+        ++count;
+    }
+
+    /// Return the position of the value at index idx as a Python tuple
+    PyObject* position_to_python(size_t idx) const
+    {
+        pyo_unique_ptr res(throw_ifnull(PyTuple_New(ndim)));
+        for (unsigned i = 0; i < ndim; ++i)
+        {
+            unsigned pos = positions[idx * ndim + i];
+            PyTuple_SET_ITEM(res.get(), i,
+                             throw_ifnull(PyLong_FromUnsignedLong(pos)));
+        }
+        return res.release();
+    }
+
+    [[noreturn]] void throw_conflict(size_t idx) const
+    {
+        pyo_unique_ptr pos(position_to_python(idx));
+        PyErr_Format(PyExc_IndexError,
+                     "Got more than one value for %s at position %S",
+                     name.c_str(), pos.get());
+        throw PythonException();
+    }
+
+    /// Compute the byte offset of the value at index idx in buf
+    Py_ssize_t offset(const Py_buffer& buf, size_t idx) const
+    {
+        Py_ssize_t res = 0;
+        for (unsigned i = 0; i < ndim; ++i)
+        {
+            unsigned pos = positions[idx * ndim + i];
+            if ((Py_ssize_t)pos >= buf.shape[i])
+            {
+                PyErr_Format(PyExc_IndexError,
+                             "position %u is out of bounds for dimension %u "
+                             "of size %zd",
+                             pos, i, buf.shape[i]);
+                throw PythonException();
+            }
+            res += pos * buf.strides[i];
+        }
+        return res;
+    }
+
+    /**
+     * Store numbers in array, and set to false their corresponding elements
+     * in mask
+     */
+    void fill_numbers(PyObject* array, PyObject* mask, bool check_conflicts)
+    {
+        WritableBuffer a(array);
+        WritableBuffer m(mask);
+        if ((unsigned)a.ndim != ndim || (unsigned)m.ndim != ndim)
+        {
+            PyErr_Format(PyExc_ValueError,
+                         "array and mask should have %u dimensions", ndim);
+            throw PythonException();
+        }
+        if (m.format_char() != '?' || m.itemsize != 1)
+        {
+            PyErr_SetString(PyExc_TypeError, "mask should be a bool array");
+            throw PythonException();
+        }
+        store_func store = store_for(a);
+        for (size_t i = 0; i < count; ++i)
+        {
+            char* dest      = (char*)a.buf + offset(a, i);
+            char* dest_mask = (char*)m.buf + offset(m, i);
+            if (check_conflicts && !*dest_mask)
+                throw_conflict(i);
+            store(dest, numbers[i]);
+            *dest_mask = 0;
+        }
+    }
+
+    /// Store wreport.Var objects in an array of objects
+    void fill_objects(PyObject* array, bool check_conflicts)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            pyo_unique_ptr pos(position_to_python(i));
+            if (check_conflicts)
+            {
+                pyo_unique_ptr old(throw_ifnull(PyObject_GetItem(array, pos)));
+                if (old.get() != Py_None)
+                    throw_conflict(i);
+            }
+            if (PyObject_SetItem(array, pos, vars[i]) == -1)
+                throw PythonException();
+        }
+    }
+};
+
+namespace {
+
+/// Contents of the current cursor row, as used by indices
+struct Row
+{
+    DBStation station;
+    Level level;
+    Trange trange;
+    Datetime datetime;
+
+    void read(const dballe::CursorData& cur)
+    {
+        station  = cur.get_station();
+        level    = cur.get_level();
+        trange   = cur.get_trange();
+        datetime = cur.get_datetime();
+    }
+};
+
+/**
+ * Native implementation of a volnd.ListIndex.
+ *
+ * New entries are accumulated here and appended to the Python index object by
+ * flush().
+ */
+struct Index
+{
+    /// Python index object
+    pyo_unique_ptr index;
+    /// If true, rows not already in the index are rejected
+    bool frozen;
+
+    explicit Index(PyObject* index) : index(index)
+    {
+        Py_INCREF(index);
+        pyo_unique_ptr pyfrozen(
+            throw_ifnull(PyObject_GetAttrString(index, "_frozen")));
+        int res = PyObject_IsTrue(pyfrozen);
+        if (res == -1)
+            throw PythonException();
+        frozen = res;
+    }
+    virtual ~Index() {}
+
+    /// Check if the row can be placed along this index
+    virtual bool approve(const Row& row) const = 0;
+
+    /// Return the position of row along this index, adding it if needed
+    virtual unsigned position(const Row& row) = 0;
+
+    /// Append the new entries to the Python index object
+    virtual void flush() = 0;
+};
+
+template <typename Traits> struct ListIndex : public Index
+{
+    typedef typename Traits::Key Key;
+    typedef typename Traits::Details Details;
+
+    /// Maps keys to positions along the index
+    std::map<Key, unsigned> positions;
+    /// Size of the Python index object
+    unsigned start;
+    /// Details of the entries not yet appended to the Python index object
+    std::vector<Details> added;
+
+    explicit ListIndex(PyObject* index) : Index(index)
+    {
+        pyo_unique_ptr map(throw_ifnull(PyObject_GetAttrString(index, "_map")));
+        if (!PyDict_Check(map.get()))
+        {
+            PyErr_SetString(PyExc_TypeError, "index _map should be a dict");
+            throw PythonException();
+        }
+        PyObject* key;
+        PyObject* val;
+        Py_ssize_t pos = 0;
+        while (PyDict_Next(map, &pos, &key, &val))
+            positions.emplace(Traits::key_from_python(key),
+                              int_from_python(val));
+        Py_ssize_t len = PyObject_Length(index);
+        if (len == -1)
+            throw PythonException();
+        start = len;
+    }
+
+    bool approve(const Row& row) const override
+    {
+        if (!frozen)
+            return true;
+        return positions.find(Traits::key(row)) != positions.end();
+    }
+
+    unsigned position(const Row& row) override
+    {
+        auto res = positions.emplace(Traits::key(row), start + added.size());
+        if (res.second)
+            added.emplace_back(Traits::details(row));
+        return res.first->second;
+    }
+
+    void flush() override
+    {
+        for (const auto& details : added)
+        {
+            pyo_unique_ptr key(
+                Traits::key_to_python(Traits::details_key(details)));
+            pyo_unique_ptr pydetails(Traits::details_to_python(details));
+            pyo_unique_ptr res(throw_ifnull(PyObject_CallMethod(
+                index, "_append_native", "OO", key.get(), pydetails.get())));
+        }
+        start += added.size();
+        added.clear();
+    }
+};
+
+/// Traits for indices whose details are the same as the key
+template <typename KEY> struct KeyTraits
+{
+    typedef KEY Key;
+    typedef KEY Details;
+    static const Key& details_key(const Details& details) { return details; }
+    static PyObject* details_to_python(const Details& details)
+    {
+        return to_python(details);
+    }
+    static PyObject* key_to_python(const Key& key) { return to_python(key); }
+    static Key key_from_python(PyObject* o) { return from_python<Key>(o); }
+};
+
+struct AnaTraits
+{
+    typedef int Key;
+    typedef DBStation Details;
+    static Key key(const Row& row) { return row.station.id; }
+    static const Details& details(const Row& row) { return row.station; }
+    static Key details_key(const Details& details) { return details.id; }
+    static PyObject* key_to_python(Key key)
+    {
+        return dballe_int_to_python(key);
+    }
+    static Key key_from_python(PyObject* o)
+    {
+        return dballe_int_from_python(o);
+    }
+    static PyObject* details_to_python(const Details& details)
+    {
+        pyo_unique_ptr res(throw_ifnull(PyTuple_New(4)));
+        PyTuple_SET_ITEM(res.get(), 0, dballe_int_to_python(details.id));
+        PyTuple_SET_ITEM(res.get(), 1,
+                         dballe_int_lat_to_python(details.coords.lat));
+        PyTuple_SET_ITEM(res.get(), 2,
+                         dballe_int_lon_to_python(details.coords.lon));
+        if (details.ident.is_missing())
+        {
+            Py_INCREF(Py_None);
+            PyTuple_SET_ITEM(res.get(), 3, Py_None);
+        }
+        else
+            PyTuple_SET_ITEM(res.get(), 3,
+                             throw_ifnull(
+                                 PyUnicode_FromString(details.ident.get())));
+        return res.release();
+    }
+};
+
+struct NetworkTraits : public KeyTraits<std::string>
+{
+    static Key key(const Row& row) { return row.station.report; }
+    static Details details(const Row& row) { return row.station.report; }
+};
+
+struct LevelTraits : public KeyTraits<Level>
+{
+    static const Key& key(const Row& row) { return row.level; }
+    static const Details& details(const Row& row) { return row.level; }
+};
+
+struct TrangeTraits : public KeyTraits<Trange>
+{
+    static const Key& key(const Row& row) { return row.trange; }
+    static const Details& details(const Row& row) { return row.trange; }
+};
+
+struct DatetimeTraits : public KeyTraits<Datetime>
+{
+    static const Key& key(const Row& row) { return row.datetime; }
+    static const Details& details(const Row& row) { return row.datetime; }
+};
+
+std::unique_ptr<Index> create_index(PyObject* index, const std::string& kind)
+{
+    if (kind == "ana")
+        return std::unique_ptr<Index>(new ListIndex<AnaTraits>(index));
+    if (kind == "network")
+        return std::unique_ptr<Index>(new ListIndex<NetworkTraits>(index));
+    if (kind == "level")
+        return std::unique_ptr<Index>(new ListIndex<LevelTraits>(index));
+    if (kind == "trange")
+        return std::unique_ptr<Index>(new ListIndex<TrangeTraits>(index));
+    if (kind == "datetime")
+        return std::unique_ptr<Index>(new ListIndex<DatetimeTraits>(index));
+    PyErr_Format(PyExc_ValueError, "unsupported index kind %s", kind.c_str());
+    throw PythonException();
+}
+
+PyObject* values_to_python(std::unique_ptr<Values>&& values)
+{
+    py_unique_ptr<dpy_VolndValues> res(
+        throw_ifnull(PyObject_New(dpy_VolndValues, dpy_VolndValues_Type)));
+    res->values = values.release();
+    return (PyObject*)res.release();
+}
+
+/// Values collected for one variable code
+struct Variable
+{
+    std::string name;
+    /// Python list with the index objects for each dimension
+    pyo_unique_ptr dims;
+    /// Native indices, one per dimension
+    std::vector<Index*> indices;
+    std::unique_ptr<Values> values;
+    /// Attribute values, in the order they are first found
+    std::vector<std::pair<std::string, std::unique_ptr<Values>>> attrs;
+
+    Values& attr(const std::string& code)
+    {
+        for (auto& a : attrs)
+            if (a.first == code)
+                return *a.second;
+        attrs.emplace_back(code, std::unique_ptr<Values>(new Values(
+                                     name, indices.size(), values->objects)));
+        return *attrs.back().second;
+    }
+
+    /// Return a (dims, values, attrs) tuple
+    PyObject* to_python()
+    {
+        pyo_unique_ptr pyattrs(throw_ifnull(PyDict_New()));
+        for (auto& a : attrs)
+        {
+            pyo_unique_ptr pyvalues(values_to_python(std::move(a.second)));
+            if (PyDict_SetItemString(pyattrs, a.first.c_str(), pyvalues))
+                throw PythonException();
+        }
+        pyo_unique_ptr pyvalues(values_to_python(std::move(values)));
+        return throw_ifnull(PyTuple_Pack(3, dims.get(), pyvalues.get(),
+                                         pyattrs.get()));
+    }
+};
+
+/**
+ * Index the rows of a cursor, collecting values and attributes for each
+ * variable
+ */
+struct Reader
+{
+    /// Sequence of index objects passed by the caller
+    pyo_unique_ptr pydims;
+    /// Index objects passed by the caller, and their kinds
+    std::vector<std::pair<PyObject*, std::string>> dims;
+    /// Native indices, by Python index object
+    std::map<PyObject*, std::unique_ptr<Index>> indices;
+    /// Variables, in the order they are first found
+    std::vector<Variable> variables;
+    /// Position of each variable in variables
+    std::map<wreport::Varcode, size_t> variable_positions;
+    /// Filter function, or Py_None
+    PyObject* filter = Py_None;
+    /// Read attributes
+    bool read_attrs = false;
+    /// If not empty, read only the attributes with these codes
+    std::set<std::string> attr_codes;
+
+    Reader(PyObject* dims_arg, PyObject* pykinds)
+    {
+        pydims = throw_ifnull(
+            PySequence_Fast(dims_arg, "dims must be a sequence of indices"));
+        std::vector<std::string> kinds = stringlist_from_python(pykinds);
+        if ((size_t)PySequence_Fast_GET_SIZE(pydims.get()) != kinds.size())
+        {
+            PyErr_SetString(PyExc_ValueError,
+                            "dims and kinds must have the same length");
+            throw PythonException();
+        }
+        for (size_t i = 0; i < kinds.size(); ++i)
+            dims.emplace_back(PySequence_Fast_GET_ITEM(pydims.get(), i),
+                              kinds[i]);
+    }
+
+    void set_attributes(PyObject* attributes)
+    {
+        if (attributes == Py_None)
+            return;
+        read_attrs = true;
+        if (attributes == Py_True)
+            return;
+        for (const auto& code : stringlist_from_python(attributes))
+            attr_codes.insert(code);
+    }
+
+    Index& index(PyObject* pyindex, const std::string& kind)
+    {
+        auto i = indices.find(pyindex);
+        if (i != indices.end())
+            return *i->second;
+        auto res = indices.emplace(pyindex, create_index(pyindex, kind));
+        return *res.first->second;
+    }
+
+    Variable& variable(const wreport::Var& var)
+    {
+        auto i = variable_positions.find(var.code());
+        if (i != variable_positions.end())
+            return variables[i->second];
+
+        variable_positions.emplace(var.code(), variables.size());
+        variables.emplace_back();
+        Variable& res = variables.back();
+        res.name      = varcode_format(var.code());
+        res.dims      = throw_ifnull(PyList_New(dims.size()));
+        for (size_t i = 0; i < dims.size(); ++i)
+        {
+            // Indices are shared or duplicated according to their copy()
+            PyObject* copy = throw_ifnull(
+                PyObject_CallMethod(dims[i].first, "copy", nullptr));
+            PyList_SET_ITEM(res.dims.get(), i, copy);
+            res.indices.push_back(&index(copy, dims[i].second));
+        }
+        res.values.reset(new Values(res.name, dims.size(),
+                                    var.info()->type == Vartype::String));
+        return res;
+    }
+
+    void add_attrs(PyObject* pycursor, Variable& var, const unsigned* pos)
+    {
+        pyo_unique_ptr attrs(throw_ifnull(
+            PyObject_CallMethod(pycursor, "query_attrs", nullptr)));
+        PyObject* key;
+        PyObject* val;
+        Py_ssize_t i = 0;
+        while (PyDict_Next(attrs, &i, &key, &val))
+        {
+            std::string code = string_from_python(key);
+            if (!attr_codes.empty() &&
+                attr_codes.find(code) == attr_codes.end())
+                continue;
+            var.attr(code).append(pos, val);
+        }
+    }
+
+    void read(PyObject* pycursor, dballe::CursorData& cur)
+    {
+        Row row;
+        std::vector<unsigned> pos(dims.size());
+        while (cur.next())
+        {
+            // Discard the values that filter does not like
+            if (filter != Py_None)
+            {
+                pyo_unique_ptr res(throw_ifnull(
+                    PyObject_CallFunctionObjArgs(filter, pycursor, nullptr)));
+                int keep = PyObject_IsTrue(res);
+                if (keep == -1)
+                    throw PythonException();
+                if (!keep)
+                    continue;
+            }
+
+            wreport::Var var = cur.get_var();
+            Variable& v      = variable(var);
+
+            row.read(cur);
+            bool accepted = true;
+            for (auto idx : v.indices)
+                if (!idx->approve(row))
+                {
+                    accepted = false;
+                    break;
+                }
+            if (!accepted)
+                continue;
+
+            for (size_t i = 0; i < v.indices.size(); ++i)
+                pos[i] = v.indices[i]->position(row);
+            v.values->append(pos.data(), var);
+
+            if (read_attrs)
+                add_attrs(pycursor, v, pos.data());
+        }
+
+        for (auto& i : indices)
+            i.second->flush();
+    }
+
+    PyObject* to_python()
+    {
+        pyo_unique_ptr res(throw_ifnull(PyDict_New()));
+        for (auto& v : variables)
+        {
+            pyo_unique_ptr item(v.to_python());
+            if (PyDict_SetItemString(res, v.name.c_str(), item))
+                throw PythonException();
+        }
+        return res.release();
+    }
+};
+
+struct fill : MethKwargs<fill, dpy_VolndValues>
+{
+    constexpr static const char* name = "fill";
+    constexpr static const char* signature =
+        "array: numpy.ndarray, mask: Optional[numpy.ndarray]=None, "
+        "check_conflicts: bool=True";
+    constexpr static const char* returns = "None";
+    constexpr static const char* summary =
+        "Store the collected values in a numpy array";
+    constexpr static const char* doc = R"(
+If mask is None, array is an array of objects that is filled with
+:class:`dballe.Var` objects; otherwise array is a numeric array, and the
+elements of mask corresponding to the values stored are set to False.
+
+If check_conflicts is True, raise IndexError if two values would end up
+filling the same element.
+)";
+    static PyObject* run(Impl* self, PyObject* args, PyObject* kw)
+    {
+        static const char* kwlist[] = {"array", "mask", "check_conflicts",
+                                       nullptr};
+        PyObject* array             = nullptr;
+        PyObject* mask              = Py_None;
+        int check_conflicts         = 1;
+        if (!PyArg_ParseTupleAndKeywords(args, kw, "O|Op",
+                                         const_cast<char**>(kwlist), &array,
+                                         &mask, &check_conflicts))
+            return nullptr;
+        try
+        {
+            if (mask == Py_None)
+            {
+                if (!self->values->objects)
+                {
+                    PyErr_SetString(PyExc_ValueError,
+                                    "a mask is needed to store numbers");
+                    return nullptr;
+                }
+                self->values->fill_objects(array, check_conflicts);
+            }
+            else
+            {
+                if (self->values->objects)
+                {
+                    PyErr_SetString(PyExc_ValueError,
+                                    "variables cannot be stored with a mask");
+                    return nullptr;
+                }
+                self->values->fill_numbers(array, mask, check_conflicts);
+            }
+            Py_RETURN_NONE;
+        }
+        DBALLE_CATCH_RETURN_PYO
+    }
+};
+
+struct Definition : public Type<Definition, dpy_VolndValues>
+{
+    constexpr static const char* name      = "_VolndValues";
+    constexpr static const char* qual_name = "dballe._VolndValues";
+    constexpr static const char* doc       = R"(
+Values collected by :func:`dballe.volnd.read` for a variable or attribute,
+waiting to be stored in a numpy array.
+)";
+
+    GetSetters<> getsetters;
+    Methods<fill> methods;
+
+    static void _dealloc(Impl* self)
+    {
+        delete self->values;
+        Py_TYPE(self)->tp_free(self);
+    }
+};
+
+Definition* definition = nullptr;
+
+} // namespace
+
+} // namespace volnd
+} // namespace python
+} // namespace dballe
+
+extern "C" {
+
+static PyObject* dballe_volnd_read(PyObject* self, PyObject* args,
+                                   PyObject* kw)
+{
+    using namespace dballe::python::volnd;
+
+    static const char* kwlist[] = {"cursor", "dims",       "kinds",
+                                   "filter", "attributes", nullptr};
+    PyObject* pycursor          = nullptr;
+    PyObject* dims              = nullptr;
+    PyObject* kinds             = nullptr;
+    PyObject* filter            = Py_None;
+    PyObject* attributes        = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "OOO|OO",
+                                     const_cast<char**>(kwlist), &pycursor,
+                                     &dims, &kinds, &filter, &attributes))
+        return nullptr;
+
+    try
+    {
+        dballe::CursorData* cur = nullptr;
+        if (dpy_CursorData_Check(pycursor))
+            cur = ((dpy_CursorData*)pycursor)->cur.get();
+        else if (dpy_CursorDataDB_Check(pycursor))
+            cur = ((dpy_CursorDataDB*)pycursor)->cur.get();
+        else
+        {
+            PyErr_SetString(PyExc_TypeError,
+                            "cursor must be a dballe.CursorData or "
+                            "dballe.CursorDataDB");
+            return nullptr;
+        }
+        if (!cur)
+        {
+            PyErr_SetString(PyExc_RuntimeError,
+                            "cannot access a cursor after the with block "
+                            "where it was used");
+            return nullptr;
+        }
+
+        Reader reader(dims, kinds);
+        reader.filter = filter;
+        reader.set_attributes(attributes);
+        reader.read(pycursor, *cur);
+        return reader.to_python();
+    }
+    DBALLE_CATCH_RETURN_PYO
+}
+
+static PyMethodDef volnd_methods[] = {
+    {"_volnd_read", (PyCFunction)dballe_volnd_read,
+     METH_VARARGS | METH_KEYWORDS, R"(
+_volnd_read(cursor, dims, kinds, filter=None, attributes=None) -> Dict[str, Tuple[list, dballe._VolndValues, Dict[str, dballe._VolndValues]]]
+
+Index all the rows of a cursor for :func:`dballe.volnd.read`)"},
+    PyMethodDef(),
+};
+}
+
+namespace dballe {
+namespace python {
+
+void register_volnd(PyObject* m)
+{
+    common_init();
+
+    volnd::definition = new volnd::Definition;
+    volnd::definition->define(dpy_VolndValues_Type, m);
+
+    if (PyModule_AddFunctions(m, volnd_methods) == -1)
+        throw PythonException();
+}
+
+} // namespace python
+} // namespace dballe
@@ -0,0 +1,36 @@
+#ifndef DBALLE_PYTHON_VOLND_H
+#define DBALLE_PYTHON_VOLND_H
+
+#include "utils/core.h"
+
+namespace dballe {
+namespace python {
+namespace volnd {
+struct Values;
+}
+} // namespace python
+} // namespace dballe
+
+extern "C" {
+
+typedef struct
+{
+    PyObject_HEAD dballe::python::volnd::Values* values;
+} dpy_VolndValues;
+
+extern PyTypeObject* dpy_VolndValues_Type;
+
+#define dpy_VolndValues_Check(ob)                                              \
+    (Py_TYPE(ob) == dpy_VolndValues_Type ||                                    \
+     PyType_IsSubtype(Py_TYPE(ob), dpy_VolndValues_Type))
+}
+
+namespace dballe {
+namespace python {
+
+void register_volnd(PyObject* m);
+
+} // namespace python
+} // namespace dballe
+
+#endif
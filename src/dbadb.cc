@@ -2,6 +2,7 @@
 #include <dballe/cmdline/dbadb.h>
 #include <dballe/cmdline/processor.h>
 #include <dballe/db/db.h>
+#include <dballe/db/v7/db.h>
 #include <dballe/file.h>
 #include <dballe/message.h>
 #include <dballe/msg/msg.h>
@@ -36,6 +37,13 @@ int op_full_pseudoana                 = 0;
 int op_verbose                        = 0;
 int op_precise_import                 = 0;
 int op_wipe_disappear                 = 0;
+int op_batch                          = 1;
+int op_batch_values                   = 0;
+int op_commit_every                   = 0;
+int op_resume                         = 0;
+int op_progress                       = 0;
+int op_jobs                           = 1;
+int op_remove_missing                 = 0;
 
 struct poptOption grepTable[] = {
     {"category",    0, POPT_ARG_INT,    &readeropts.category,     0,
@@ -160,6 +168,126 @@ struct StationsCmd : public DatabaseCmd
     }
 };
 
+struct StationDumpCmd : public DatabaseCmd
+{
+    StationDumpCmd()
+    {
+        names.push_back("station-dump");
+        usage =
+            "station-dump [options] [queryparm1=val1 [queryparm2=val2 [...]]]";
+        desc  = "Write the stations and their station values as CSV";
+        longdesc =
+            "The output has one line per station value, with columns report, "
+            "latitude, longitude, ident, varcode, value, and can be read back "
+            "by station-sync. "
+            "Query parameters are the same of the Fortran API. "
+            "Please see the section \"Input and output parameters -- For data "
+            "related action routines\" of the Fortran API documentation for a "
+            "complete list.";
+    }
+
+    int main(poptContext optCon) override
+    {
+        /* Throw away the command name */
+        poptGetArg(optCon);
+
+        /* Create the query */
+        core::Query query;
+        dba_cmdline_get_query(optCon, query);
+
+        auto db = connect();
+        Dbadb dbadb(*db);
+
+        return dbadb.do_station_dump(query, stdout);
+    }
+};
+
+struct StationSyncCmd : public DatabaseCmd
+{
+    StationSyncCmd()
+    {
+        names.push_back("station-sync");
+        usage = "station-sync [options] filename";
+        desc  = "Synchronise station values with a CSV station list";
+        longdesc =
+            "Read a list of stations and station values in the CSV format "
+            "written by station-dump (use - for standard input), and bring "
+            "the database in line with it: missing stations are created, "
+            "and missing or different values are written.";
+    }
+
+    void add_to_optable(std::vector<poptOption>& opts) const override
+    {
+        DatabaseCmd::add_to_optable(opts);
+        opts.push_back({"remove-missing", 0, POPT_ARG_NONE,
+                        &op_remove_missing, 0,
+                        "also remove the station values of the listed "
+                        "stations that are not in the list",
+                        0});
+    }
+
+    int main(poptContext optCon) override
+    {
+        /* Throw away the command name */
+        poptGetArg(optCon);
+
+        const char* fname = poptGetArg(optCon);
+        if (fname == NULL)
+            dba_cmdline_error(optCon, "you need to specify the input file");
+
+        auto db = connect();
+        Dbadb dbadb(*db);
+
+        return dbadb.do_station_sync(fname, op_remove_missing, stdout);
+    }
+};
+
+struct SummaryCmd : public DatabaseCmd
+{
+    SummaryCmd()
+    {
+        names.push_back("summary");
+        usage = "summary [options] [queryparm1=val1 [queryparm2=val2 [...]]]";
+        desc  = "Summarise the data present in the database";
+        longdesc =
+            "Query parameters are the same of the Fortran API. "
+            "Please see the section \"Input and output parameters -- For data "
+            "related action routines\" of the Fortran API documentation for a "
+            "complete list.";
+    }
+
+    void add_to_optable(std::vector<poptOption>& opts) const override
+    {
+        DatabaseCmd::add_to_optable(opts);
+        opts.push_back({"jobs", 'j', POPT_ARG_INT, &op_jobs, 0,
+                        "split the summary by station in this number of "
+                        "queries, run concurrently on separate connections "
+                        "(default: 1)",
+                        "num"});
+    }
+
+    int main(poptContext optCon) override
+    {
+        /* Throw away the command name */
+        poptGetArg(optCon);
+
+        /* Create the query */
+        core::Query query;
+        dba_cmdline_get_query(optCon, query);
+
+        if (op_jobs < 1)
+            error_consistency::throwf("invalid --jobs value %d", op_jobs);
+
+        auto db = connect();
+        if (op_jobs > 1)
+            if (auto v7db = dynamic_pointer_cast<db::v7::DB>(db))
+                v7db->set_readonly_pool_size(op_jobs);
+        Dbadb dbadb(*db);
+
+        return dbadb.do_summary(query, op_jobs, stdout);
+    }
+};
+
 /// Create / empty the database
 struct WipeCmd : public DatabaseCmd
 {
@@ -319,6 +447,28 @@ struct ImportCmd : public DatabaseCmd
 #endif
                         ,
                         "varlist"});
+        opts.push_back({"batch", 0, POPT_ARG_INT, &op_batch, 0,
+                        "accumulate this number of messages before writing "
+                        "them to the database, grouped by station "
+                        "(default: 1)",
+                        "count"});
+        opts.push_back({"batch-values", 0, POPT_ARG_INT, &op_batch_values, 0,
+                        "with --batch, also write accumulated messages when "
+                        "they contain this number of values",
+                        "count"});
+        opts.push_back({"commit-every", 0, POPT_ARG_INT, &op_commit_every, 0,
+                        "commit after importing this number of messages "
+                        "(default: commit only at the end)",
+                        "count"});
+        opts.push_back({"resume", 0, POPT_ARG_NONE, &op_resume, 0,
+                        "resume an interrupted import done with "
+                        "--commit-every, skipping the messages already "
+                        "committed. Use the same list of files as before",
+                        0});
+        opts.push_back({"progress", 0, POPT_ARG_NONE, &op_progress, 0,
+                        "print import throughput and estimated time to "
+                        "completion to standard error",
+                        0});
         opts.push_back({NULL, 0, POPT_ARG_INCLUDE_TABLE, &grepTable, 0,
                         "Options used to filter messages", 0});
     }
@@ -379,6 +529,8 @@ struct ImportCmd : public DatabaseCmd
         if (op_varlist[0])
             resolve_varlist(op_varlist, [&](wreport::Varcode code) {
                 opts->varlist.push_back(code);
+                // Also skip the other variables while decoding
+                reader.import_opts.varlist.push_back(code);
             });
 
         auto db = connect();
@@ -386,8 +538,23 @@ struct ImportCmd : public DatabaseCmd
         if (strcmp(op_report, "") != 0)
             opts->report = op_report;
 
+        if (op_batch < 1)
+            error_consistency::throwf("invalid --batch value %d", op_batch);
+        if (op_batch_values < 0)
+            error_consistency::throwf("invalid --batch-values value %d",
+                                      op_batch_values);
+        if (op_commit_every < 0)
+            error_consistency::throwf("invalid --commit-every value %d",
+                                      op_commit_every);
+        cmdline::ImportBatching batching;
+        batching.messages     = op_batch;
+        batching.values       = op_batch_values;
+        batching.commit_every = op_commit_every;
+        batching.resume       = op_resume;
+        batching.progress     = op_progress;
+
         Dbadb dbadb(*db);
-        return dbadb.do_import(get_filenames(optCon), reader, *opts);
+        return dbadb.do_import(get_filenames(optCon), reader, *opts, batching);
     }
 };
 
@@ -531,6 +698,9 @@ int main(int argc, const char* argv[])
 
     dbadb.add_subcommand(new DumpCmd);
     dbadb.add_subcommand(new StationsCmd);
+    dbadb.add_subcommand(new StationDumpCmd);
+    dbadb.add_subcommand(new StationSyncCmd);
+    dbadb.add_subcommand(new SummaryCmd);
     dbadb.add_subcommand(new WipeCmd);
     dbadb.add_subcommand(new CleanupCmd);
     dbadb.add_subcommand(new RepinfoCmd);
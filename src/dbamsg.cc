@@ -42,6 +42,7 @@ static int op_dump_json               = 0;
 static int op_dump_dds                = 0;
 static int op_dump_structured         = 0;
 static int op_precise_import          = 0;
+static int op_jobs                    = 1;
 static int op_bufr2netcdf_categories  = 0;
 static const char* op_output_type     = "bufr";
 static const char* op_output_template = "";
@@ -697,6 +698,10 @@ struct Dump : public cmdline::Subcommand
             {"precise", 0, 0, &op_precise_import, 0,
              "import messages using precise contexts instead of standard ones",
              0});
+        opts.push_back({"jobs", 'j', POPT_ARG_INT, &op_jobs, 0,
+                        "interpret the subsets of BUFR and CREX messages using "
+                        "this number of threads (default: 1)",
+                        "num"});
         opts.push_back({"text", 0, 0, &op_dump_text, 0,
                         "dump as text that can be processed by dbamsg makebufr",
                         0});
@@ -740,6 +745,9 @@ struct Dump : public cmdline::Subcommand
         cmdline::Reader reader(readeropts);
         if (op_precise_import)
             reader.import_opts.simplified = false;
+        if (op_jobs < 1)
+            error_consistency::throwf("invalid --jobs value %d", op_jobs);
+        reader.import_opts.jobs = op_jobs;
 
         core::Query query;
         if (dba_cmdline_get_query(optCon, query) > 0)
@@ -980,6 +988,10 @@ struct Convert : public cmdline::Subcommand
             {"precise", 0, 0, &op_precise_import, 0,
              "import messages using precise contexts instead of standard ones",
              0});
+        opts.push_back({"jobs", 'j', POPT_ARG_INT, &op_jobs, 0,
+                        "interpret the subsets of BUFR and CREX messages using "
+                        "this number of threads (default: 1)",
+                        "num"});
         opts.push_back({"bufr2netcdf-categories", 0, 0,
                         &op_bufr2netcdf_categories, 0,
                         "recompute data categories and subcategories according "
@@ -1014,6 +1026,9 @@ struct Convert : public cmdline::Subcommand
 
         if (op_precise_import)
             reader.import_opts.simplified = false;
+        if (op_jobs < 1)
+            error_consistency::throwf("invalid --jobs value %d", op_jobs);
+        reader.import_opts.jobs = op_jobs;
 
         if (op_report[0] != 0)
             conv.dest_rep_memo = op_report;